@@ -0,0 +1,220 @@
+#include <xc.h>
+#include "calibration.h"
+#include "capture.h"
+#include "i2c.h"
+#include "test.h"
+
+/** Adresse de l'image des courbes dans l'EEPROM. */
+#define EEPROM_ADRESSE_CALIBRATION 0
+
+/** Premier octet d'une image valide. */
+#define EEPROM_SIGNATURE_CALIBRATION 0xCA
+
+/** 
+ * Taille de l'image: signature, trois durées de deux octets par
+ * canal, et somme de contrôle.
+ */
+#define TAILLE_IMAGE (2 + CAPTURE_NOMBRE_DE_CANAUX * 6)
+
+/** Image des courbes, telle qu'elle est enregistrée dans l'EEPROM. */
+unsigned char imageCalibration[TAILLE_IMAGE];
+
+/** 
+ * Prochain octet de l'image à enregistrer. L'enregistrement est
+ * terminé lorsqu'il atteint TAILLE_IMAGE.
+ */
+unsigned char octetAEnregistrer = TAILLE_IMAGE;
+
+/**
+ * Calcule la somme de contrôle de l'image.
+ * @return La somme de contrôle.
+ */
+unsigned char sommeDeControle() {
+    unsigned char n;
+    unsigned char somme = 0;
+
+    for (n = 0; n < TAILLE_IMAGE - 1; n++) {
+        somme += imageCalibration[n];
+    }
+    return ~somme;
+}
+
+/**
+ * Prépare l'image des courbes actuelles de tous les canaux.
+ */
+void prepareImage() {
+    unsigned char canal;
+    unsigned char *octet = imageCalibration;
+    const CourbeRc *courbe;
+
+    *octet++ = EEPROM_SIGNATURE_CALIBRATION;
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        courbe = captureCourbe(canal);
+        *octet++ = (unsigned char) courbe->minimum;
+        *octet++ = (unsigned char) (courbe->minimum >> 8);
+        *octet++ = (unsigned char) courbe->centre;
+        *octet++ = (unsigned char) (courbe->centre >> 8);
+        *octet++ = (unsigned char) courbe->maximum;
+        *octet++ = (unsigned char) (courbe->maximum >> 8);
+    }
+    *octet = sommeDeControle();
+}
+
+/**
+ * Lit une durée de deux octets de l'image.
+ * @param octet Premier octet de la durée.
+ * @return La durée.
+ */
+unsigned int litDuree(const unsigned char *octet) {
+    return octet[0] + (((unsigned int) octet[1]) << 8);
+}
+
+/**
+ * Établit les courbes de conversion de la télécommande depuis 
+ * l'EEPROM. Si l'image est absente ou corrompue, ou pour les canaux
+ * dont la courbe n'est pas admise, établit les courbes par défaut.
+ * À appeler à l'initialisation, avant d'activer les interruptions.
+ */
+void calibrationInitialise() {
+    unsigned char n;
+    unsigned char canal;
+    CourbeRc courbe;
+    const unsigned char *octet = imageCalibration + 1;
+
+    octetAEnregistrer = TAILLE_IMAGE;
+    captureCourbesParDefaut();
+    for (n = 0; n < TAILLE_IMAGE; n++) {
+        imageCalibration[n] = eeprom_read(EEPROM_ADRESSE_CALIBRATION + n);
+    }
+    if ((imageCalibration[0] != EEPROM_SIGNATURE_CALIBRATION) 
+            || (imageCalibration[TAILLE_IMAGE - 1] != sommeDeControle())) {
+        return;
+    }
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        courbe.minimum = litDuree(octet);
+        courbe.centre = litDuree(octet + 2);
+        courbe.maximum = litDuree(octet + 4);
+        captureEtablitCourbe(canal, &courbe);
+        octet += 6;
+    }
+}
+
+/**
+ * Enregistre le prochain octet de l'image, s'il diffère de celui qui
+ * est déjà dans l'EEPROM. Un seul octet est enregistré par appel, 
+ * pour ne pas bloquer la boucle principale pendant l'écriture.
+ */
+void enregistreOctet() {
+    unsigned char adresse = EEPROM_ADRESSE_CALIBRATION + octetAEnregistrer;
+
+    if (eeprom_read(adresse) != imageCalibration[octetAEnregistrer]) {
+        eeprom_write(adresse, imageCalibration[octetAEnregistrer]);
+    }
+    if (++octetAEnregistrer == TAILLE_IMAGE) {
+        i2cExposeValeur(LECTURE_I2C_CALIBRATION_RC, CALIBRATION_RC_INACTIVE);
+    }
+}
+
+/**
+ * Démarre ou termine la calibration.
+ * @param demarre Différent de zéro pour démarrer, zéro pour terminer.
+ */
+void calibrationDemandee(unsigned char demarre) {
+    if (demarre) {
+        captureDemarreCalibration();
+        i2cExposeValeur(LECTURE_I2C_CALIBRATION_RC, CALIBRATION_RC_EN_COURS);
+    } else if (captureCalibrationEnCours()) {
+        if (captureTermineCalibration() > 0) {
+            prepareImage();
+            octetAEnregistrer = 0;
+            i2cExposeValeur(LECTURE_I2C_CALIBRATION_RC, CALIBRATION_RC_ENREGISTREMENT);
+        } else {
+            i2cExposeValeur(LECTURE_I2C_CALIBRATION_RC, CALIBRATION_RC_ECHEC);
+        }
+    }
+}
+
+void CALIBRATION_machine(EvenementEtValeur *ev) {
+    switch (ev->evenement) {
+        case CALIBRATION_RC_DEMANDEE:
+            calibrationDemandee((unsigned char) ev->valeur);
+            break;
+
+        case BASE_DE_TEMPS_PROFIL:
+            if (octetAEnregistrer < TAILLE_IMAGE) {
+                enregistreOctet();
+            }
+            break;
+    }
+}
+
+#ifdef TEST
+void calibre_et_enregistre_les_courbes() {
+    EvenementEtValeur demarre = {CALIBRATION_RC_DEMANDEE, 1};
+    EvenementEtValeur termine = {CALIBRATION_RC_DEMANDEE, 0};
+    EvenementEtValeur baseDeTemps = {BASE_DE_TEMPS_PROFIL, 0};
+    unsigned char n;
+
+    initialiseCapture();
+    calibrationInitialise();
+
+    CALIBRATION_machine(&demarre);
+    verifieEgalite("CALI01", i2cRegistres.valeurs[LECTURE_I2C_CALIBRATION_RC], CALIBRATION_RC_EN_COURS);
+    captureFlancMontant(1, 0);
+    captureFlancDescendant(1, 2150);
+    captureFlancMontant(1, 0);
+    captureFlancDescendant(1, 3850);
+    captureFlancMontant(1, 0);
+    captureFlancDescendant(1, 2980);
+
+    CALIBRATION_machine(&termine);
+    verifieEgalite("CALI02", i2cRegistres.valeurs[LECTURE_I2C_CALIBRATION_RC], CALIBRATION_RC_ENREGISTREMENT);
+    for (n = 0; n < TAILLE_IMAGE - 1; n++) {
+        CALIBRATION_machine(&baseDeTemps);
+    }
+    verifieEgalite("CALI03", i2cRegistres.valeurs[LECTURE_I2C_CALIBRATION_RC], CALIBRATION_RC_ENREGISTREMENT);
+    CALIBRATION_machine(&baseDeTemps);
+    verifieEgalite("CALI04", i2cRegistres.valeurs[LECTURE_I2C_CALIBRATION_RC], CALIBRATION_RC_INACTIVE);
+    verifieEgalite("CALI05", eeprom_read(EEPROM_ADRESSE_CALIBRATION), EEPROM_SIGNATURE_CALIBRATION);
+
+    // Les courbes sont rétablies au démarrage:
+    initialiseCapture();
+    verifieEgalite("CALI11", captureCourbe(1)->centre, 3000);
+    calibrationInitialise();
+    verifieEgalite("CALI12", captureCourbe(1)->minimum, 2150);
+    verifieEgalite("CALI13", captureCourbe(1)->centre, 2980);
+    verifieEgalite("CALI14", captureCourbe(1)->maximum, 3850);
+    verifieEgalite("CALI15", captureCourbe(0)->centre, 3000);
+}
+
+void refuse_une_calibration_sans_pulsations() {
+    EvenementEtValeur demarre = {CALIBRATION_RC_DEMANDEE, 1};
+    EvenementEtValeur termine = {CALIBRATION_RC_DEMANDEE, 0};
+
+    calibrationInitialise();
+    CALIBRATION_machine(&demarre);
+    CALIBRATION_machine(&termine);
+    verifieEgalite("CALE01", i2cRegistres.valeurs[LECTURE_I2C_CALIBRATION_RC], CALIBRATION_RC_ECHEC);
+    verifieEgalite("CALE02", octetAEnregistrer, TAILLE_IMAGE);
+    verifieEgalite("CALE03", captureCourbe(1)->centre, 2980);
+}
+
+void ignore_une_image_corrompue() {
+    unsigned char octet = eeprom_read(EEPROM_ADRESSE_CALIBRATION + 7);
+
+    eeprom_write(EEPROM_ADRESSE_CALIBRATION + 7, octet + 1);
+    calibrationInitialise();
+    verifieEgalite("CALC01", captureCourbe(1)->centre, 3000);
+
+    eeprom_write(EEPROM_ADRESSE_CALIBRATION, 0xFF);
+    calibrationInitialise();
+    verifieEgalite("CALC02", captureCourbe(1)->centre, 3000);
+    initialiseCapture();
+}
+
+void test_calibration() {
+    calibre_et_enregistre_les_courbes();
+    refuse_une_calibration_sans_pulsations();
+    ignore_une_image_corrompue();
+}
+#endif
@@ -0,0 +1,33 @@
+#include "domaine.h"
+
+#ifndef __CALIBRATION_H
+#define __CALIBRATION_H
+
+/**
+ * État de la calibration de la télécommande, exposé sur le bus I2C.
+ */
+typedef enum {
+    /** Pas de calibration en cours. */
+    CALIBRATION_RC_INACTIVE = 0,
+    /** Les extrêmes de chaque canal sont en cours de mesure. */
+    CALIBRATION_RC_EN_COURS = 1,
+    /** Les courbes sont en cours d'enregistrement dans l'EEPROM. */
+    CALIBRATION_RC_ENREGISTREMENT = 2,
+    /** Aucun canal n'a pu être calibré. */
+    CALIBRATION_RC_ECHEC = 3
+} EtatCalibrationRc;
+
+void calibrationInitialise();
+
+/**
+ * Machine à états pour calibrer la télécommande et enregistrer les
+ * courbes de conversion.
+ * @param ev Événement à traiter.
+ */
+void CALIBRATION_machine(EvenementEtValeur *ev);
+
+#ifdef TEST
+void test_calibration();
+#endif
+
+#endif
@@ -1,18 +1,223 @@
+#include "domaine.h"
 #include "capture.h"
+#include "i2c.h"
 #include "test.h"
 
+/** 
+ * Durée minimum d'une pulsation valide (0,8ms).
+ * Les pulsations plus courtes sont des parasites ou des pulsations
+ * tronquées.
+ */
+#define CAPTURE_PULSATION_MIN 1600
+
+/** 
+ * Durée maximum d'une pulsation valide (2,2ms).
+ * Les pulsations plus longues résultent d'un flanc perdu.
+ */
+#define CAPTURE_PULSATION_MAX 4400
+
+/** 
+ * Course minimum, en ticks, de chaque côté du centre d'une courbe
+ * (0,2ms). Une calibration plus courte est refusée.
+ */
+#define CAPTURE_COURSE_MIN 400
+
 /** Instants capturés des flancs montants. */
-unsigned int instantFlancMontant[] = {0, 0, 0, 0, 0};
+unsigned int instantFlancMontant[CAPTURE_NOMBRE_DE_CANAUX];
+
+/** Courbe de conversion de chaque canal. */
+CourbeRc courbes[CAPTURE_NOMBRE_DE_CANAUX];
+
+/** 
+ * Pente de la courbe entre le minimum et le centre, en unités de 
+ * consigne par tick, multipliée par 4096.
+ */
+unsigned int penteBasse[CAPTURE_NOMBRE_DE_CANAUX];
+
+/** 
+ * Pente de la courbe entre le centre et le maximum, en unités de 
+ * consigne par tick, multipliée par 4096.
+ */
+unsigned int penteHaute[CAPTURE_NOMBRE_DE_CANAUX];
+
+/**
+ * État de la calibration.
+ */
+typedef enum {
+    /** Les pulsations sont converties selon la courbe de chaque canal. */
+    CALIBRATION_INACTIVE,
+
+    /** Les pulsations servent à mesurer les extrêmes de chaque canal. */
+    CALIBRATION_APPRENTISSAGE,
+
+    /** 
+     * Les courbes mesurées sont en train d'être établies: les 
+     * pulsations ne sont ni mesurées ni converties.
+     */
+    CALIBRATION_INSTALLATION
+} EtatCalibration;
+
+/** État de la calibration. */
+EtatCalibration etatCalibration = CALIBRATION_INACTIVE;
+
+/** Extrêmes et dernière pulsation observés pendant la calibration. */
+CourbeRc apprentissage[CAPTURE_NOMBRE_DE_CANAUX];
+
+/** Nombre de pulsations rejetées par canal. */
+unsigned char pulsationsRejetees[CAPTURE_NOMBRE_DE_CANAUX];
+
+/** Nombre total de pulsations rejetées. */
+unsigned char totalPulsationsRejetees = 0;
 
 /**
  * Initialise la capture.
  */
 void initialiseCapture() {
-    instantFlancMontant[0] = 0;
-    instantFlancMontant[1] = 0;
-    instantFlancMontant[2] = 0;
-    instantFlancMontant[3] = 0;
-    instantFlancMontant[4] = 0;
+    unsigned char canal;
+
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        instantFlancMontant[canal] = 0;
+        pulsationsRejetees[canal] = 0;
+    }
+    totalPulsationsRejetees = 0;
+    i2cExposeValeur(LECTURE_I2C_PULSATIONS_REJETEES, 0);
+    etatCalibration = CALIBRATION_INACTIVE;
+    captureCourbesParDefaut();
+}
+
+/**
+ * Compte une pulsation rejetée. Les compteurs saturent à 255.
+ * @param canal Canal où a été capturée la pulsation.
+ */
+void rejettePulsation(unsigned char canal) {
+    if (pulsationsRejetees[canal] < 255) {
+        pulsationsRejetees[canal]++;
+    }
+    if (totalPulsationsRejetees < 255) {
+        totalPulsationsRejetees++;
+        i2cExposeValeur(LECTURE_I2C_PULSATIONS_REJETEES, totalPulsationsRejetees);
+    }
+}
+
+/**
+ * Indique le nombre de pulsations rejetées sur un canal.
+ * @param canal Le canal.
+ * @return Nombre de pulsations rejetées, jusqu'à 255.
+ */
+unsigned char captureNombreDePulsationsRejetees(unsigned char canal) {
+    return pulsationsRejetees[canal];
+}
+
+/**
+ * Établit la courbe de conversion d'un canal.
+ * @param canal Le canal.
+ * @param courbe Durées, en ticks, correspondant à 0, NEUTRE_CONSIGNE et 
+ * CONSIGNE_MAX.
+ * @return TRUE si la courbe est admise; sinon la courbe du canal
+ * ne change pas.
+ */
+unsigned char captureEtablitCourbe(unsigned char canal, const CourbeRc *courbe) {
+    if ((courbe->minimum < CAPTURE_PULSATION_MIN) 
+            || (courbe->maximum > CAPTURE_PULSATION_MAX)
+            || (courbe->centre < courbe->minimum + CAPTURE_COURSE_MIN)
+            || (courbe->maximum < courbe->centre + CAPTURE_COURSE_MIN)) {
+        return FALSE;
+    }
+    courbes[canal] = *courbe;
+    penteBasse[canal] = (unsigned int) 
+        ((((unsigned long) NEUTRE_CONSIGNE) << 12) / (courbe->centre - courbe->minimum));
+    penteHaute[canal] = (unsigned int) 
+        ((((unsigned long) (CONSIGNE_MAX - NEUTRE_CONSIGNE)) << 12) / (courbe->maximum - courbe->centre));
+    return TRUE;
+}
+
+/**
+ * Rétablit la courbe par défaut de tous les canaux: 1ms, 1,5ms, 2ms.
+ */
+void captureCourbesParDefaut() {
+    CourbeRc courbe = {2000, 3000, 4000};
+    unsigned char canal;
+
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        captureEtablitCourbe(canal, &courbe);
+    }
+}
+
+/**
+ * Récupère la courbe de conversion d'un canal.
+ * @param canal Le canal.
+ * @return La courbe.
+ */
+const CourbeRc *captureCourbe(unsigned char canal) {
+    return &courbes[canal];
+}
+
+/**
+ * Démarre la calibration. Pendant la calibration, les pulsations
+ * valides servent à mesurer les extrêmes de chaque canal, et ne sont
+ * pas transmises.
+ */
+void captureDemarreCalibration() {
+    unsigned char canal;
+
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        apprentissage[canal].minimum = 0xFFFF;
+        apprentissage[canal].centre = 0;
+        apprentissage[canal].maximum = 0;
+    }
+    etatCalibration = CALIBRATION_APPRENTISSAGE;
+}
+
+/**
+ * Termine la calibration, et établit la courbe de chaque canal selon
+ * les extrêmes observés. Le centre est la dernière pulsation reçue:
+ * les manettes doivent être relâchées avant de terminer.
+ * Les canaux dont la course est insuffisante gardent leur courbe.
+ * Les interruptions de capture ne modifient plus les extrêmes
+ * mesurés, et ne convertissent pas de pulsation tant que les courbes
+ * et les pentes ne sont pas complètement établies.
+ * @return Le nombre de canaux calibrés.
+ */
+unsigned char captureTermineCalibration() {
+    unsigned char canal;
+    unsigned char canauxCalibres = 0;
+
+    etatCalibration = CALIBRATION_INSTALLATION;
+    for (canal = 0; canal < CAPTURE_NOMBRE_DE_CANAUX; canal++) {
+        if (captureEtablitCourbe(canal, &apprentissage[canal])) {
+            canauxCalibres++;
+        }
+    }
+    etatCalibration = CALIBRATION_INACTIVE;
+    return canauxCalibres;
+}
+
+/**
+ * Indique si une calibration est en cours.
+ * @return TRUE si une calibration est en cours.
+ */
+unsigned char captureCalibrationEnCours() {
+    if (etatCalibration == CALIBRATION_APPRENTISSAGE) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Mesure une pulsation pendant la calibration.
+ * @param canal Le canal.
+ * @param duree La durée de la pulsation, en ticks.
+ */
+void apprendPulsation(unsigned char canal, unsigned int duree) {
+    CourbeRc *a = &apprentissage[canal];
+
+    if (duree < a->minimum) {
+        a->minimum = duree;
+    }
+    if (duree > a->maximum) {
+        a->maximum = duree;
+    }
+    a->centre = duree;
 }
 
 /**
@@ -24,25 +229,54 @@ void captureFlancMontant(unsigned char canal, unsigned int instant) {
     instantFlancMontant[canal] = instant;
 }
 
+/**
+ * Convertit la durée d'une pulsation selon la courbe du canal.
+ * @param canal Le canal.
+ * @param duree Durée de la pulsation, en ticks.
+ * @return Une consigne de 12 bits, entre 0 et CONSIGNE_MAX selon la 
+ * courbe du canal, avec NEUTRE_CONSIGNE au centre, ou 
+ * CAPTURE_PULSATION_INVALIDE si la durée est hors des limites admises 
+ * ou si une calibration est en cours.
+ */
+unsigned int captureConvertit(unsigned char canal, unsigned int duree) {
+    const CourbeRc *courbe = &courbes[canal];
+
+    if ((duree < CAPTURE_PULSATION_MIN) || (duree > CAPTURE_PULSATION_MAX)) {
+        rejettePulsation(canal);
+        return CAPTURE_PULSATION_INVALIDE;
+    }
+    if (etatCalibration != CALIBRATION_INACTIVE) {
+        if (etatCalibration == CALIBRATION_APPRENTISSAGE) {
+            apprendPulsation(canal, duree);
+        }
+        return CAPTURE_PULSATION_INVALIDE;
+    }
+
+    // Courbe linéaire par morceaux, arrondie:
+    if (duree >= courbe->maximum) {
+        return CONSIGNE_MAX;
+    }
+    if (duree <= courbe->minimum) {
+        return 0;
+    }
+    if (duree >= courbe->centre) {
+        duree -= courbe->centre;
+        return NEUTRE_CONSIGNE + (unsigned int) 
+            (((unsigned long) duree * penteHaute[canal] + 0x800) >> 12);
+    }
+    duree = courbe->centre - duree;
+    return NEUTRE_CONSIGNE - (unsigned int) 
+        (((unsigned long) duree * penteBasse[canal] + 0x800) >> 12);
+}
+
 /**
  * Signale la capture d'un flanc descendant.
  * @param canal Canal où a été capturé le flanc.
  * @param instant Instant au quel a été capturé le flanc.
- * @return Une valeur entre 0 et 255 proportionnelle à la durée de
- * la partie haute de la pulsation.
+ * @return La valeur de la pulsation (voir captureConvertit).
  */
-unsigned char captureFlancDescendant(unsigned char canal, unsigned int instant) {
-    instant -= instantFlancMontant[canal];
-    if (instant > 4000) {
-        instant = 4000;
-    }
-    if (instant < 2000) {
-        instant = 2000;
-    }
-    instant -= 2000;
-    instant >>= 3;
-    
-    return instant;
+unsigned int captureFlancDescendant(unsigned char canal, unsigned int instant) {
+    return captureConvertit(canal, instant - instantFlancMontant[canal]);
 }
 
 #ifdef TEST
@@ -50,25 +284,55 @@ void detecte_une_pulsation_sur_un_canal() {
     initialiseCapture();
 
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C01", captureFlancDescendant(0, 11000),   0);
+    verifieEgalite("CP1C01", captureFlancDescendant(0, 11600),   0);
 
     captureFlancMontant(0, 10000);
     verifieEgalite("CP1C02", captureFlancDescendant(0, 12000),   0);
 
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C03", captureFlancDescendant(0, 12500),  62);
+    verifieEgalite("CP1C03", captureFlancDescendant(0, 12500),  1024);
 
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C04", captureFlancDescendant(0, 13000), 125);
+    verifieEgalite("CP1C04", captureFlancDescendant(0, 13000), NEUTRE_CONSIGNE);
     
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C05", captureFlancDescendant(0, 13500), 187);
+    verifieEgalite("CP1C05", captureFlancDescendant(0, 13500), 3071);
     
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C06", captureFlancDescendant(0, 14000), 250);
+    verifieEgalite("CP1C06", captureFlancDescendant(0, 14000), CONSIGNE_MAX);
     
     captureFlancMontant(0, 10000);
-    verifieEgalite("CP1C07", captureFlancDescendant(0, 15000), 250);
+    verifieEgalite("CP1C07", captureFlancDescendant(0, 14400), CONSIGNE_MAX);
+
+    verifieEgalite("CP1C08", captureNombreDePulsationsRejetees(0), 0);
+}
+
+void rejette_les_pulsations_hors_limites() {
+    initialiseCapture();
+
+    // Parasite:
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPRJ01", captureFlancDescendant(0, 10100), CAPTURE_PULSATION_INVALIDE);
+
+    // Pulsation tronquée:
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPRJ02", captureFlancDescendant(0, 11599), CAPTURE_PULSATION_INVALIDE);
+
+    // Flanc descendant perdu:
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPRJ03", captureFlancDescendant(1, 14401), CAPTURE_PULSATION_INVALIDE);
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPRJ04", captureFlancDescendant(1, 50000), CAPTURE_PULSATION_INVALIDE);
+
+    // Les pulsations rejetées sont comptées:
+    verifieEgalite("CPRJ11", captureNombreDePulsationsRejetees(0), 2);
+    verifieEgalite("CPRJ12", captureNombreDePulsationsRejetees(1), 2);
+    verifieEgalite("CPRJ13", i2cRegistres.valeurs[LECTURE_I2C_PULSATIONS_REJETEES], 4);
+
+    // Les pulsations valides ne sont pas comptées:
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPRJ21", captureFlancDescendant(0, 13000), NEUTRE_CONSIGNE);
+    verifieEgalite("CPRJ22", captureNombreDePulsationsRejetees(0), 2);
 }
 
 void detecte_des_pulsations_sur_deux_canaux() {
@@ -80,11 +344,11 @@ void detecte_des_pulsations_sur_deux_canaux() {
     captureFlancMontant(3, 13000);
     captureFlancMontant(4, 14000);
 
-    verifieEgalite("CP2C00", captureFlancDescendant(0, 13000),   125);
-    verifieEgalite("CP2C01", captureFlancDescendant(1, 14000),   125);
-    verifieEgalite("CP2C02", captureFlancDescendant(2, 15000),   125);
-    verifieEgalite("CP2C03", captureFlancDescendant(3, 16000),   125);
-    verifieEgalite("CP2C04", captureFlancDescendant(4, 17000),   125);
+    verifieEgalite("CP2C00", captureFlancDescendant(0, 13000),   NEUTRE_CONSIGNE);
+    verifieEgalite("CP2C01", captureFlancDescendant(1, 14000),   NEUTRE_CONSIGNE);
+    verifieEgalite("CP2C02", captureFlancDescendant(2, 15000),   NEUTRE_CONSIGNE);
+    verifieEgalite("CP2C03", captureFlancDescendant(3, 16000),   NEUTRE_CONSIGNE);
+    verifieEgalite("CP2C04", captureFlancDescendant(4, 17000),   NEUTRE_CONSIGNE);
 }
 
 void detecte_une_pulsation_avec_debordement() {
@@ -92,12 +356,104 @@ void detecte_une_pulsation_avec_debordement() {
 
     captureFlancMontant(0, 65500);
 
-    verifieEgalite("CPDE00", captureFlancDescendant(0, 2964),   125);
+    verifieEgalite("CPDE00", captureFlancDescendant(0, 2964),   NEUTRE_CONSIGNE);
+}
+
+void convertit_selon_la_courbe_du_canal() {
+    CourbeRc courbe = {2100, 2950, 3900};
+    CourbeRc courbeTropCourte = {2100, 2400, 3900};
+
+    initialiseCapture();
+    verifieNonZero("CPCO01", captureEtablitCourbe(1, &courbe));
+
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPCO02", captureFlancDescendant(1, 12100), 0);
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPCO03", captureFlancDescendant(1, 12950), NEUTRE_CONSIGNE);
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPCO04", captureFlancDescendant(1, 13900), CONSIGNE_MAX);
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPCO05", captureFlancDescendant(1, 12525), 1024);
+    captureFlancMontant(1, 10000);
+    verifieEgalite("CPCO06", captureFlancDescendant(1, 13425), 3071);
+
+    // Les autres canaux gardent leur courbe:
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCO11", captureFlancDescendant(0, 12950), NEUTRE_CONSIGNE - 102);
+
+    // Une courbe trop courte est refusée:
+    verifieEgalite("CPCO21", captureEtablitCourbe(1, &courbeTropCourte), FALSE);
+    verifieEgalite("CPCO22", captureCourbe(1)->centre, 2950);
+    
+    initialiseCapture();
+}
+
+void calibre_les_canaux_selon_les_pulsations_recues() {
+    initialiseCapture();
+    captureDemarreCalibration();
+    verifieNonZero("CPCA00", captureCalibrationEnCours());
+
+    // Pendant la calibration, les pulsations ne sont pas transmises:
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCA01", captureFlancDescendant(0, 12200), CAPTURE_PULSATION_INVALIDE);
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCA02", captureFlancDescendant(0, 13800), CAPTURE_PULSATION_INVALIDE);
+    captureFlancMontant(0, 10000);
+    captureFlancDescendant(0, 13020);
+    verifieEgalite("CPCA03", captureNombreDePulsationsRejetees(0), 0);
+
+    // Seul le canal qui a reçu des pulsations est calibré:
+    verifieEgalite("CPCA11", captureTermineCalibration(), 1);
+    verifieEgalite("CPCA12", captureCalibrationEnCours(), FALSE);
+    verifieEgalite("CPCA13", captureCourbe(0)->minimum, 2200);
+    verifieEgalite("CPCA14", captureCourbe(0)->centre, 3020);
+    verifieEgalite("CPCA15", captureCourbe(0)->maximum, 3800);
+    verifieEgalite("CPCA16", captureCourbe(1)->centre, 3000);
+
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCA21", captureFlancDescendant(0, 13020), NEUTRE_CONSIGNE);
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCA22", captureFlancDescendant(0, 13800), CONSIGNE_MAX);
+
+    initialiseCapture();
+}
+
+void n_apprend_ni_ne_convertit_pendant_l_installation_des_courbes() {
+    initialiseCapture();
+    captureDemarreCalibration();
+    captureFlancMontant(0, 10000);
+    captureFlancDescendant(0, 12200);
+    captureFlancMontant(0, 10000);
+    captureFlancDescendant(0, 13800);
+    captureFlancMontant(0, 10000);
+    captureFlancDescendant(0, 13000);
+
+    // Une pulsation reçue pendant l'installation des courbes
+    // n'est ni mesurée, ni convertie:
+    etatCalibration = CALIBRATION_INSTALLATION;
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCI01", captureFlancDescendant(0, 12100), CAPTURE_PULSATION_INVALIDE);
+    verifieEgalite("CPCI02", apprentissage[0].minimum, 2200);
+    verifieEgalite("CPCI03", apprentissage[0].centre, 3000);
+    verifieEgalite("CPCI04", captureCalibrationEnCours(), FALSE);
+
+    etatCalibration = CALIBRATION_APPRENTISSAGE;
+    verifieEgalite("CPCI11", captureTermineCalibration(), 1);
+    verifieEgalite("CPCI12", captureCourbe(0)->minimum, 2200);
+    verifieEgalite("CPCI13", captureCourbe(0)->centre, 3000);
+    captureFlancMontant(0, 10000);
+    verifieEgalite("CPCI14", captureFlancDescendant(0, 13000), NEUTRE_CONSIGNE);
+
+    initialiseCapture();
 }
 
 void test_capture() {
     detecte_une_pulsation_sur_un_canal();
     detecte_des_pulsations_sur_deux_canaux();
     detecte_une_pulsation_avec_debordement();
+    rejette_les_pulsations_hors_limites();
+    convertit_selon_la_courbe_du_canal();
+    calibre_les_canaux_selon_les_pulsations_recues();
+    n_apprend_ni_ne_convertit_pendant_l_installation_des_courbes();
 }
 #endif
\ No newline at end of file
@@ -1,8 +1,38 @@
 #ifndef CAPTURE__H
 #define	CAPTURE__H
 
+/** 
+ * Nombre de canaux de capture: un par entrée CCP, ou jusqu'à 8 
+ * canaux sur une entrée PPM.
+ */
+#define CAPTURE_NOMBRE_DE_CANAUX 8
+
+/** Valeur retournée par captureFlancDescendant pour une pulsation rejetée. */
+#define CAPTURE_PULSATION_INVALIDE 0xFFFF
+
+/**
+ * Courbe de conversion d'un canal de la télécommande: durées de 
+ * pulsation, en ticks de 0,5us, correspondant à 0, NEUTRE_CONSIGNE
+ * et CONSIGNE_MAX.
+ */
+typedef struct {
+    unsigned int minimum;
+    unsigned int centre;
+    unsigned int maximum;
+} CourbeRc;
+
+void initialiseCapture();
 void captureFlancMontant(unsigned char canal, unsigned int instant);
-unsigned char captureFlancDescendant(unsigned char canal, unsigned int instant);
+unsigned int captureFlancDescendant(unsigned char canal, unsigned int instant);
+unsigned int captureConvertit(unsigned char canal, unsigned int duree);
+unsigned char captureNombreDePulsationsRejetees(unsigned char canal);
+
+unsigned char captureEtablitCourbe(unsigned char canal, const CourbeRc *courbe);
+void captureCourbesParDefaut();
+const CourbeRc *captureCourbe(unsigned char canal);
+void captureDemarreCalibration();
+unsigned char captureTermineCalibration();
+unsigned char captureCalibrationEnCours();
 
 #ifdef TEST
 void test_capture();
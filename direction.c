@@ -4,12 +4,15 @@
 #include "evenements.h"
 #include "i2c.h"
 #include "file.h"
+#include "servo.h"
+#include "profil.h"
+#include "reglages.h"
 
 /** 
  * Distance du neutre en deçà de la quelle on considère que la télécommande
  * est centrée.
  */
-#define SEUIL_NEUTRALITE_TELECOMMANDE 10
+#define SEUIL_NEUTRALITE_TELECOMMANDE CONSIGNE(5)
 
 /** 
  * Comptes de la base de temps jusqu'à considérer 
@@ -18,7 +21,15 @@
 #define TEMPS_INACTIVITE_TELECOMMANDE 35
 
 /**
- * Décrit une manoeuvre.
+ * Délai par défaut, en comptes de la base de temps du profil (10ms),
+ * sans pulsation valide sur un canal avant de le considérer perdu.
+ */
+#define DELAI_SECURITE_TELECOMMANDE 25
+
+/**
+ * Décrit une manoeuvre. Les manoeuvres programmables se définissent
+ * champ par champ, dans l'ordre de la structure (voir 
+ * ECRITURE_I2C_CHAMP_BLOC).
  */
 typedef struct {
     /** Distance à parcourir. */
@@ -26,21 +37,70 @@ typedef struct {
     
     /** Orientation des roues. */
     unsigned char orientationRoues;
+
+    /** 
+     * Vitesse maximum des roues, en ticks par trame du servo, ou 0
+     * pour la vitesse établie par le bus.
+     */
+    unsigned char vitesseRoues;
+
+    /**
+     * Vitesse maximum du profil de déplacement, en 1/16 de phase par 
+     * pas de temps, ou 0 pour la vitesse par défaut. Au-delà de 48, 
+     * c'est aussi la vitesse par défaut.
+     */
+    unsigned char vitesseMax;
+
+    /** Comportement à la fin de la manoeuvre (voir FinManoeuvre). */
+    unsigned char fin;
 } Manoeuvre;
 
 /**
- * Liste des manoeuvres.
+ * Liste des manoeuvres prédéfinies.
  */
 const Manoeuvre const manoeuvres[] = {
-//   Distance  //  Orientation des roues
-    {NEUTRE +  95, NEUTRE +  0},     // Avance un peu.
-    {NEUTRE +  95, NEUTRE + 90},     // Quart de tour avant gauche
-    {NEUTRE +  95, NEUTRE - 90},     // Quart de tour avant droit
-    {NEUTRE -  95, NEUTRE +  0},     // Recule un peu.
-    {NEUTRE -  95, NEUTRE + 90},     // Quart de tour arrière gauche.
-    {NEUTRE -  95, NEUTRE - 90}      // Quart de tour arrière droit
+//   Distance  //  Orientation des roues // Vitesse des roues // Vitesse max // Fin
+    {NEUTRE +  95, NEUTRE +  0,   0, 0, 0},    // Avance un peu.
+    {NEUTRE +  95, NEUTRE + 90,  40, 0, 0},    // Quart de tour avant gauche
+    {NEUTRE +  95, NEUTRE - 90,  40, 0, 0},    // Quart de tour avant droit
+    {NEUTRE -  95, NEUTRE +  0,   0, 0, 0},    // Recule un peu.
+    {NEUTRE -  95, NEUTRE + 90,  40, 0, 0},    // Quart de tour arrière gauche.
+    {NEUTRE -  95, NEUTRE - 90,  40, 0, 0}     // Quart de tour arrière droit
 };
 
+/** Nombre de manoeuvres prédéfinies. */
+#define NOMBRE_MANOEUVRES_PREDEFINIES (sizeof(manoeuvres) / sizeof(Manoeuvre))
+
+/** Manoeuvres programmées par le bus I2C. */
+Manoeuvre manoeuvresProgrammables[NOMBRE_MANOEUVRES_PROGRAMMABLES];
+
+/** Manoeuvre programmable en cours de définition. */
+unsigned char manoeuvreADefinir = 0;
+
+/** Prochain champ à définir de la manoeuvre programmable. */
+unsigned char champADefinir = 0;
+
+/** Bloc sélectionné par ECRITURE_I2C_SELECTION_BLOC. */
+unsigned char blocSelectionne = 0;
+
+/** Comportement à la fin de la manoeuvre en cours. */
+unsigned char finManoeuvre = 0;
+
+/** Sens du déplacement de la manoeuvre en cours. */
+Direction sensManoeuvre = AVANT;
+
+/** 
+ * Manoeuvre dont le déplacement prolonge déjà celui en cours, mais 
+ * dont l'orientation des roues reste à appliquer.
+ */
+Manoeuvre const *manoeuvreEnchainee = 0;
+
+/**
+ * Distance restante au générateur de profil, en phases, à partir de 
+ * laquelle la manoeuvre enchaînée commence.
+ */
+unsigned char distanceDeBraquage = 0;
+
 /**
  * Mode de direction.
  */
@@ -61,6 +121,18 @@ BusOuTelecommande busOuTelecommande = MODE_TELECOMMANDE;
  */
 unsigned char tempsInactiviteTelecommande = TEMPS_INACTIVITE_TELECOMMANDE;
 
+/** Délai sans pulsation valide avant de considérer un canal perdu. */
+unsigned char delaiSecuriteTelecommande = DELAI_SECURITE_TELECOMMANDE;
+
+/** Temps restant avant de considérer perdu le canal avant / arrière. */
+unsigned char delaiSignalAvantArriere = DELAI_SECURITE_TELECOMMANDE;
+
+/** Temps restant avant de considérer perdu le canal gauche / droite. */
+unsigned char delaiSignalGaucheDroite = DELAI_SECURITE_TELECOMMANDE;
+
+/** Canaux de la télécommande perdus (voir SecuriteRc). */
+unsigned char securiteTelecommande = 0;
+
 /** 
  * État des manoeuvres. 
  */
@@ -83,23 +155,118 @@ unsigned char nombreDeManoeuvresAExecuter = 0;
 File fileManoeuvres;
 
 /**
- * Vide la file des manoeuvres.
+ * Vide la file des manoeuvres, et rétablit la vitesse des roues et du
+ * profil de déplacement. 
+ * À n'appeler que depuis la boucle principale: la vitesse maximum du
+ * profil, sur 16 bits, est lue par profilAvance() sans protection.
  */
 void reinitialiseManoeuvres() {
     fileReinitialise(&fileManoeuvres);
     nombreDeManoeuvresAExecuter = 0;
     etatManoeuvre = PAS_DE_MANOEUVRE;
+    finManoeuvre = 0;
+    manoeuvreEnchainee = 0;
+    servoEtablitVitesseManoeuvre(0);
+    profilEtablitVitesseMax(0);
     i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, 0);
 }
 
+/**
+ * Efface les manoeuvres programmables: elles ne déplacent pas la 
+ * voiture tant qu'elles ne sont pas définies.
+ */
+void effaceManoeuvresProgrammables() {
+    unsigned char n;
+    Manoeuvre *manoeuvre;
+
+    for (n = 0; n < NOMBRE_MANOEUVRES_PROGRAMMABLES; n++) {
+        manoeuvre = &manoeuvresProgrammables[n];
+        manoeuvre->distance = NEUTRE;
+        manoeuvre->orientationRoues = NEUTRE;
+        manoeuvre->vitesseRoues = 0;
+        manoeuvre->vitesseMax = 0;
+        manoeuvre->fin = 0;
+    }
+    manoeuvreADefinir = 0;
+    champADefinir = 0;
+}
+
+/**
+ * Commence la définition d'une manoeuvre programmable.
+ * @param numeroDeManoeuvre Numéro de la manoeuvre, à partir de 
+ * MANOEUVRE_PROGRAMMABLE.
+ */
+void commenceDefinitionManoeuvre(unsigned char numeroDeManoeuvre) {
+    manoeuvreADefinir = numeroDeManoeuvre - MANOEUVRE_PROGRAMMABLE;
+    champADefinir = 0;
+}
+
+/**
+ * Définit le prochain champ de la manoeuvre programmable en cours de 
+ * définition. Les champs au-delà du dernier sont ignorés.
+ * @param valeur Valeur du champ.
+ */
+void definitChampManoeuvre(unsigned char valeur) {
+    unsigned char *champs;
+
+    if (manoeuvreADefinir >= NOMBRE_MANOEUVRES_PROGRAMMABLES) {
+        return;
+    }
+    if (champADefinir >= sizeof(Manoeuvre)) {
+        return;
+    }
+    champs = (unsigned char *) &manoeuvresProgrammables[manoeuvreADefinir];
+    champs[champADefinir++] = valeur;
+}
+
+/**
+ * Trouve la manoeuvre correspondant au numéro indiqué.
+ * @param numeroDeManoeuvre Numéro de manoeuvre prédéfinie, ou 
+ * programmable à partir de MANOEUVRE_PROGRAMMABLE.
+ * @return La manoeuvre, ou 0 si le numéro ne correspond à aucune.
+ */
+Manoeuvre const *trouveManoeuvre(unsigned char numeroDeManoeuvre) {
+    if (numeroDeManoeuvre < NOMBRE_MANOEUVRES_PREDEFINIES) {
+        return &manoeuvres[numeroDeManoeuvre];
+    }
+    numeroDeManoeuvre -= MANOEUVRE_PROGRAMMABLE;
+    if (numeroDeManoeuvre < NOMBRE_MANOEUVRES_PROGRAMMABLES) {
+        return &manoeuvresProgrammables[numeroDeManoeuvre];
+    }
+    return 0;
+}
+
 /**
  * Réinitialise le module de direction.
  * Y compris la file des manoeuvres.
  */
 void initialiseDirection() {
     reinitialiseManoeuvres();
+    effaceManoeuvresProgrammables();
+    blocSelectionne = 0;
     busOuTelecommande = MODE_TELECOMMANDE;
     tempsInactiviteTelecommande = TEMPS_INACTIVITE_TELECOMMANDE;
+    delaiSecuriteTelecommande = DELAI_SECURITE_TELECOMMANDE;
+    delaiSignalAvantArriere = DELAI_SECURITE_TELECOMMANDE;
+    delaiSignalGaucheDroite = DELAI_SECURITE_TELECOMMANDE;
+    securiteTelecommande = 0;
+    i2cExposeValeur(LECTURE_I2C_SECURITE_RC, 0);
+}
+
+/**
+ * Applique l'orientation des roues et les paramètres de la manoeuvre
+ * indiquée. Son déplacement doit déjà être demandé ou enchaîné.
+ * @param manoeuvre La manoeuvre.
+ */
+void oriente(Manoeuvre const *manoeuvre) {
+    MagnitudeEtDirection deplacement;
+
+    convertitEnMagnitudeEtDirection(manoeuvre->distance, &deplacement);
+    sensManoeuvre = deplacement.direction;
+    finManoeuvre = manoeuvre->fin;
+    servoEtablitVitesseManoeuvre(manoeuvre->vitesseRoues);
+    profilEtablitVitesseMax(((unsigned int) manoeuvre->vitesseMax) << 4);
+    enfileMessageInterne(LECTURE_RC_GAUCHE_DROITE, CONSIGNE(manoeuvre->orientationRoues));
 }
 
 /**
@@ -109,16 +276,65 @@ void initialiseDirection() {
 void executeManoeuvre(unsigned char numeroDeManoeuvre) {
     Manoeuvre const *manoeuvre;
  
-    manoeuvre = &(manoeuvres[numeroDeManoeuvre]);
+    manoeuvre = trouveManoeuvre(numeroDeManoeuvre);
+    manoeuvreEnchainee = 0;
     enfileMessageInterne(DEPLACEMENT_DEMANDE, manoeuvre->distance);
-    enfileMessageInterne(LECTURE_RC_GAUCHE_DROITE, manoeuvre->orientationRoues);
+    oriente(manoeuvre);
+}
+
+/**
+ * Si la manoeuvre en cours s'enchaîne avec la suivante, prolonge le
+ * déplacement avant que le générateur de profil commence à freiner. 
+ * L'orientation des roues de la manoeuvre suivante est appliquée plus 
+ * tard, quand la distance restante n'est plus que son propre déplacement.
+ * À appeler à chaque pas du générateur de profil.
+ */
+void enchaineManoeuvre() {
+    Manoeuvre const *suivante;
+    MagnitudeEtDirection deplacement;
+
+    if (manoeuvreEnchainee != 0) {
+        if (profilDistanceRestante() <= distanceDeBraquage) {
+            oriente(manoeuvreEnchainee);
+            manoeuvreEnchainee = 0;
+        }
+        return;
+    }
+    if (!(finManoeuvre & MANOEUVRE_FIN_ENCHAINEE)) {
+        return;
+    }
+    if (fileEstVide(&fileManoeuvres) || profilTermine()) {
+        return;
+    }
+
+    // La suivante doit aller dans le même sens, et tenir dans le profil:
+    suivante = trouveManoeuvre(fileConsulte(&fileManoeuvres));
+    convertitEnMagnitudeEtDirection(suivante->distance, &deplacement);
+    if (deplacement.direction != sensManoeuvre) {
+        return;
+    }
+    if (profilDistanceRestante() + deplacement.magnitude > 255) {
+        return;
+    }
+
+    fileDefile(&fileManoeuvres);
+    nombreDeManoeuvresAExecuter--;
+    i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, nombreDeManoeuvresAExecuter);
+    enfileMessageInterne(DEPLACEMENT_PROLONGE, suivante->distance);
+    manoeuvreEnchainee = suivante;
+    distanceDeBraquage = deplacement.magnitude;
 }
 
 /**
  * Ajoute une nouvelle manoeuvre à la file.
- * @param numeroDeManoeuvre Le numéro de manoeuvre.
+ * Les numéros qui ne correspondent à aucune manoeuvre sont ignorés.
+ * @param numeroDeManoeuvre Le numéro de manoeuvre, prédéfinie ou
+ * programmable.
  */
 void enfileManoeuvre(unsigned char numeroDeManoeuvre) {
+    if (trouveManoeuvre(numeroDeManoeuvre) == 0) {
+        return;
+    }
     if (!fileEstPleine(&fileManoeuvres)) {
         i2cExposeValeur(LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE, numeroDeManoeuvre);
         i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, nombreDeManoeuvresAExecuter);
@@ -130,8 +346,22 @@ void enfileManoeuvre(unsigned char numeroDeManoeuvre) {
     }
 }
 
+/**
+ * Applique le comportement de fin de la dernière manoeuvre.
+ */
+void termineManoeuvres() {
+    if (finManoeuvre & MANOEUVRE_FIN_ROUES_AU_NEUTRE) {
+        enfileMessageInterne(LECTURE_RC_GAUCHE_DROITE, NEUTRE_CONSIGNE);
+    }
+    if (finManoeuvre & MANOEUVRE_FIN_MOTEUR_LIBRE) {
+        enfileMessageInterne(VITESSE_DEMANDEE, NEUTRE_CONSIGNE);
+    }
+    finManoeuvre = 0;
+}
+
 /**
  * Si il y en a disponibles, défile une manoeuvre et l'exécute.
+ * Sinon, applique le comportement de fin de la dernière.
  */
 void defileManoeuvre() {
     unsigned char numeroDeManoeuvre;
@@ -141,6 +371,9 @@ void defileManoeuvre() {
         nombreDeManoeuvresAExecuter --;
     } else {
         nombreDeManoeuvresAExecuter = 0;
+        servoEtablitVitesseManoeuvre(0);
+        profilEtablitVitesseMax(0);
+        termineManoeuvres();
     }
     i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, nombreDeManoeuvresAExecuter);
 }
@@ -150,6 +383,8 @@ void defileManoeuvre() {
  * Ignore les commandes si c'est la télécommande qui a le contrôle.
  * Les commandes de vitesse et direction vident la file de manoeuvres
  * et annulent la manoeuvre en cours.
+ * Appelée depuis la boucle principale (voir i2cTraiteCommandes): les 
+ * événements sont donc des messages internes.
  * @param adresse Adresse associée à la commande.
  * @param valeur Valeur associée à la commande.
  */
@@ -159,17 +394,65 @@ void receptionBus(unsigned char adresse, unsigned char valeur) {
             
             case ECRITURE_I2C_VITESSE:
                 reinitialiseManoeuvres();
-                enfileEvenement(VITESSE_DEMANDEE, valeur);
+                enfileMessageInterne(VITESSE_DEMANDEE, CONSIGNE(valeur));
                 break;
                 
             case ECRITURE_I2C_DIRECTION:
                 reinitialiseManoeuvres();
-                enfileEvenement(LECTURE_RC_GAUCHE_DROITE, valeur);    
+                enfileMessageInterne(LECTURE_RC_GAUCHE_DROITE, CONSIGNE(valeur));    
                 break;
                 
             case ECRITURE_I2C_MANOEUVRE:
                 enfileManoeuvre(valeur);
                 break;
+            case ECRITURE_I2C_LIMITE_COURANT:
+                enfileMessageInterne(LIMITE_COURANT_DEMANDEE, valeur);
+                break;
+            case ECRITURE_I2C_TEMPERATURE_DEBUT:
+                enfileMessageInterne(TEMPERATURE_DEBUT_REDUCTION_DEMANDEE, valeur);
+                break;
+            case ECRITURE_I2C_TEMPERATURE_FIN:
+                enfileMessageInterne(TEMPERATURE_FIN_REDUCTION_DEMANDEE, valeur);
+                break;
+            case ECRITURE_I2C_CALIBRATION_RC:
+                enfileMessageInterne(CALIBRATION_RC_DEMANDEE, valeur);
+                break;
+            case ECRITURE_I2C_DELAI_SECURITE_RC:
+                if (valeur == 0) {
+                    valeur = 1;
+                }
+                delaiSecuriteTelecommande = valeur;
+                break;
+            case ECRITURE_I2C_VITESSE_DIRECTION:
+                servoEtablitVitesse(SERVO_ROUES_AVANT, valeur);
+                break;
+            case ECRITURE_I2C_LISSAGE_DIRECTION:
+                servoEtablitLissage(SERVO_ROUES_AVANT, valeur);
+                break;
+            case ECRITURE_I2C_SERVO_AUXILIAIRE_1:
+                enfileMessageInterne(SERVO_AUXILIAIRE_1_DEMANDE, CONSIGNE(valeur));
+                break;
+            case ECRITURE_I2C_SERVO_AUXILIAIRE_2:
+                enfileMessageInterne(SERVO_AUXILIAIRE_2_DEMANDE, CONSIGNE(valeur));
+                break;
+            case ECRITURE_I2C_PERIODE_TELEMETRIE:
+                enfileMessageInterne(TELEMETRIE_PERIODE_DEMANDEE, valeur);
+                break;
+            case ECRITURE_I2C_SELECTION_BLOC:
+                blocSelectionne = valeur;
+                if (blocSelectionne >= REGLAGE) {
+                    reglagesSelectionne(valeur);
+                } else {
+                    commenceDefinitionManoeuvre(valeur);
+                }
+                break;
+            case ECRITURE_I2C_CHAMP_BLOC:
+                if (blocSelectionne >= REGLAGE) {
+                    reglagesDefinitChamp(valeur);
+                } else {
+                    definitChampManoeuvre(valeur);
+                }
+                break;
                 
             default:
                 break;
@@ -182,9 +465,9 @@ void receptionBus(unsigned char adresse, unsigned char valeur) {
  * @param valeur Valeur lue de la télécommande
  * @return -1/255 si la valeur n'est pas neutre.
  */
-char valeurTelecommandeEstPasNeutre(unsigned char valeur) {
-    if ((valeur >= NEUTRE + SEUIL_NEUTRALITE_TELECOMMANDE) ||
-            (valeur <= NEUTRE - SEUIL_NEUTRALITE_TELECOMMANDE)) {
+char valeurTelecommandeEstPasNeutre(unsigned int valeur) {
+    if ((valeur >= NEUTRE_CONSIGNE + SEUIL_NEUTRALITE_TELECOMMANDE) ||
+            (valeur <= NEUTRE_CONSIGNE - SEUIL_NEUTRALITE_TELECOMMANDE)) {
         return -1;
     } else {
         return 0;
@@ -193,15 +476,20 @@ char valeurTelecommandeEstPasNeutre(unsigned char valeur) {
 
 /**
  * Reçoit la lecture d'un canal de la télécommande.
+ * Cette fonction est appelée depuis l'interruption de basse priorité:
+ * elle ne touche pas à la file de manoeuvres, que la boucle principale
+ * peut être en train de modifier. Elle annonce le changement de mode 
+ * avec TELECOMMANDE_ACTIVEE, et la boucle principale annule les 
+ * manoeuvres en le traitant.
  * @param evenement Le canal de télécommande.
  * @param valeur La valeur lue
  */
-void receptionTelecommande(Evenement evenement, unsigned char valeur) {
+void receptionTelecommande(Evenement evenement, unsigned int valeur) {
     switch(busOuTelecommande) {
         case MODE_BUS_DE_COMMANDES:
             if (valeurTelecommandeEstPasNeutre(valeur)) {
-                reinitialiseManoeuvres();
                 busOuTelecommande = MODE_TELECOMMANDE;
+                enfileEvenement(TELECOMMANDE_ACTIVEE, 0);
                 enfileEvenement(evenement, valeur);    
             }
             break;
@@ -214,35 +502,94 @@ void receptionTelecommande(Evenement evenement, unsigned char valeur) {
     }    
 }
 
+/**
+ * Signale qu'un canal de la télécommande a reçu une pulsation valide.
+ * @param canal Le canal (voir SecuriteRc).
+ */
+void signalTelecommandeRetabli(SecuriteRc canal) {
+    if (securiteTelecommande & canal) {
+        securiteTelecommande &= ~canal;
+        i2cExposeValeur(LECTURE_I2C_SECURITE_RC, securiteTelecommande);
+    }
+}
+
+/**
+ * Signale qu'un canal de la télécommande est perdu. Si c'est la 
+ * télécommande qui commande, ramène le canal au neutre.
+ * @param canal Le canal (voir SecuriteRc).
+ * @param evenement L'événement associé au canal.
+ */
+void signalTelecommandePerdu(SecuriteRc canal, Evenement evenement) {
+    securiteTelecommande |= canal;
+    i2cExposeValeur(LECTURE_I2C_SECURITE_RC, securiteTelecommande);
+    if (busOuTelecommande == MODE_TELECOMMANDE) {
+        enfileEvenement(evenement, NEUTRE_CONSIGNE);
+    }
+}
+
+/**
+ * Surveille la réception des canaux de la télécommande. Un canal qui
+ * ne reçoit pas de pulsation valide pendant le délai de sécurité est
+ * considéré perdu, et ramené au neutre.
+ * À appeler à chaque base de temps du profil, depuis la même 
+ * interruption que les captures.
+ */
+void verifieSignalTelecommande() {
+    if (delaiSignalAvantArriere > 0) {
+        if (--delaiSignalAvantArriere == 0) {
+            signalTelecommandePerdu(SECURITE_RC_AVANT_ARRIERE, VITESSE_DEMANDEE);
+        }
+    }
+    if (delaiSignalGaucheDroite > 0) {
+        if (--delaiSignalGaucheDroite == 0) {
+            signalTelecommandePerdu(SECURITE_RC_GAUCHE_DROITE, LECTURE_RC_GAUCHE_DROITE);
+        }
+    }
+}
+
 /**
  * Reçoit les lectures du canal 1 (avant / arrière) de la télécommande.
- * @param valeur Entre 0 et 255. 128 pour tout droit.
+ * @param valeur Consigne de 12 bits. NEUTRE_CONSIGNE pour l'arrêt.
  */
-void receptionTelecommandeAvantArriere(unsigned char valeur) {
-    i2cExposeValeur(LECTURE_I2C_VITESSE_RC, valeur);
+void receptionTelecommandeAvantArriere(unsigned int valeur) {
+    delaiSignalAvantArriere = delaiSecuriteTelecommande;
+    signalTelecommandeRetabli(SECURITE_RC_AVANT_ARRIERE);
+    i2cExposeValeur(LECTURE_I2C_VITESSE_RC, (unsigned char) (valeur >> 4));
     receptionTelecommande(VITESSE_DEMANDEE, valeur);
 }
 
 /**
  * Reçoit les lectures du canal 2 (gauche / droite) de la télécommande.
- * @param valeur Entre 0 et 255. 128 pour repos.
+ * @param valeur Consigne de 12 bits. NEUTRE_CONSIGNE pour tout droit.
  */
-void receptionTelecommandeGaucheDroite(unsigned char valeur) {
-    i2cExposeValeur(LECTURE_I2C_RC_GAUCHE_DROITE, valeur);
+void receptionTelecommandeGaucheDroite(unsigned int valeur) {
+    delaiSignalGaucheDroite = delaiSecuriteTelecommande;
+    signalTelecommandeRetabli(SECURITE_RC_GAUCHE_DROITE);
+    i2cExposeValeur(LECTURE_I2C_RC_GAUCHE_DROITE, (unsigned char) (valeur >> 4));
     receptionTelecommande(LECTURE_RC_GAUCHE_DROITE, valeur);    
 }
 
 /**
- * Calcule la forme du signal PWM à produire pour positionner les roues avant
- * à la position indiquée.
- * @param position Position des roues avant, entre 0 et 255. 128 est neutre.
+ * Calcule la durée de pulsation d'un servo pour la position indiquée.
+ * @param position Position du servo, consigne de 12 bits. 
+ * NEUTRE_CONSIGNE est neutre.
+ * @return La durée de pulsation, en ticks de 0,5us.
  */
-void calculePwmServoRouesAvant(unsigned char position) {
+unsigned int calculeDureeServo(unsigned int position) {
     unsigned int x = position;
-    x <<= 3;
+    x >>= 1;
     x += 2000;
-    tableauDeBord.positionRouesAvant.tempsBas.valeur = 25535 + x;
-    tableauDeBord.positionRouesAvant.tempsHaut.valeur = (unsigned int) 65535 - x;
+    return x;
+}
+
+/**
+ * Positionne les roues avant. Le servo s'en approche à chaque trame
+ * (voir servoPlanifie).
+ * @param position Position des roues avant, consigne de 12 bits. 
+ * NEUTRE_CONSIGNE est neutre.
+ */
+void calculePwmServoRouesAvant(unsigned int position) {
+    servoEtablitCible(SERVO_ROUES_AVANT, calculeDureeServo(position));
 }
 
 /**
@@ -264,63 +611,136 @@ void DIRECTION_machine(EvenementEtValeur *ev) {
         case LECTURE_RC_GAUCHE_DROITE:
             calculePwmServoRouesAvant(ev->valeur);
             break;
+
+        case SERVO_AUXILIAIRE_1_DEMANDE:
+            servoEtablitCible(SERVO_AUXILIAIRE_1, calculeDureeServo(ev->valeur));
+            break;
+
+        case SERVO_AUXILIAIRE_2_DEMANDE:
+            servoEtablitCible(SERVO_AUXILIAIRE_2, calculeDureeServo(ev->valeur));
+            break;
             
+        case BASE_DE_TEMPS_PROFIL:
+            enchaineManoeuvre();
+            break;
+
         case DEPLACEMENT_ATTEINT:
             defileManoeuvre();
             break;
+
+        case TELECOMMANDE_ACTIVEE:
+            reinitialiseManoeuvres();
+            break;
     }
 }
 
 #ifdef TEST
+/**
+ * Simule une trame des servos.
+ * @return La durée de pulsation du servo des roues avant.
+ */
+unsigned int trameRouesAvant() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+
+    trameServo(durees);
+    return durees[SERVO_ROUES_AVANT];
+}
+
 unsigned calcule_pwm_servo_roues_avant() {
     unsigned char testsEnErreur = 0;
     
-    calculePwmServoRouesAvant(128);
-    verifieEgalite("DIR01", tableauDeBord.positionRouesAvant.tempsBas.valeur, 65535 - 40000 + 3024);
-    verifieEgalite("DIR01a", tableauDeBord.positionRouesAvant.tempsHaut.valeur, 65535 - 3024);
+    servoInitialise();
+    calculePwmServoRouesAvant(NEUTRE_CONSIGNE);
+    verifieEgalite("DIR01", trameRouesAvant(), 3024);
 
     calculePwmServoRouesAvant(0);
-    verifieEgalite("DIR11", tableauDeBord.positionRouesAvant.tempsBas.valeur, 65535 - 40000 + 2000);
-    verifieEgalite("DIR11a", tableauDeBord.positionRouesAvant.tempsHaut.valeur, 65535 - 2000);
+    verifieEgalite("DIR11", trameRouesAvant(), 2000);
 
-    calculePwmServoRouesAvant(255);
-    verifieEgalite("DIR21", tableauDeBord.positionRouesAvant.tempsBas.valeur, 65535 - 40000 + 4040);
-    verifieEgalite("DIR21a", tableauDeBord.positionRouesAvant.tempsHaut.valeur, 65535 - 4040);
+    calculePwmServoRouesAvant(CONSIGNE(255));
+    verifieEgalite("DIR21", trameRouesAvant(), 4040);
 
     return testsEnErreur;
 }
 
 void ignore_les_commandes_i2c_si_mode_telecommande() {
-    initialiseEvenements();
+    initialiseMessagesInternes();
     busOuTelecommande = MODE_TELECOMMANDE;
     
     receptionBus(0, 10);
-    verifieEgalite("DIR_IGI2C0", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_IGI2C0", (int) defileMessageInterne(), 0);
     
     receptionBus(1, 10);
-    verifieEgalite("DIR_IGI2C1", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_IGI2C1", (int) defileMessageInterne(), 0);
     
     receptionBus(2, 10);
-    verifieEgalite("DIR_IGI2C2", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_IGI2C2", (int) defileMessageInterne(), 0);
     
     receptionBus(3, 10);
-    verifieEgalite("DIR_IGI2C3", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_IGI2C3", (int) defileMessageInterne(), 0);
 }
 
 void transmet_les_commandes_i2c() {
-    initialiseEvenements();
+    initialiseMessagesInternes();
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
     EvenementEtValeur *evenementEtValeur;
     
     receptionBus(0, 100);
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_ACI2C0", evenementEtValeur->evenement, VITESSE_DEMANDEE);
-    verifieEgalite("DIR_ACI2C1", evenementEtValeur->valeur, 100);
+    verifieEgalite("DIR_ACI2C1", evenementEtValeur->valeur, CONSIGNE(100));
     
     receptionBus(1, 110);
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_ACI2C2", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
-    verifieEgalite("DIR_ACI2C3", evenementEtValeur->valeur, 110);
+    verifieEgalite("DIR_ACI2C3", evenementEtValeur->valeur, CONSIGNE(110));
+
+    receptionBus(3, 12);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_ACI2C4", evenementEtValeur->evenement, LIMITE_COURANT_DEMANDEE);
+    verifieEgalite("DIR_ACI2C5", evenementEtValeur->valeur, 12);
+
+    receptionBus(ECRITURE_I2C_CALIBRATION_RC, 1);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_ACI2C6", evenementEtValeur->evenement, CALIBRATION_RC_DEMANDEE);
+    verifieEgalite("DIR_ACI2C7", evenementEtValeur->valeur, 1);
+
+    servoInitialise();
+    calculePwmServoRouesAvant(0);
+    receptionBus(ECRITURE_I2C_VITESSE_DIRECTION, 50);
+    verifieEgalite("DIR_ACI2C8", trameRouesAvant(), 2974);
+    receptionBus(ECRITURE_I2C_VITESSE_DIRECTION, 0);
+    receptionBus(ECRITURE_I2C_LISSAGE_DIRECTION, 3);
+    verifieEgalite("DIR_ACI2C9", trameRouesAvant(), 2852);
+    servoInitialise();
+
+    receptionBus(ECRITURE_I2C_SERVO_AUXILIAIRE_1, 255);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_ACI2C10", evenementEtValeur->evenement, SERVO_AUXILIAIRE_1_DEMANDE);
+    verifieEgalite("DIR_ACI2C11", evenementEtValeur->valeur, CONSIGNE(255));
+
+    receptionBus(ECRITURE_I2C_SERVO_AUXILIAIRE_2, 0);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_ACI2C12", evenementEtValeur->evenement, SERVO_AUXILIAIRE_2_DEMANDE);
+    verifieEgalite("DIR_ACI2C13", evenementEtValeur->valeur, 0);
+
+    receptionBus(ECRITURE_I2C_PERIODE_TELEMETRIE, 5);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_ACI2C14", evenementEtValeur->evenement, TELEMETRIE_PERIODE_DEMANDEE);
+    verifieEgalite("DIR_ACI2C15", evenementEtValeur->valeur, 5);
+}
+
+void positionne_les_servos_auxiliaires() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+    EvenementEtValeur auxiliaire1 = {SERVO_AUXILIAIRE_1_DEMANDE, CONSIGNE(255)};
+    EvenementEtValeur auxiliaire2 = {SERVO_AUXILIAIRE_2_DEMANDE, 0};
+
+    servoInitialise();
+    DIRECTION_machine(&auxiliaire1);
+    DIRECTION_machine(&auxiliaire2);
+    trameServo(durees);
+    verifieEgalite("DIR_AUX01", durees[SERVO_ROUES_AVANT], 3024);
+    verifieEgalite("DIR_AUX02", durees[SERVO_AUXILIAIRE_1], 4040);
+    verifieEgalite("DIR_AUX03", durees[SERVO_AUXILIAIRE_2], 2000);
 }
 
 void transmet_les_commandes_de_la_telecommande() {
@@ -328,52 +748,52 @@ void transmet_les_commandes_de_la_telecommande() {
     busOuTelecommande = MODE_TELECOMMANDE;
     EvenementEtValeur *evenementEtValeur;
         
-    receptionTelecommandeAvantArriere(21);
+    receptionTelecommandeAvantArriere(CONSIGNE(21) + 5);
     evenementEtValeur = defileEvenement();
     verifieEgalite("DIR_T0", evenementEtValeur->evenement, VITESSE_DEMANDEE);
-    verifieEgalite("DIR_T1", evenementEtValeur->valeur, 21);
+    verifieEgalite("DIR_T1", evenementEtValeur->valeur, CONSIGNE(21) + 5);
 
-    receptionTelecommandeGaucheDroite(22);
+    receptionTelecommandeGaucheDroite(CONSIGNE(22) + 9);
     evenementEtValeur = defileEvenement();
     verifieEgalite("DIR_T2", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
-    verifieEgalite("DIR_T3", evenementEtValeur->valeur, 22);
+    verifieEgalite("DIR_T3", evenementEtValeur->valeur, CONSIGNE(22) + 9);
     
 }
 
 void expose_les_commandes_de_la_telecommande_a_i2c() {
     busOuTelecommande = MODE_TELECOMMANDE;
         
-    receptionTelecommandeAvantArriere(121);
-    receptionTelecommandeGaucheDroite(221);
-    verifieEgalite("DIR_I2C0", i2cValeursExposees[0], 121);
-    verifieEgalite("DIR_I2C1", i2cValeursExposees[1], 221);
+    receptionTelecommandeAvantArriere(CONSIGNE(121));
+    receptionTelecommandeGaucheDroite(CONSIGNE(221));
+    verifieEgalite("DIR_I2C0", i2cRegistres.valeurs[0], 121);
+    verifieEgalite("DIR_I2C1", i2cRegistres.valeurs[1], 221);
 }
 
 void passe_en_mode_telecommande_si_le_canal_1_est_pas_neutre() {
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeAvantArriere(NEUTRE);
+    receptionTelecommandeAvantArriere(NEUTRE_CONSIGNE);
     verifieEgalite("DIR_C1N0", busOuTelecommande, MODE_BUS_DE_COMMANDES);
     
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeAvantArriere(NEUTRE + SEUIL_NEUTRALITE_TELECOMMANDE);
+    receptionTelecommandeAvantArriere(NEUTRE_CONSIGNE + SEUIL_NEUTRALITE_TELECOMMANDE);
     verifieEgalite("DIR_C1N1", busOuTelecommande, MODE_TELECOMMANDE);
 
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeAvantArriere(NEUTRE - SEUIL_NEUTRALITE_TELECOMMANDE);
+    receptionTelecommandeAvantArriere(NEUTRE_CONSIGNE - SEUIL_NEUTRALITE_TELECOMMANDE);
     verifieEgalite("DIR_C1N2", busOuTelecommande, MODE_TELECOMMANDE);
 }
 
 void passe_en_mode_telecommande_si_le_canal_2_est_pas_neutre() {
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeGaucheDroite(NEUTRE);
+    receptionTelecommandeGaucheDroite(NEUTRE_CONSIGNE);
     verifieEgalite("DIR_C2N0", busOuTelecommande, MODE_BUS_DE_COMMANDES);
     
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeGaucheDroite(NEUTRE + SEUIL_NEUTRALITE_TELECOMMANDE);
+    receptionTelecommandeGaucheDroite(NEUTRE_CONSIGNE + SEUIL_NEUTRALITE_TELECOMMANDE);
     verifieEgalite("DIR_C2N1", busOuTelecommande, MODE_TELECOMMANDE);
 
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
-    receptionTelecommandeGaucheDroite(NEUTRE - SEUIL_NEUTRALITE_TELECOMMANDE);
+    receptionTelecommandeGaucheDroite(NEUTRE_CONSIGNE - SEUIL_NEUTRALITE_TELECOMMANDE);
     verifieEgalite("DIR_C2N2", busOuTelecommande, MODE_TELECOMMANDE);
 }
 
@@ -383,8 +803,8 @@ void passe_en_mode_bus_si_la_telecommande_est_longtemps_neutre() {
 
     busOuTelecommande = MODE_TELECOMMANDE;
     for (n = 0; n < TEMPS_INACTIVITE_TELECOMMANDE; n++) {
-        receptionTelecommandeGaucheDroite(NEUTRE - SEUIL_NEUTRALITE_TELECOMMANDE + 1);
-        receptionTelecommandeAvantArriere(NEUTRE + SEUIL_NEUTRALITE_TELECOMMANDE - 1);
+        receptionTelecommandeGaucheDroite(NEUTRE_CONSIGNE - SEUIL_NEUTRALITE_TELECOMMANDE + 1);
+        receptionTelecommandeAvantArriere(NEUTRE_CONSIGNE + SEUIL_NEUTRALITE_TELECOMMANDE - 1);
         DIRECTION_machine(&ev);
     }
     verifieEgalite("DIR_N1", busOuTelecommande, MODE_BUS_DE_COMMANDES);
@@ -393,6 +813,7 @@ void passe_en_mode_bus_si_la_telecommande_est_longtemps_neutre() {
 void execute_immediatement_la_premiere_manoeuvre() {
     initialiseMessagesInternes();
     initialiseDirection();
+    servoInitialise();
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
     EvenementEtValeur *evenementEtValeur;
     
@@ -405,14 +826,23 @@ void execute_immediatement_la_premiere_manoeuvre() {
     
     evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_MAP2", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
-    verifieEgalite("DIR_MAP3", evenementEtValeur->valeur, manoeuvres[1].orientationRoues);
+    verifieEgalite("DIR_MAP3", evenementEtValeur->valeur, CONSIGNE(manoeuvres[1].orientationRoues));
 
     verifieEgalite("DIR_MAP4", (int) defileMessageInterne(), 0);
+
+    // La manoeuvre limite la vitesse des roues:
+    calculePwmServoRouesAvant(0);
+    verifieEgalite("DIR_MAP5", trameRouesAvant(), 3024 - manoeuvres[1].vitesseRoues);
+
+    // La vitesse de la manoeuvre est oubliée avec la manoeuvre:
+    receptionBus(ECRITURE_I2C_DIRECTION, 10);
+    verifieEgalite("DIR_MAP6", trameRouesAvant(), 2000);
 }
 
 void execute_la_suivante_manoeuvre_apres_avoir_complete_la_premiere() {
     initialiseMessagesInternes();
     initialiseDirection();
+    servoInitialise();
     EvenementEtValeur deplacementAtteint = {DEPLACEMENT_ATTEINT, 0};
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
     EvenementEtValeur *evenementEtValeur;
@@ -431,10 +861,12 @@ void execute_la_suivante_manoeuvre_apres_avoir_complete_la_premiere() {
     verifieEgalite("DIR_MASU04", evenementEtValeur->valeur, manoeuvres[2].distance);
     evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_MASU05", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
-    verifieEgalite("DIR_MASU06", evenementEtValeur->valeur, manoeuvres[2].orientationRoues);
+    verifieEgalite("DIR_MASU06", evenementEtValeur->valeur, CONSIGNE(manoeuvres[2].orientationRoues));
 
     defileManoeuvre();
     verifieEgalite("DIR_MASU07", nombreDeManoeuvresAExecuter, 0);    
+    calculePwmServoRouesAvant(0);
+    verifieEgalite("DIR_MASU08", trameRouesAvant(), 2000);
 }
 
 void execute_un_arret_apres_avoir_complete_la_derniere_manoeuvre() {
@@ -458,6 +890,33 @@ void execute_un_arret_apres_avoir_complete_la_derniere_manoeuvre() {
     DIRECTION_machine(&deplacementAtteint);
     verifieEgalite("DIR_MAAR01", (int) defileMessageInterne(), 0);
 }
+void l_interruption_ne_modifie_pas_la_vitesse_de_la_manoeuvre() {
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+    initialiseEvenements();
+    initialiseDirection();
+    servoInitialise();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
+    defileMessageInterne();
+    defileMessageInterne();
+
+    // La télécommande prend le contrôle, depuis l'interruption:
+    receptionTelecommandeGaucheDroite(CONSIGNE(NEUTRE + 60));
+    calculePwmServoRouesAvant(0);
+    verifieEgalite("DIR_MIT01", trameRouesAvant(), 3024 - manoeuvres[1].vitesseRoues);
+
+    // La vitesse n'est rétablie que dans la boucle principale:
+    evenementEtValeur = defileEvenement();
+    verifieEgalite("DIR_MIT02", evenementEtValeur->evenement, TELECOMMANDE_ACTIVEE);
+    DIRECTION_machine(evenementEtValeur);
+    verifieEgalite("DIR_MIT03", trameRouesAvant(), 2000);
+
+    initialiseEvenements();
+    initialiseDirection();
+}
+
 void ignore_les_manoeuvres_si_la_file_deborde() {
     unsigned char n;
     reinitialiseManoeuvres();
@@ -469,47 +928,248 @@ void ignore_les_manoeuvres_si_la_file_deborde() {
     verifieEgalite("DIR_MAD02", nombreDeManoeuvresAExecuter, FILE_TAILLE + 1);    
 }
 
+void execute_les_manoeuvres_programmees_par_i2c() {
+    EvenementEtValeur deplacementAtteint = {DEPLACEMENT_ATTEINT, 0};
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+
+    receptionBus(ECRITURE_I2C_SELECTION_BLOC, MANOEUVRE_PROGRAMMABLE + 3);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, NEUTRE + 40);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, NEUTRE - 30);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 20);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 8);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 
+            MANOEUVRE_FIN_ROUES_AU_NEUTRE | MANOEUVRE_FIN_MOTEUR_LIBRE);
+    // Les champs en trop sont ignorés:
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 99);
+    verifieEgalite("DIR_MPR01", manoeuvresProgrammables[3].distance, NEUTRE + 40);
+    verifieEgalite("DIR_MPR02", manoeuvresProgrammables[3].orientationRoues, NEUTRE - 30);
+    verifieEgalite("DIR_MPR03", manoeuvresProgrammables[3].vitesseRoues, 20);
+    verifieEgalite("DIR_MPR04", manoeuvresProgrammables[3].vitesseMax, 8);
+    verifieEgalite("DIR_MPR05", manoeuvresProgrammables[4].distance, NEUTRE);
+    verifieEgalite("DIR_MPR06", (int) defileMessageInterne(), 0);
+
+    // La manoeuvre programmée s'exécute comme une prédéfinie:
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + 3);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MPR11", evenementEtValeur->evenement, DEPLACEMENT_DEMANDE);
+    verifieEgalite("DIR_MPR12", evenementEtValeur->valeur, NEUTRE + 40);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MPR13", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
+    verifieEgalite("DIR_MPR14", evenementEtValeur->valeur, CONSIGNE(NEUTRE - 30));
+    verifieEgalite("DIR_MPR15", (int) defileMessageInterne(), 0);
+
+    // À la fin, les roues reviennent au neutre et le moteur est libéré:
+    DIRECTION_machine(&deplacementAtteint);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MPR21", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
+    verifieEgalite("DIR_MPR22", evenementEtValeur->valeur, NEUTRE_CONSIGNE);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MPR23", evenementEtValeur->evenement, VITESSE_DEMANDEE);
+    verifieEgalite("DIR_MPR24", evenementEtValeur->valeur, NEUTRE_CONSIGNE);
+    verifieEgalite("DIR_MPR25", (int) defileMessageInterne(), 0);
+
+    // Le comportement de fin ne s'applique qu'une fois:
+    DIRECTION_machine(&deplacementAtteint);
+    verifieEgalite("DIR_MPR26", (int) defileMessageInterne(), 0);
+
+    initialiseDirection();
+}
+
+void ignore_les_manoeuvres_inexistantes() {
+    initialiseMessagesInternes();
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+
+    receptionBus(ECRITURE_I2C_MANOEUVRE, 6);
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + NOMBRE_MANOEUVRES_PROGRAMMABLES);
+    verifieEgalite("DIR_MIN01", nombreDeManoeuvresAExecuter, 0);
+    verifieEgalite("DIR_MIN02", (int) defileMessageInterne(), 0);
+
+    // Définir une manoeuvre inexistante n'a pas d'effet:
+    receptionBus(ECRITURE_I2C_SELECTION_BLOC, 2);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, NEUTRE + 40);
+    verifieEgalite("DIR_MIN03", manoeuvres[2].distance, NEUTRE + 95);
+}
+
+void transmet_les_reglages_programmes_par_i2c() {
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+
+    // Les champs d'un réglage ne modifient aucune manoeuvre:
+    receptionBus(ECRITURE_I2C_SELECTION_BLOC, REGLAGE_FILTRE);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 11);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 1);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 2);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_REG01", evenementEtValeur->evenement, FILTRE_DEMANDE);
+    verifieEgalite("DIR_REG02", manoeuvresProgrammables[0].distance, NEUTRE);
+
+    // Les champs d'une manoeuvre ne transmettent aucun réglage:
+    receptionBus(ECRITURE_I2C_SELECTION_BLOC, MANOEUVRE_PROGRAMMABLE);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, NEUTRE + 40);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, NEUTRE - 30);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 20);
+    verifieEgalite("DIR_REG03", (int) defileMessageInterne(), 0);
+    verifieEgalite("DIR_REG04", manoeuvresProgrammables[0].distance, NEUTRE + 40);
+}
+
+/**
+ * Définit une manoeuvre programmable.
+ */
+void definitManoeuvre(unsigned char numero, 
+                      unsigned char distance, 
+                      unsigned char orientationRoues,
+                      unsigned char fin) {
+    receptionBus(ECRITURE_I2C_SELECTION_BLOC, numero);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, distance);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, orientationRoues);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 0);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, 0);
+    receptionBus(ECRITURE_I2C_CHAMP_BLOC, fin);
+}
+
+void enchaine_les_manoeuvres_sans_s_arreter() {
+    EvenementEtValeur baseDeTempsProfil = {BASE_DE_TEMPS_PROFIL, 0};
+    EvenementEtValeur deplacementAtteint = {DEPLACEMENT_ATTEINT, 0};
+    EvenementEtValeur *evenementEtValeur;
+    unsigned char n;
+
+    initialiseMessagesInternes();
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    definitManoeuvre(MANOEUVRE_PROGRAMMABLE + 0, NEUTRE + 40, NEUTRE + 50, MANOEUVRE_FIN_ENCHAINEE);
+    definitManoeuvre(MANOEUVRE_PROGRAMMABLE + 1, NEUTRE + 30, NEUTRE - 50, MANOEUVRE_FIN_ROUES_AU_NEUTRE);
+
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + 0);
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + 1);
+    defileMessageInterne();
+    defileMessageInterne();
+
+    // Le déplacement demandé démarre le profil (80 phases):
+    profilDemarre(80);
+
+    // Au premier pas, le déplacement de la suivante prolonge le profil:
+    DIRECTION_machine(&baseDeTempsProfil);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MEN01", evenementEtValeur->evenement, DEPLACEMENT_PROLONGE);
+    verifieEgalite("DIR_MEN02", evenementEtValeur->valeur, NEUTRE + 30);
+    verifieEgalite("DIR_MEN03", (int) defileMessageInterne(), 0);
+    verifieEgalite("DIR_MEN04", nombreDeManoeuvresAExecuter, 1);
+    profilProlonge(60);
+
+    // L'orientation change quand il ne reste que le déplacement de la suivante:
+    for (n = 0; n < 200; n++) {
+        profilAvance();
+        DIRECTION_machine(&baseDeTempsProfil);
+        evenementEtValeur = defileMessageInterne();
+        if (evenementEtValeur != 0) {
+            break;
+        }
+    }
+    verifieEgalite("DIR_MEN11", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
+    verifieEgalite("DIR_MEN12", evenementEtValeur->valeur, CONSIGNE(NEUTRE - 50));
+    verifieIntervale("DIR_MEN13", profilDistanceRestante(), 57, 60);
+
+    // Plus rien jusqu'à la fin du profil:
+    while (!profilTermine()) {
+        profilAvance();
+        DIRECTION_machine(&baseDeTempsProfil);
+    }
+    verifieEgalite("DIR_MEN21", (int) defileMessageInterne(), 0);
+
+    // La fin de la dernière manoeuvre s'applique:
+    DIRECTION_machine(&deplacementAtteint);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("DIR_MEN22", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
+    verifieEgalite("DIR_MEN23", evenementEtValeur->valeur, NEUTRE_CONSIGNE);
+    verifieEgalite("DIR_MEN24", nombreDeManoeuvresAExecuter, 0);
+
+    initialiseDirection();
+}
+
+void n_enchaine_pas_les_manoeuvres_de_sens_contraire() {
+    EvenementEtValeur baseDeTempsProfil = {BASE_DE_TEMPS_PROFIL, 0};
+
+    initialiseMessagesInternes();
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    definitManoeuvre(MANOEUVRE_PROGRAMMABLE + 0, NEUTRE + 40, NEUTRE, MANOEUVRE_FIN_ENCHAINEE);
+    definitManoeuvre(MANOEUVRE_PROGRAMMABLE + 1, NEUTRE - 30, NEUTRE, 0);
+
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + 0);
+    receptionBus(ECRITURE_I2C_MANOEUVRE, MANOEUVRE_PROGRAMMABLE + 1);
+    defileMessageInterne();
+    defileMessageInterne();
+    profilDemarre(80);
+    DIRECTION_machine(&baseDeTempsProfil);
+    verifieEgalite("DIR_MENC01", (int) defileMessageInterne(), 0);
+    verifieEgalite("DIR_MENC02", nombreDeManoeuvresAExecuter, 2);
+
+    // Sans indicateur, les manoeuvres ne s'enchaînent pas:
+    initialiseDirection();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
+    receptionBus(ECRITURE_I2C_MANOEUVRE, 2);
+    defileMessageInterne();
+    defileMessageInterne();
+    DIRECTION_machine(&baseDeTempsProfil);
+    verifieEgalite("DIR_MENC03", (int) defileMessageInterne(), 0);
+    verifieEgalite("DIR_MENC04", nombreDeManoeuvresAExecuter, 2);
+
+    while (!profilTermine()) {
+        profilAvance();
+    }
+    initialiseDirection();
+}
+
 void reinitialise_les_manoeuvres_si_commande_de_vitesse() {
     reinitialiseManoeuvres();
-    initialiseEvenements();
+    initialiseMessagesInternes();
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
     EvenementEtValeur *evenementEtValeur;
 
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
-    evenementEtValeur = defileEvenement();
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
+    evenementEtValeur = defileMessageInterne();
 
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     
     receptionBus(ECRITURE_I2C_VITESSE, 12);
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_MARVD0", evenementEtValeur->evenement, VITESSE_DEMANDEE);
-    verifieEgalite("DIR_MARVD1", evenementEtValeur->valeur, 12);
+    verifieEgalite("DIR_MARVD1", evenementEtValeur->valeur, CONSIGNE(12));
     verifieEgalite("DIR_MARVD2", nombreDeManoeuvresAExecuter, 0);       
-    verifieEgalite("DIR_MARVD3", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_MARVD3", (int) defileMessageInterne(), 0);
 }
 void reinitialise_les_manoeuvres_si_commande_de_orientation_des_roues() {
     reinitialiseManoeuvres();
-    initialiseEvenements();
+    initialiseMessagesInternes();
     busOuTelecommande = MODE_BUS_DE_COMMANDES;
     EvenementEtValeur *evenementEtValeur;
 
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
-    evenementEtValeur = defileEvenement();
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
+    evenementEtValeur = defileMessageInterne();
 
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     
     receptionBus(ECRITURE_I2C_DIRECTION, 12);
-    evenementEtValeur = defileEvenement();
+    evenementEtValeur = defileMessageInterne();
     verifieEgalite("DIR_MARDD0", evenementEtValeur->evenement, LECTURE_RC_GAUCHE_DROITE);
-    verifieEgalite("DIR_MARDD1", evenementEtValeur->valeur, 12);
+    verifieEgalite("DIR_MARDD1", evenementEtValeur->valeur, CONSIGNE(12));
     verifieEgalite("DIR_MARDD2", nombreDeManoeuvresAExecuter, 0);       
-    verifieEgalite("DIR_MARDD3", (int) defileEvenement(), 0);    
+    verifieEgalite("DIR_MARDD3", (int) defileMessageInterne(), 0);    
 }
 
 void reinitialise_les_manoeuvres_si_telecommande() {
@@ -526,19 +1186,96 @@ void reinitialise_les_manoeuvres_si_telecommande() {
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     receptionBus(ECRITURE_I2C_MANOEUVRE, 1);
     
-    receptionTelecommandeAvantArriere(10);
+    // L'interruption ne fait qu'annoncer le changement de mode:
+    receptionTelecommandeAvantArriere(CONSIGNE(10));
+    verifieEgalite("DIR_MART0", nombreDeManoeuvresAExecuter, 4);
     evenementEtValeur = defileEvenement();
-    verifieEgalite("DIR_MART0", evenementEtValeur->evenement, VITESSE_DEMANDEE);
-    verifieEgalite("DIR_MART1", evenementEtValeur->valeur, 10);
+    verifieEgalite("DIR_MART1", evenementEtValeur->evenement, TELECOMMANDE_ACTIVEE);
+
+    // La boucle principale annule les manoeuvres:
+    DIRECTION_machine(evenementEtValeur);
     verifieEgalite("DIR_MART2", nombreDeManoeuvresAExecuter, 0);       
-    verifieEgalite("DIR_MART3", (int) defileEvenement(), 0);
+    evenementEtValeur = defileEvenement();
+    verifieEgalite("DIR_MART3", evenementEtValeur->evenement, VITESSE_DEMANDEE);
+    verifieEgalite("DIR_MART4", evenementEtValeur->valeur, CONSIGNE(10));
+    verifieEgalite("DIR_MART5", (int) defileEvenement(), 0);
 }
 
 /**
  * Tests unitaires pour le positionnement des roues de direction.
  */
+void ramene_au_neutre_si_le_signal_de_la_telecommande_est_perdu() {
+    EvenementEtValeur *evenementEtValeur;
+    unsigned char n;
+
+    initialiseDirection();
+    initialiseEvenements();
+    receptionTelecommandeAvantArriere(CONSIGNE(NEUTRE + 50));
+    receptionTelecommandeGaucheDroite(CONSIGNE(NEUTRE + 60));
+    defileEvenement();
+    defileEvenement();
+
+    // Le canal gauche / droite continue, le canal avant / arrière s'arrête:
+    for (n = 0; n < DELAI_SECURITE_TELECOMMANDE - 1; n++) {
+        verifieSignalTelecommande();
+        receptionTelecommandeGaucheDroite(CONSIGNE(NEUTRE + 60));
+        defileEvenement();
+    }
+    verifieEgalite("DIR_SEC01", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_SEC02", i2cRegistres.valeurs[LECTURE_I2C_SECURITE_RC], 0);
+
+    verifieSignalTelecommande();
+    evenementEtValeur = defileEvenement();
+    verifieEgalite("DIR_SEC03", evenementEtValeur->evenement, VITESSE_DEMANDEE);
+    verifieEgalite("DIR_SEC04", evenementEtValeur->valeur, NEUTRE_CONSIGNE);
+    verifieEgalite("DIR_SEC05", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_SEC06", i2cRegistres.valeurs[LECTURE_I2C_SECURITE_RC], SECURITE_RC_AVANT_ARRIERE);
+
+    // La sécurité ne se déclenche qu'une fois:
+    verifieSignalTelecommande();
+    verifieEgalite("DIR_SEC07", (int) defileEvenement(), 0);
+
+    // Le signal revient:
+    receptionTelecommandeAvantArriere(CONSIGNE(NEUTRE + 50));
+    defileEvenement();
+    verifieEgalite("DIR_SEC11", i2cRegistres.valeurs[LECTURE_I2C_SECURITE_RC], 0);
+
+    // En mode bus, la perte du signal est seulement signalée:
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    for (n = 0; n < DELAI_SECURITE_TELECOMMANDE; n++) {
+        verifieSignalTelecommande();
+    }
+    verifieEgalite("DIR_SEC21", (int) defileEvenement(), 0);
+    verifieEgalite("DIR_SEC22", i2cRegistres.valeurs[LECTURE_I2C_SECURITE_RC], 
+            SECURITE_RC_AVANT_ARRIERE | SECURITE_RC_GAUCHE_DROITE);
+}
+
+void le_delai_de_securite_de_la_telecommande_est_configurable() {
+    initialiseDirection();
+    initialiseEvenements();
+    busOuTelecommande = MODE_BUS_DE_COMMANDES;
+    receptionBus(ECRITURE_I2C_DELAI_SECURITE_RC, 2);
+    busOuTelecommande = MODE_TELECOMMANDE;
+    receptionTelecommandeAvantArriere(NEUTRE_CONSIGNE);
+    receptionTelecommandeGaucheDroite(NEUTRE_CONSIGNE);
+    defileEvenement();
+    defileEvenement();
+
+    verifieSignalTelecommande();
+    verifieEgalite("DIR_SECD01", (int) defileEvenement(), 0);
+    verifieSignalTelecommande();
+    verifieNonZero("DIR_SECD02", (int) defileEvenement());
+    verifieNonZero("DIR_SECD03", (int) defileEvenement());
+    verifieEgalite("DIR_SECD04", i2cRegistres.valeurs[LECTURE_I2C_SECURITE_RC], 
+            SECURITE_RC_AVANT_ARRIERE | SECURITE_RC_GAUCHE_DROITE);
+
+    initialiseDirection();
+    initialiseEvenements();
+}
+
 void test_direction() {
     calcule_pwm_servo_roues_avant();
+    positionne_les_servos_auxiliaires();
     ignore_les_commandes_i2c_si_mode_telecommande();
     transmet_les_commandes_i2c();
     transmet_les_commandes_de_la_telecommande();
@@ -551,8 +1288,16 @@ void test_direction() {
     execute_la_suivante_manoeuvre_apres_avoir_complete_la_premiere();
     execute_un_arret_apres_avoir_complete_la_derniere_manoeuvre();
     ignore_les_manoeuvres_si_la_file_deborde();
+    l_interruption_ne_modifie_pas_la_vitesse_de_la_manoeuvre();
+    execute_les_manoeuvres_programmees_par_i2c();
+    ignore_les_manoeuvres_inexistantes();
+    transmet_les_reglages_programmes_par_i2c();
+    enchaine_les_manoeuvres_sans_s_arreter();
+    n_enchaine_pas_les_manoeuvres_de_sens_contraire();
     reinitialise_les_manoeuvres_si_commande_de_vitesse();
     reinitialise_les_manoeuvres_si_commande_de_orientation_des_roues();
     reinitialise_les_manoeuvres_si_telecommande();
+    ramene_au_neutre_si_le_signal_de_la_telecommande_est_perdu();
+    le_delai_de_securite_de_la_telecommande_est_configurable();
 }
 #endif
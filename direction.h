@@ -1,6 +1,44 @@
 #ifndef DIRECTION_H
 #define	DIRECTION_H
 
+/**
+ * Indicateurs de perte du signal de chaque canal de la télécommande,
+ * exposés sur le bus I2C (LECTURE_I2C_SECURITE_RC).
+ */
+typedef enum {
+    /** Le canal avant / arrière est perdu; la vitesse est au neutre. */
+    SECURITE_RC_AVANT_ARRIERE = 0x01,
+    /** Le canal gauche / droite est perdu; les roues sont au neutre. */
+    SECURITE_RC_GAUCHE_DROITE = 0x02
+} SecuriteRc;
+
+/** Nombre de manoeuvres programmables par le bus I2C. */
+#define NOMBRE_MANOEUVRES_PROGRAMMABLES 8
+
+/** 
+ * Numéro de la première manoeuvre programmable. Les manoeuvres 
+ * prédéfinies sont numérotées à partir de 0.
+ */
+#define MANOEUVRE_PROGRAMMABLE 0x80
+
+/**
+ * Comportement à la fin d'une manoeuvre, si aucune autre ne la suit.
+ * Sans indicateur, le moteur maintient la position atteinte et les 
+ * roues gardent leur orientation.
+ */
+typedef enum {
+    /** Ramène les roues au neutre. */
+    MANOEUVRE_FIN_ROUES_AU_NEUTRE = 0x01,
+    /** Passe le moteur en vitesse nulle, au lieu de maintenir la position. */
+    MANOEUVRE_FIN_MOTEUR_LIBRE = 0x02,
+    /**
+     * Enchaîne avec la manoeuvre suivante sans s'arrêter, si elle est
+     * déjà dans la file et qu'elle va dans le même sens. Les deux autres
+     * indicateurs ne s'appliquent alors pas.
+     */
+    MANOEUVRE_FIN_ENCHAINEE = 0x04
+} FinManoeuvre;
+
 /**
  * Machine à états pour réguler la position des roues avant (de direction).
  * @param ev Événement à traiter.
@@ -8,8 +46,9 @@
 void DIRECTION_machine(EvenementEtValeur *ev);
 
 void receptionBus(unsigned char address, unsigned char valeur);
-void receptionTelecommandeAvantArriere(unsigned char valeur);
-void receptionTelecommandeGaucheDroite(unsigned char valeur);
+void receptionTelecommandeAvantArriere(unsigned int valeur);
+void receptionTelecommandeGaucheDroite(unsigned int valeur);
+void verifieSignalTelecommande(void);
 void defileManoeuvre(void);
 void initialiseDirection();
 
@@ -33,6 +33,24 @@ void convertitEnMagnitudeEtDirection(unsigned char valeur,
     conversion->magnitude <<= 1;
 }
 
+/**
+ * Convertit une consigne de 12 bits en magnitude signée, exprimée en 
+ * seizièmes des unités de convertitEnMagnitudeEtDirection, avec la 
+ * même zone morte autour du neutre.
+ * @param consigne Une valeur entre 0 et CONSIGNE_MAX. NEUTRE_CONSIGNE
+ * est neutre.
+ * @return La magnitude, entre -4096 et +4094. Positive en marche avant.
+ */
+int convertitConsigne(unsigned int consigne) {
+    int v = (int) consigne - NEUTRE_CONSIGNE;
+    int zoneMorte = (int) CONSIGNE(5);
+
+    if ((v < zoneMorte) && (v > -zoneMorte)) {
+        return 0;
+    }
+    return v << 1;
+}
+
 /**
  * Soustrait deux magnitudes en tenant compte de leur direction.
  * @param a Magnitude A
@@ -189,6 +207,17 @@ void test_convertit_en_magnitude_et_direction() {
     verifieEgalite("PEV32", vitesseDemandee.magnitude, 255);
 }
 
+void test_convertit_consigne() {
+    verifieEgalite("PCO01", convertitConsigne(CONSIGNE(NEUTRE + 30)), 60 * 16);
+    verifieEgalite("PCO02", convertitConsigne(CONSIGNE(NEUTRE - 30)), -60 * 16);
+    verifieEgalite("PCO03", convertitConsigne(CONSIGNE(NEUTRE + 30) + 3), 60 * 16 + 6);
+    verifieEgalite("PCO11", convertitConsigne(NEUTRE_CONSIGNE + CONSIGNE(5) - 1), 0);
+    verifieEgalite("PCO12", convertitConsigne(NEUTRE_CONSIGNE - CONSIGNE(5) + 1), 0);
+    verifieEgalite("PCO13", convertitConsigne(NEUTRE_CONSIGNE + CONSIGNE(5)), 10 * 16);
+    verifieEgalite("PCO21", convertitConsigne(0), -4096);
+    verifieEgalite("PCO22", convertitConsigne(CONSIGNE_MAX), 4094);
+}
+
 void test_compare_A_et_B() {
     MagnitudeEtDirection a,b;
 
@@ -328,6 +357,7 @@ void test_opere_A_plus_B() {
  */
 void test_domaine() {
     test_convertit_en_magnitude_et_direction();
+    test_convertit_consigne();
     test_compare_A_et_B();
     test_opere_A_moins_B();
     test_opere_A_plus_B();
@@ -16,6 +16,21 @@
  */
 #define NEUTRE 128 
 
+/**
+ * Position centrale d'une consigne de 12 bits (vitesse demandée,
+ * orientation des roues), entre 0 et CONSIGNE_MAX.
+ */
+#define NEUTRE_CONSIGNE 2048
+
+/** Valeur maximum d'une consigne de 12 bits. */
+#define CONSIGNE_MAX 4095
+
+/** 
+ * Convertit une valeur de 8 bits (entre 0 et 255, NEUTRE au centre)
+ * en consigne de 12 bits.
+ */
+#define CONSIGNE(valeur) (((unsigned int) (valeur)) << 4)
+
 /**
  * Liste des événements du système.
  */
@@ -67,6 +82,45 @@ typedef enum EVENEMENT {
             
     /** La vitesse actuels du moteur a été mesurée. */
     VITESSE_MESUREE,
+
+    /** L'intervalle de temps du générateur de profil de déplacement s'est écoulé. */
+    BASE_DE_TEMPS_PROFIL,
+
+    /** La limite de courant du moteur a été spécifiée / modifiée (en Ampères). */
+    LIMITE_COURANT_DEMANDEE,
+
+    /** La température de début de réduction de puissance a été spécifiée (en °C). */
+    TEMPERATURE_DEBUT_REDUCTION_DEMANDEE,
+
+    /** La température de réduction de puissance maximum a été spécifiée (en °C). */
+    TEMPERATURE_FIN_REDUCTION_DEMANDEE,
+
+    /** Démarre (valeur non nulle) ou termine (zéro) la calibration de la télécommande. */
+    CALIBRATION_RC_DEMANDEE,
+
+    /** La position du servo auxiliaire 1 a été spécifiée (consigne de 12 bits). */
+    SERVO_AUXILIAIRE_1_DEMANDE,
+
+    /** La position du servo auxiliaire 2 a été spécifiée (consigne de 12 bits). */
+    SERVO_AUXILIAIRE_2_DEMANDE,
+
+    /** La période d'émission de la télémétrie a été spécifiée (en bases de temps, zéro l'arrête). */
+    TELEMETRIE_PERIODE_DEMANDEE,
+
+    /** Le déplacement en cours est prolongé sans s'arrêter (même codage que DEPLACEMENT_DEMANDE). */
+    DEPLACEMENT_PROLONGE,
+
+    /** La télécommande prend le contrôle: les manoeuvres en attente sont annulées. */
+    TELECOMMANDE_ACTIVEE,
+
+    /** Le filtre d'un canal analogique a été spécifié (voir FILTRE_DEMANDE_VALEUR). */
+    FILTRE_DEMANDE,
+
+    /** Le point d'échantillonnage du courant a été spécifié (en 256èmes du temps de conduction). */
+    POINT_D_ECHANTILLONNAGE_DEMANDE,
+
+    /** L'accélération (octet fort) et le jerk (octet faible) du profil de déplacement ont été spécifiés. */
+    PROFIL_DEMANDE,
             
 } Evenement;
 
@@ -88,10 +142,34 @@ typedef enum DIRECTION {
 typedef struct EVENEMENT_ET_VALEUR {
     /** L'événement. */
     enum EVENEMENT evenement;
-    /** Sa valeur associée. */
-    unsigned char valeur;
+    /** Sa valeur associée, sur 16 bits pour les lectures A/D. */
+    unsigned int valeur;
 } EvenementEtValeur;
 
+/** Lecture maximum du convertisseur A/D (10 bits). */
+#define LECTURE_AD_MAX 1023
+
+/** Extrait la lecture A/D de la valeur d'un événement LECTURE_xxx. */
+#define LECTURE_AD(valeur) ((valeur) & 0x03FF)
+
+/** 
+ * Extrait la phase commutée pendant une lecture de courant, entre
+ * 1 et 6, de la valeur d'un événement LECTURE_COURANT.
+ */
+#define PHASE_LECTURE_AD(valeur) ((unsigned char) ((valeur) >> 12))
+
+/** 
+ * Compose la valeur d'un événement FILTRE_DEMANDE: le canal (ANx) sur
+ * l'octet fort, puis le type de filtre et son paramètre sur 4 bits.
+ */
+#define FILTRE_DEMANDE_VALEUR(canal, type, parametre) \
+    ((((unsigned int) (canal)) << 8) | (((type) & 0x0F) << 4) | ((parametre) & 0x0F))
+
+/** Extraient le canal, le type et le paramètre d'un événement FILTRE_DEMANDE. */
+#define FILTRE_DEMANDE_CANAL(valeur) ((unsigned char) ((valeur) >> 8))
+#define FILTRE_DEMANDE_TYPE(valeur) ((unsigned char) (((valeur) >> 4) & 0x0F))
+#define FILTRE_DEMANDE_PARAMETRE(valeur) ((unsigned char) ((valeur) & 0x0F))
+
 /** 
  * Décrit une valeur en termes de direction et de magnitude. 
  * Sert à spécifier des vitesses ou des puissances.
@@ -103,6 +181,7 @@ typedef struct {
 
 void convertitEnMagnitudeEtDirection(unsigned char valeur, 
                                      MagnitudeEtDirection *conversion);
+int convertitConsigne(unsigned int consigne);
 int compareAetB(MagnitudeEtDirection *a, 
                 MagnitudeEtDirection *b);
 unsigned char opereAmoinsB(MagnitudeEtDirection *a, 
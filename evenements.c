@@ -20,9 +20,10 @@ void initialiseEvenements() {
  * @param evenement événement.
  * @param valeur Valeur associée.
  */
-void enfileEvenement(enum EVENEMENT evenement, unsigned char valeur) {
+void enfileEvenement(enum EVENEMENT evenement, unsigned int valeur) {
     fileEnfile(&fileEvenementEtValeur, evenement);
-    fileEnfile(&fileEvenementEtValeur, valeur);
+    fileEnfile(&fileEvenementEtValeur, (char) valeur);
+    fileEnfile(&fileEvenementEtValeur, (char) (valeur >> 8));
 }
 
 /**
@@ -37,7 +38,8 @@ struct EVENEMENT_ET_VALEUR *defileEvenement() {
     }
 
     ev.evenement = fileDefile(&fileEvenementEtValeur);
-    ev.valeur = fileDefile(&fileEvenementEtValeur);
+    ev.valeur = (unsigned char) fileDefile(&fileEvenementEtValeur);
+    ev.valeur |= ((unsigned int) (unsigned char) fileDefile(&fileEvenementEtValeur)) << 8;
     
     return &ev;
 }
@@ -91,6 +93,16 @@ void test_evenements() {
     verifieEgalite("Q-B-22", 120, ev1->valeur);
 
     verifieEgalite("Q-B-31", (int) defileEvenement(), 0);
+
+    // Valeurs de 16 bits:
+    enfileEvenement(LECTURE_COURANT, 1023);
+    enfileEvenement(LECTURE_COURANT, 0xA5C3);
+    ev1 = defileEvenement();
+    verifieEgalite("Q-E-01", ev1->valeur, 1023);
+    ev1 = defileEvenement();
+    verifieEgalite("Q-E-02", ev1->valeur, 0xA5C3);
+    verifieEgalite("Q-E-03", LECTURE_AD(ev1->valeur), 0x1C3);
+    verifieEgalite("Q-E-04", PHASE_LECTURE_AD(ev1->valeur), 0xA);
     verifieEgalite("Q-B-32", (int) defileEvenement(), 0);
 
     // Teste plusieurs tours de file:
@@ -13,7 +13,7 @@ void initialiseEvenements();
  * @param evenement événement.
  * @param valeur Valeur associée.
  */
-void enfileEvenement(enum EVENEMENT evenement, unsigned char valeur);
+void enfileEvenement(enum EVENEMENT evenement, unsigned int valeur);
 
 /**
  * Récupère un événement de la file.
@@ -38,6 +38,17 @@ char fileDefile(File *file) {
     return 0;
 }
 
+/**
+ * Consulte le prochain caractère à défiler, sans le défiler.
+ * @return Le caractère, ou 0 si la file est vide.
+ */
+char fileConsulte(File *file) {
+    if (!file->fileVide) {
+        return file->file[file->fileSortie];
+    }
+    return 0;
+}
+
 /**
  * Indique si la file est vide.
  */
@@ -52,6 +63,23 @@ char fileEstPleine(File *file) {
     return file->filePleine;
 }
 
+/**
+ * Calcule le nombre de caractères qui peuvent encore être enfilés.
+ * @return Nombre de caractères, entre 0 et FILE_TAILLE.
+ */
+unsigned char fileEspaceDisponible(File *file) {
+    if (file->filePleine) {
+        return 0;
+    }
+    if (file->fileVide) {
+        return FILE_TAILLE;
+    }
+    if (file->fileSortie > file->fileEntree) {
+        return file->fileSortie - file->fileEntree;
+    }
+    return FILE_TAILLE - (file->fileEntree - file->fileSortie);
+}
+
 /**
  * Vide et réinitialise la file.
  */
@@ -119,9 +147,53 @@ void testDebordePuisRecupereLesCaracteres() {
     verifieEgalite("FDB003", c, FILE_TAILLE);
 }
 
+void testEspaceDisponible() {
+    File file;
+    unsigned char n;
+    
+    fileReinitialise(&file);
+    verifieEgalite("FED001", fileEspaceDisponible(&file), FILE_TAILLE);
+
+    for (n = 0; n < FILE_TAILLE - 8; n++) {
+        fileEnfile(&file, n);
+    }
+    verifieEgalite("FED002", fileEspaceDisponible(&file), 8);
+    while(!fileEstVide(&file)) {
+        fileDefile(&file);
+    }
+    verifieEgalite("FED003", fileEspaceDisponible(&file), FILE_TAILLE);
+
+    // L'entrée fait le tour de la file, et se retrouve avant la sortie:
+    for (n = 0; n < 10; n++) {
+        fileEnfile(&file, n);
+    }
+    verifieEgalite("FED004", fileEspaceDisponible(&file), FILE_TAILLE - 10);
+    while(!fileEstPleine(&file)) {
+        fileEnfile(&file, n);
+    }
+    verifieEgalite("FED005", fileEspaceDisponible(&file), 0);
+}
+
+void testConsulteSansDefiler() {
+    File file;
+    fileReinitialise(&file);
+
+    verifieEgalite("FCO001", fileConsulte(&file), 0);
+    fileEnfile(&file, 10);
+    fileEnfile(&file, 20);
+    verifieEgalite("FCO002", fileConsulte(&file), 10);
+    verifieEgalite("FCO003", fileConsulte(&file), 10);
+    verifieEgalite("FCO004", fileDefile(&file), 10);
+    verifieEgalite("FCO005", fileConsulte(&file), 20);
+    fileDefile(&file);
+    verifieEgalite("FCO006", fileConsulte(&file), 0);
+}
+
 int test_file() {
     testEnfileEtDefile();
     testEnfileEtDefileBeaucoupDeCaracteres();
     testDebordePuisRecupereLesCaracteres();
+    testEspaceDisponible();
+    testConsulteSansDefiler();
 }
 #endif
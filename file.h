@@ -1,7 +1,8 @@
 #ifndef __FILE_H
 #define	__FILE_H
 
-#define FILE_TAILLE 32
+/** Taille de la file, en octets: 16 événements de 3 octets. */
+#define FILE_TAILLE 48
 
 typedef struct {
     /** Espace de mémoire pour stocker la file. */
@@ -22,8 +23,10 @@ typedef struct {
 
 void fileEnfile(File *file, char c);
 char fileDefile(File *file);
+char fileConsulte(File *file);
 char fileEstVide(File *file);
 char fileEstPleine(File *file);
+unsigned char fileEspaceDisponible(File *file);
 void fileReinitialise(File *file);
 
 #ifdef TEST
@@ -0,0 +1,182 @@
+#include "filtre.h"
+#include "test.h"
+
+/**
+ * Configure le filtre, et oublie les lectures précédentes.
+ * @param filtre Le filtre.
+ * @param type Le type de filtre.
+ * @param parametre Pour FILTRE_IIR, le décalage du coefficient (1 à 6, 
+ * pour que les lectures de 10 bits cumulées tiennent sur 16 bits).
+ * Pour FILTRE_MOYENNE, le décalage du nombre de lectures (1 à 3, pour
+ * 2, 4 ou 8 lectures). Ignoré pour les autres types.
+ */
+void filtreConfigure(Filtre *filtre, TypeFiltre type, unsigned char parametre) {
+    if ((type == FILTRE_MOYENNE) && ((1 << parametre) > FILTRE_TAILLE_FENETRE)) {
+        parametre = 3;
+    }
+    if ((type == FILTRE_IIR) && (parametre > 6)) {
+        parametre = 6;
+    }
+    filtre->type = type;
+    filtre->parametre = parametre;
+    filtre->indice = 0;
+    filtre->vide = 1;
+    filtre->cumul = 0;
+}
+
+/**
+ * Calcule la médiane de trois valeurs.
+ */
+static unsigned int mediane3(unsigned int a, unsigned int b, unsigned int c) {
+    if (a > b) {
+        if (b > c) {
+            return b;
+        }
+        return (a > c) ? c : a;
+    }
+    if (a > c) {
+        return a;
+    }
+    return (b > c) ? c : b;
+}
+
+/**
+ * Calcule la médiane de cinq valeurs, avec un réseau de tri partiel.
+ */
+static unsigned int mediane5(unsigned int *fenetre) {
+    unsigned int a = fenetre[0], b = fenetre[1], c = fenetre[2];
+    unsigned int d = fenetre[3], e = fenetre[4], t;
+
+    // Ordonne (a, b) et (d, e), puis élimine le plus petit des deux
+    // minimums et le plus grand des deux maximums:
+    if (a > b) { t = a; a = b; b = t; }
+    if (d > e) { t = d; d = e; e = t; }
+    if (a < d) { a = d; }
+    if (b > e) { b = e; }
+    // La médiane des cinq est la médiane des trois restants:
+    return mediane3(a, b, c);
+}
+
+/**
+ * Passe une lecture à travers le filtre.
+ * La première lecture initialise l'état du filtre, pour éviter une 
+ * rampe au démarrage.
+ * @param filtre Le filtre.
+ * @param lecture La lecture.
+ * @return La lecture filtrée.
+ */
+unsigned int filtreApplique(Filtre *filtre, unsigned int lecture) {
+    unsigned char n;
+
+    if (filtre->vide) {
+        filtre->vide = 0;
+        for (n = 0; n < FILTRE_TAILLE_FENETRE; n++) {
+            filtre->fenetre[n] = lecture;
+        }
+        filtre->cumul = (unsigned int) lecture << filtre->parametre;
+    }
+
+    switch (filtre->type) {
+        case FILTRE_IIR:
+            filtre->cumul -= filtre->cumul >> filtre->parametre;
+            filtre->cumul += lecture;
+            return filtre->cumul >> filtre->parametre;
+
+        case FILTRE_MEDIANE_3:
+            filtre->fenetre[filtre->indice] = lecture;
+            if (++filtre->indice >= 3) {
+                filtre->indice = 0;
+            }
+            return mediane3(filtre->fenetre[0], filtre->fenetre[1], filtre->fenetre[2]);
+
+        case FILTRE_MEDIANE_5:
+            filtre->fenetre[filtre->indice] = lecture;
+            if (++filtre->indice >= 5) {
+                filtre->indice = 0;
+            }
+            return mediane5(filtre->fenetre);
+
+        case FILTRE_MOYENNE:
+            filtre->cumul -= filtre->fenetre[filtre->indice];
+            filtre->cumul += lecture;
+            filtre->fenetre[filtre->indice] = lecture;
+            if (++filtre->indice >= (1 << filtre->parametre)) {
+                filtre->indice = 0;
+            }
+            return filtre->cumul >> filtre->parametre;
+
+        default:
+            return lecture;
+    }
+}
+
+#ifdef TEST
+void filtre_iir_du_premier_ordre() {
+    Filtre filtre;
+
+    filtreConfigure(&filtre, FILTRE_IIR, 2);
+    verifieEgalite("FIIR01", filtreApplique(&filtre, 100), 100);
+    verifieEgalite("FIIR02", filtreApplique(&filtre, 100), 100);
+    verifieEgalite("FIIR03", filtreApplique(&filtre, 200), 125);
+    verifieEgalite("FIIR04", filtreApplique(&filtre, 200), 143);
+    verifieEgalite("FIIR05", filtreApplique(&filtre, 200), 158);
+
+    filtreConfigure(&filtre, FILTRE_IIR, 4);
+    verifieEgalite("FIIR11", filtreApplique(&filtre, 255), 255);
+    verifieEgalite("FIIR12", filtreApplique(&filtre, 0), 239);
+
+    // Le décalage est limité, pour ne pas déborder avec 10 bits:
+    filtreConfigure(&filtre, FILTRE_IIR, 7);
+    verifieEgalite("FIIR21", filtre.parametre, 6);
+    verifieEgalite("FIIR22", filtreApplique(&filtre, 1023), 1023);
+    verifieEgalite("FIIR23", filtreApplique(&filtre, 1023), 1023);
+}
+
+void filtre_median() {
+    Filtre filtre;
+
+    filtreConfigure(&filtre, FILTRE_MEDIANE_3, 0);
+    verifieEgalite("FMED01", filtreApplique(&filtre, 100), 100);
+    verifieEgalite("FMED02", filtreApplique(&filtre, 250), 100);
+    verifieEgalite("FMED03", filtreApplique(&filtre, 102), 102);
+    verifieEgalite("FMED04", filtreApplique(&filtre, 104), 104);
+    verifieEgalite("FMED05", filtreApplique(&filtre, 0), 102);
+
+    filtreConfigure(&filtre, FILTRE_MEDIANE_5, 0);
+    verifieEgalite("FMED11", filtreApplique(&filtre, 100), 100);
+    verifieEgalite("FMED12", filtreApplique(&filtre, 250), 100);
+    verifieEgalite("FMED13", filtreApplique(&filtre, 0), 100);
+    verifieEgalite("FMED14", filtreApplique(&filtre, 110), 100);
+    verifieEgalite("FMED15", filtreApplique(&filtre, 120), 110);
+    verifieEgalite("FMED16", filtreApplique(&filtre, 130), 120);
+    verifieEgalite("FMED17", filtreApplique(&filtre, 5), 110);
+    verifieEgalite("FMED18", filtreApplique(&filtre, 140), 120);
+}
+
+void filtre_moyenne_glissante() {
+    Filtre filtre;
+
+    filtreConfigure(&filtre, FILTRE_MOYENNE, 2);
+    verifieEgalite("FMOY01", filtreApplique(&filtre, 100), 100);
+    verifieEgalite("FMOY02", filtreApplique(&filtre, 140), 110);
+    verifieEgalite("FMOY03", filtreApplique(&filtre, 140), 120);
+    verifieEgalite("FMOY04", filtreApplique(&filtre, 140), 130);
+    verifieEgalite("FMOY05", filtreApplique(&filtre, 140), 140);
+    verifieEgalite("FMOY06", filtreApplique(&filtre, 140), 140);
+
+    filtreConfigure(&filtre, FILTRE_MOYENNE, 5);
+    verifieEgalite("FMOY11", filtre.parametre, 3);
+    verifieEgalite("FMOY12", filtreApplique(&filtre, 1023), 1023);
+    verifieEgalite("FMOY13", filtreApplique(&filtre, 1015), 1022);
+
+    filtreConfigure(&filtre, FILTRE_AUCUN, 0);
+    verifieEgalite("FAUC01", filtreApplique(&filtre, 12), 12);
+    verifieEgalite("FAUC02", filtreApplique(&filtre, 200), 200);
+}
+
+void test_filtre() {
+    filtre_iir_du_premier_ordre();
+    filtre_median();
+    filtre_moyenne_glissante();
+}
+#endif
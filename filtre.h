@@ -0,0 +1,48 @@
+#ifndef __FILTRE_H
+#define __FILTRE_H
+
+/** Taille maximum de la fenêtre des filtres médian et moyenne. */
+#define FILTRE_TAILLE_FENETRE 8
+
+/**
+ * Types de filtres applicables aux lectures.
+ */
+typedef enum {
+    /** Pas de filtre: la sortie est l'entrée. */
+    FILTRE_AUCUN,
+    /** Premier ordre: y += (x - y) / 2^parametre (jusqu'à 6). */
+    FILTRE_IIR,
+    /** Médiane des 3 dernières lectures. */
+    FILTRE_MEDIANE_3,
+    /** Médiane des 5 dernières lectures. */
+    FILTRE_MEDIANE_5,
+    /** Moyenne des 2^parametre dernières lectures (jusqu'à 8). */
+    FILTRE_MOYENNE
+} TypeFiltre;
+
+/**
+ * État d'un filtre.
+ */
+typedef struct {
+    /** Type de filtre (voir TypeFiltre). */
+    unsigned char type;
+    /** Décalage du filtre IIR, ou de la moyenne. */
+    unsigned char parametre;
+    /** Position de la prochaine lecture dans la fenêtre. */
+    unsigned char indice;
+    /** Indique que le filtre n'a encore reçu aucune lecture. */
+    unsigned char vide;
+    /** IIR: sortie multipliée par 2^parametre. Moyenne: somme de la fenêtre. */
+    unsigned int cumul;
+    /** Dernières lectures, pour les filtres médian et moyenne. */
+    unsigned int fenetre[FILTRE_TAILLE_FENETRE];
+} Filtre;
+
+void filtreConfigure(Filtre *filtre, TypeFiltre type, unsigned char parametre);
+unsigned int filtreApplique(Filtre *filtre, unsigned int lecture);
+
+#ifdef TEST
+void test_filtre();
+#endif
+
+#endif
@@ -5,6 +5,28 @@
 
 File fileEmission;
 
+/** Registres en cours de mise à jour. */
+I2cRegistres i2cRegistres;
+
+/** Nombre d'instantanés de la télémétrie. */
+#define I2C_NOMBRE_D_INSTANTANES 3
+
+/**
+ * Instantanés publiés de la télémétrie. Il en faut trois: celui que 
+ * l'esclave est en train de lire, le plus récent, et celui où la 
+ * boucle principale copie la publication suivante.
+ */
+static I2cRegistres i2cInstantanes[I2C_NOMBRE_D_INSTANTANES];
+
+/** Instantané le plus récent. Seule la boucle principale le modifie. */
+static unsigned char i2cInstantanePublie = 0;
+
+/** Instantané en cours de lecture. Seule l'interruption le modifie. */
+static unsigned char i2cInstantaneLu = 0;
+
+/** Numéro de séquence de la dernière publication. */
+static unsigned char i2cSequenceTelemetrie = 0;
+
 /**
  * @return 255 / -1 si il reste des données à émettre.
  */
@@ -37,20 +59,136 @@ typedef enum {
 
 static EtatMaitreI2C etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
 
+/** 
+ * Générateur de bauds du maître: 100KHz avec Fosc = 64MHz 
+ * (SSP2ADD = Fosc / (4 * 100KHz) - 1).
+ */
+#define I2C_GENERATEUR_DE_BAUDS_MAITRE 159
+
+/** 
+ * Indique si le MSSP2 est en mode maître. Il n'y passe que le temps 
+ * de vider la file d'émission, et redevient esclave ensuite.
+ */
+static unsigned char emissionEnCours = 0;
+
+/**
+ * Passe le MSSP2 en mode maître.
+ */
+static void modeMaitre() {
+    SSP2CON1bits.SSPEN = 0;
+    SSP2ADD = I2C_GENERATEUR_DE_BAUDS_MAITRE;
+    SSP2CON1bits.SSPM = 0b1000;         // Maître I2C.
+    SSP2CON1bits.SSPEN = 1;
+    emissionEnCours = 255;
+}
+
+/**
+ * Rétablit le MSSP2 en mode esclave.
+ */
+static void modeEsclave() {
+    SSP2CON1bits.SSPEN = 0;
+    SSP2ADD = I2C_ADRESSE_DE_BASE;
+    SSP2CON1bits.SSPM = 0b1110;         // Esclave I2C, adresse de 7 bits.
+    SSP2CON1bits.SSPEN = 1;
+    emissionEnCours = 0;
+}
+
+/**
+ * @return 255 / -1 si le MSSP2 est en mode maître, et les 
+ * interruptions doivent être traitées par i2cMaitre.
+ */
+unsigned char i2cEmissionEnCours() {
+    return emissionEnCours;
+}
+
+/**
+ * Démarre l'émission des commandes en attente, si le MSSP2 n'est pas
+ * déjà en train de les émettre, et si aucun autre maître n'occupe
+ * le bus.
+ */
+void i2cDemarreEmission() {
+    if (!emissionEnCours 
+            && i2cDonneesDisponiblesPourEmission() 
+            && !SSP2STATbits.S) {
+        etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
+        modeMaitre();
+        SSP2CON2bits.SEN = 1;
+    }
+}
+
+/**
+ * Calcule le nombre de commandes d'un seul octet qui peuvent encore
+ * être préparées pour émission. Chaque commande occupe l'adresse, le
+ * nombre d'octets, puis les octets eux-mêmes.
+ * @return Nombre de commandes.
+ */
+unsigned char i2cPlaceDisponiblePourEmission() {
+    return fileEspaceDisponible(&fileEmission) / 3;
+}
+
+/**
+ * Prépare l'émission d'une trame de plusieurs octets, écrits en une
+ * seule transaction à l'adresse indiquée.
+ * La fonction revient immédiatement, sans attendre que la trame
+ * soit transmise. Si la file d'émission n'a pas la place pour toute
+ * la trame, rien n'est préparé.
+ * Doit être appelée depuis la boucle principale: l'interruption du 
+ * MSSP2 est suspendue le temps de modifier la file d'émission, et ne
+ * voit jamais une trame incomplète.
+ * @param adresse Adresse de l'esclave. Si le bit moins signifiant 
+ * est 1, le maître lit un seul octet sur l'esclave, et les octets 
+ * n'ont pas d'effet.
+ * @param octets Les octets à écrire.
+ * @param nombre Nombre d'octets, au moins 1.
+ * @return 255 / -1 si la trame est préparée, 0 si elle est perdue.
+ */
+unsigned char i2cPrepareTramePourEmission(I2cAdresse adresse, 
+                                          const unsigned char *octets, 
+                                          unsigned char nombre) {
+    unsigned char preparee = 0;
+    unsigned char n;
+
+    if (nombre == 0) {
+        return 0;
+    }
+    PIE3bits.SSP2IE = 0;
+    if (fileEspaceDisponible(&fileEmission) >= nombre + 2) {
+        fileEnfile(&fileEmission, adresse);
+        fileEnfile(&fileEmission, nombre);
+        for (n = 0; n < nombre; n++) {
+            fileEnfile(&fileEmission, octets[n]);
+        }
+        preparee = 255;
+    }
+    PIE3bits.SSP2IE = 1;
+    i2cDemarreEmission();
+    return preparee;
+}
+
 /**
  * Prépare l'émission de la commande indiquée.
  * La fonction revient immédiatement, sans attendre que la commande
- * soit transmise.
+ * soit transmise. Si la file d'émission est pleine, la commande 
+ * est perdue.
+ * Doit être appelée depuis la boucle principale (voir 
+ * i2cPrepareTramePourEmission).
  * @param adresse Adresse de l'esclave. Si le bit moins signifiant 
  * est 1, le maître lit sur l'esclave (lecture).
  * @param valeur Valeur associée. Dans une opération de lecture, cette
  * valeur n'a pas d'effet.
  */
 void i2cPrepareCommandePourEmission(I2cAdresse adresse, unsigned char valeur) {
-    fileEnfile(&fileEmission, adresse);
-    fileEnfile(&fileEmission, valeur);
-    if (etatMaitre == I2C_MASTER_EMISSION_ADRESSE) {
-        SSP2CON2bits.SEN = 1;
+    i2cPrepareTramePourEmission(adresse, &valeur, 1);
+}
+
+/**
+ * Retire de la file d'émission les octets restants de la trame en
+ * cours.
+ * @param nombre Nombre d'octets à retirer.
+ */
+static void abandonneOctets(unsigned char nombre) {
+    while (nombre-- > 0) {
+        i2cRecupereCaracterePourEmission();
     }
 }
 
@@ -72,14 +210,22 @@ static I2cRappelCommande rappelCommande = faitRienDuTout;
  * Établit la fonction à appeler pour compléter l'exécution 
  * d'une commande I2C.
  * Le maître appelle cette fonction pour terminer l'exécution 
- * d'une commande de lecture. L'esclave appelle cette fonction pour 
- * gérer l'exécution d'une commande d'écriture.
+ * d'une commande de lecture. Pour les commandes d'écriture reçues par
+ * l'esclave, elle est appelée par i2cTraiteCommandes.
  * @param r La fonction à appeler.
  */
 void i2cRappelCommande(I2cRappelCommande r) {
     rappelCommande = r;
 }
 
+/** Nombre d'octets de la trame en cours qui restent dans la file. */
+static unsigned char octetsAEmettre = 0;
+
+/**
+ * Automate maître I2C. Chaque trame de la file d'émission est émise
+ * dans une seule transaction: l'adresse, puis tous ses octets en
+ * écriture, ou un seul octet en lecture.
+ */
 void i2cMaitre() {
     static unsigned char adresse; // Adresse associée à la commande en cours.
     
@@ -87,6 +233,7 @@ void i2cMaitre() {
         case I2C_MASTER_EMISSION_ADRESSE:
             if (i2cDonneesDisponiblesPourEmission()) {
                 adresse = i2cRecupereCaracterePourEmission();
+                octetsAEmettre = i2cRecupereCaracterePourEmission();
                 if (adresse & 1) {
                     etatMaitre = I2C_MASTER_PREPARE_RECEPTION_DONNEE;
                 } else {
@@ -97,13 +244,16 @@ void i2cMaitre() {
             break;
             
         case I2C_MASTER_EMISSION_DONNEE:
-            etatMaitre = I2C_MASTER_EMISSION_STOP;
+            if (--octetsAEmettre == 0) {
+                etatMaitre = I2C_MASTER_EMISSION_STOP;
+            }
             SSP2BUF = i2cRecupereCaracterePourEmission();
             break;
 
         case I2C_MASTER_PREPARE_RECEPTION_DONNEE:
             etatMaitre = I2C_MASTER_RECEPTION_DONNEE;
-            i2cRecupereCaracterePourEmission();
+            abandonneOctets(octetsAEmettre);
+            octetsAEmettre = 0;
             SSP2CON2bits.RCEN = 1;  // MMSP en réception.
             break;
             
@@ -124,6 +274,8 @@ void i2cMaitre() {
             etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
             if (i2cDonneesDisponiblesPourEmission()) {
                 SSP2CON2bits.SEN = 1;
+            } else {
+                modeEsclave();
             }
             break;
     }
@@ -143,51 +295,282 @@ unsigned char convertitEnAdresseLocale(unsigned char adresse) {
 /**
  * L'esclave rendra la valeur indiquée à prochaine lecture de 
  * l'adresse indiquée sur le bus I2C.
- * @param adresse Adresse locale, entre 0 et 4 (l'adresse locale 
- * est constituée des 2 bits moins signifiants de l'adresse 
- * demandée par le maître).
+ * @param adresse Adresse locale, entre 0 et 15 (l'adresse locale 
+ * est constituée des 4 bits moins signifiants de l'adresse 
+ * demandée par le maître), ou registre accessible en lecture groupée.
  * @param valeur La valeur.
  */
 void i2cExposeValeur(unsigned char adresse, unsigned char valeur) {
-    i2cValeursExposees[adresse & I2C_MASQUE_ADRESSES_LOCALES] = valeur;
+    i2cRegistres.valeurs[adresse & I2C_MASQUE_REGISTRES] = valeur;
+}
+
+/**
+ * Publie l'état actuel des registres, accompagné d'un nouveau numéro 
+ * de séquence. Toutes les lectures commencées après la publication
+ * rendent des valeurs de ce même instantané.
+ * La copie se fait dans un instantané que l'esclave n'est pas en 
+ * train de lire, et qu'il ne peut pas commencer à lire avant la fin de
+ * la copie: il n'y a pas besoin de bloquer les interruptions.
+ * Doit être appelée depuis la boucle principale.
+ */
+void i2cPublieTelemetrie() {
+    unsigned char lu = i2cInstantaneLu;
+    unsigned char libre = 0;
+    unsigned char n;
+
+    while ((libre == i2cInstantanePublie) || (libre == lu)) {
+        libre++;
+    }
+
+    i2cRegistres.telemetrie.sequence = ++i2cSequenceTelemetrie;
+    for (n = 0; n < I2C_NOMBRE_DE_REGISTRES; n++) {
+        i2cInstantanes[libre].valeurs[n] = i2cRegistres.valeurs[n];
+    }
+    i2cInstantanePublie = libre;
+}
+
+/**
+ * Calcule le CRC-8 utilisé par le PEC du SMBus (polynôme 
+ * x^8 + x^2 + x + 1).
+ * @param crc CRC des octets précédents (0 pour le premier).
+ * @param octet Octet suivant.
+ * @return CRC mis à jour.
+ */
+unsigned char i2cCrc8(unsigned char crc, unsigned char octet) {
+    unsigned char n;
+
+    crc ^= octet;
+    for (n = 0; n < 8; n++) {
+        if (crc & 0x80) {
+            crc = (crc << 1) ^ 0x07;
+        } else {
+            crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+/** Différent de zéro si les commandes doivent être suivies du PEC. */
+static unsigned char pecActif = 0;
+
+/**
+ * Nombre d'octets de données reçus depuis l'adresse. Avec le PEC, la
+ * commande est complète après deux octets: la valeur, puis le PEC.
+ */
+static unsigned char octetsRecus = 0;
+
+/** CRC de l'adresse et des données reçues dans la trame en cours. */
+static unsigned char crcTrame;
+
+/**
+ * Boîte aux lettres des commandes reçues par l'esclave, en attente
+ * d'être traitées par la boucle principale. 
+ * Seule l'interruption modifie boiteEntree, et seule la boucle 
+ * principale modifie boiteSortie: il n'y a pas besoin de bloquer les
+ * interruptions. La boîte est pleine quand l'entrée rattraperait la 
+ * sortie.
+ */
+static I2cCommande boiteAuxLettres[I2C_TAILLE_BOITE_AUX_LETTRES];
+
+/** Prochaine case à remplir. Seule l'interruption la modifie. */
+static unsigned char boiteEntree = 0;
+
+/** Prochaine case à traiter. Seule la boucle principale la modifie. */
+static unsigned char boiteSortie = 0;
+
+/**
+ * Incrémente un compteur d'erreurs, sans dépasser 255.
+ * @param adresse Registre du compteur.
+ */
+static void compteErreur(unsigned char adresse) {
+    if (i2cRegistres.valeurs[adresse] < 255) {
+        i2cRegistres.valeurs[adresse]++;
+    }
+}
+
+/**
+ * Met à jour le registre d'état avec le résultat de la dernière commande.
+ * @param etat Le résultat.
+ */
+static void etablitEtatCommande(I2cEtatCommande etat) {
+    if (pecActif) {
+        i2cRegistres.telemetrie.etatCommande = etat | I2C_PEC_ACTIF;
+    } else {
+        i2cRegistres.telemetrie.etatCommande = etat;
+    }
+}
+
+/**
+ * Accepte une commande complète et valide. La configuration du PEC
+ * est traitée immédiatement; les autres commandes sont déposées dans
+ * la boîte aux lettres.
+ * @param adresse Adresse locale.
+ * @param valeur Valeur associée.
+ */
+static void accepteCommande(unsigned char adresse, unsigned char valeur) {
+    unsigned char entree = boiteEntree;
+    unsigned char suivante = (entree + 1) & (I2C_TAILLE_BOITE_AUX_LETTRES - 1);
+
+    if (adresse == ECRITURE_I2C_PEC) {
+        pecActif = valeur;
+    } else if (suivante == boiteSortie) {
+        etablitEtatCommande(I2C_COMMANDE_REFUSEE);
+        return;
+    } else {
+        boiteAuxLettres[entree].adresse = adresse;
+        boiteAuxLettres[entree].valeur = valeur;
+        boiteEntree = suivante;
+    }
+    i2cRegistres.telemetrie.commandesAcceptees++;
+    etablitEtatCommande(I2C_COMMANDE_ACCEPTEE);
+}
+
+/**
+ * Traite les commandes en attente dans la boîte aux lettres, dans leur
+ * ordre d'arrivée. 
+ * Doit être appelée depuis la boucle principale: la fonction de rappel
+ * s'exécute hors interruption.
+ */
+void i2cTraiteCommandes() {
+    I2cCommande *commande;
+
+    while (boiteSortie != boiteEntree) {
+        commande = &boiteAuxLettres[boiteSortie];
+        rappelCommande(commande->adresse, commande->valeur);
+        boiteSortie = (boiteSortie + 1) & (I2C_TAILLE_BOITE_AUX_LETTRES - 1);
+    }
+}
+
+/**
+ * Le maître s'adresse à l'esclave: si la commande précédente attendait
+ * encore son PEC, elle est rejetée.
+ * @param adresse Octet d'adresse, avec le bit R/W.
+ */
+static void commenceTrame(unsigned char adresse) {
+    if (pecActif && (octetsRecus == 1)) {
+        compteErreur(LECTURE_I2C_COMMANDES_INCOMPLETES);
+        etablitEtatCommande(I2C_COMMANDE_INCOMPLETE);
+    }
+    octetsRecus = 0;
+    crcTrame = i2cCrc8(0, adresse);
+}
+
+/**
+ * Traite un octet de donnée reçu. Sans PEC, la commande s'exécute
+ * immédiatement. Avec PEC, la valeur est retenue jusqu'à l'octet 
+ * suivant, et la commande ne s'exécute que si le PEC est correct.
+ * @param adresse Adresse locale.
+ * @param octet Octet reçu.
+ */
+static void recoitDonnee(unsigned char adresse, unsigned char octet) {
+    static unsigned char valeur;
+
+    if (!pecActif) {
+        accepteCommande(adresse, octet);
+        return;
+    }
+    switch (octetsRecus) {
+        case 0:
+            valeur = octet;
+            crcTrame = i2cCrc8(crcTrame, octet);
+            octetsRecus = 1;
+            break;
+        case 1:
+            octetsRecus = 2;
+            if (octet == crcTrame) {
+                accepteCommande(adresse, valeur);
+            } else {
+                compteErreur(LECTURE_I2C_ERREURS_PEC);
+                etablitEtatCommande(I2C_COMMANDE_ERREUR_PEC);
+            }
+            break;
+        default:
+            // Octets en trop: ignorés.
+            break;
+    }
+}
+
+/**
+ * Rend la valeur d'un registre, pour la lecture en cours.
+ * Les registres à partir de l'état des commandes ne sont modifiés que
+ * par l'esclave lui-même: ils sont rendus directement, pour que le 
+ * maître puisse vérifier le résultat d'une commande sans attendre la 
+ * publication suivante.
+ * @param adresse Le registre.
+ * @return Sa valeur.
+ */
+static unsigned char valeurExposee(unsigned char adresse) {
+    if (adresse >= LECTURE_I2C_ETAT_COMMANDE) {
+        return i2cRegistres.valeurs[adresse];
+    }
+    return i2cInstantanes[i2cInstantaneLu].valeurs[adresse];
 }
 
 /**
  * Automate esclave I2C.
- * @param valeursLecture Liste de valeurs à rendre en cas d'opération
- * de lecture.
+ * L'adresse demandée par le maître désigne le registre. En lecture, 
+ * chaque octet supplémentaire demandé par le maître rend le registre
+ * suivant (après le dernier, le premier): une seule transaction suffit
+ * pour lire un bloc de registres consécutifs.
+ * Toute la lecture se fait dans l'instantané le plus récent au moment
+ * où le maître l'a commencée.
+ * En écriture, si le PEC est actif, la valeur doit être suivie du 
+ * CRC-8 de l'octet d'adresse et de la valeur. Les commandes dont le 
+ * PEC est faux ou absent sont rejetées. Les commandes acceptées 
+ * attendent dans la boîte aux lettres que la boucle principale les 
+ * traite (voir i2cTraiteCommandes).
  */
 void i2cEsclave() {
     static unsigned char adresse;
     
     // Machine à état extraite de Microchip AN00734b - Appendice B
-    if (SSP2STATbits.BF) {
-        if (SSP2STATbits.RW2) {
-            // État 4 - Opération de lecture, dernier octet transmis est une donnée:
-            // Jamais utilisé si les commandes ont un seul octet associé.
-            if (SSP2STATbits.DA2) {
-                SSP2BUF = i2cValeursExposees[adresse];
-                SSP2CON1bits.CKP = 1;
-            } 
-            // État 3 - Opération de lecture, dernier octet reçu est une adresse:
-            else {
-                adresse = convertitEnAdresseLocale(SSP2BUF);
-                SSP2BUF = i2cValeursExposees[adresse];
-                SSP2CON1bits.CKP2 = 1;
-            }
-        } else {
-            // État 2 - Opération d'écriture, dernier octet reçu est une donnée:
-            if (SSP2STATbits.DA2) {
-                // L'esclave doit traiter la donnée reçue:
-                rappelCommande(adresse, SSP2BUF);
-            }
-            // État 1 - Opération d'écriture, dernier octet reçu est une adresse:
-            else {
-                adresse = convertitEnAdresseLocale(SSP2BUF);
-            }
+    if (SSP2STATbits.RW2) {
+        // État 4 - Opération de lecture, dernier octet transmis est une donnée,
+        // et le maître en demande un autre (le tampon est vide):
+        if (SSP2STATbits.DA2) {
+            adresse = (adresse + 1) & I2C_MASQUE_REGISTRES;
+            SSP2BUF = valeurExposee(adresse);
+            SSP2CON1bits.CKP = 1;
+        } 
+        // État 3 - Opération de lecture, dernier octet reçu est une adresse:
+        else {
+            commenceTrame(SSP2BUF);
+            adresse = convertitEnAdresseLocale(SSP2BUF);
+            i2cInstantaneLu = i2cInstantanePublie;
+            SSP2BUF = valeurExposee(adresse);
+            SSP2CON1bits.CKP = 1;
+        }
+    } else if (SSP2STATbits.BF) {
+        // État 2 - Opération d'écriture, dernier octet reçu est une donnée:
+        if (SSP2STATbits.DA2) {
+            recoitDonnee(adresse, SSP2BUF);
+        }
+        // État 1 - Opération d'écriture, dernier octet reçu est une adresse:
+        else {
+            commenceTrame(SSP2BUF);
+            adresse = convertitEnAdresseLocale(SSP2BUF);
         }
         SSP2STATbits.BF = 0;
     }
+    // État 5 - Le maître ne veut plus d'octets (NACK): rien à faire.
+}
+
+/**
+ * Un autre maître a pris le bus pendant une émission.
+ * La commande en cours est abandonnée, et le MSSP2 redevient esclave
+ * pour laisser l'autre maître s'adresser à lui. Les commandes suivantes
+ * seront émises au prochain appel à i2cDemarreEmission.
+ */
+void i2cCollision() {
+    switch (etatMaitre) {
+        case I2C_MASTER_EMISSION_DONNEE:
+        case I2C_MASTER_PREPARE_RECEPTION_DONNEE:
+            abandonneOctets(octetsAEmettre);
+            break;
+    }
+    octetsAEmettre = 0;
+    etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
+    modeEsclave();
 }
 
 /**
@@ -195,5 +578,318 @@ void i2cEsclave() {
  */
 void i2cReinitialise() {
     etatMaitre = I2C_MASTER_EMISSION_ADRESSE;
+    octetsAEmettre = 0;
     fileReinitialise(&fileEmission);
-}
\ No newline at end of file
+    if (emissionEnCours) {
+        modeEsclave();
+    }
+}
+#ifdef TEST
+static unsigned char adresseRappel;
+static unsigned char valeurRappel;
+static unsigned char nombreDeRappels;
+
+static void rappelTest(unsigned char adresse, unsigned char valeur) {
+    adresseRappel = adresse;
+    valeurRappel = valeur;
+    nombreDeRappels++;
+}
+
+/**
+ * Simule la réception par l'esclave d'un octet d'adresse ou de donnée.
+ * @param rw 1 si l'opération est une lecture.
+ * @param da 1 si l'octet est une donnée.
+ * @param octet L'octet reçu.
+ */
+static void esclaveRecoit(unsigned char rw, unsigned char da, unsigned char octet) {
+    SSP2STATbits.RW2 = rw;
+    SSP2STATbits.DA2 = da;
+    SSP2STATbits.BF = 1;
+    SSP2BUF = octet;
+    i2cEsclave();
+}
+
+/**
+ * Simule la demande d'un octet supplémentaire par le maître, pendant
+ * une lecture.
+ * @return L'octet rendu par l'esclave.
+ */
+static unsigned char esclaveTransmet() {
+    SSP2STATbits.RW2 = 1;
+    SSP2STATbits.DA2 = 1;
+    SSP2STATbits.BF = 0;
+    i2cEsclave();
+    return SSP2BUF;
+}
+
+void lit_un_bloc_de_registres_consecutifs() {
+    unsigned char n;
+    
+    for (n = 0; n < I2C_NOMBRE_DE_REGISTRES; n++) {
+        i2cExposeValeur(n, 100 + n);
+    }
+    i2cPublieTelemetrie();
+    
+    // Lecture de trois registres à partir de l'inactivité:
+    esclaveRecoit(1, 0, ((0x10 + LECTURE_I2C_INACTIVITE_TELECOMMANDE) << 1) | 1);
+    verifieEgalite("I2CL01", SSP2BUF, 100 + LECTURE_I2C_INACTIVITE_TELECOMMANDE);
+    verifieEgalite("I2CL02", esclaveTransmet(), 100 + LECTURE_I2C_VITESSE_MESUREE);
+    verifieEgalite("I2CL03", esclaveTransmet(), 100 + LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE);
+    
+    // Le maître répond NACK: l'esclave ne transmet plus rien.
+    SSP2STATbits.RW2 = 0;
+    SSP2STATbits.DA2 = 1;
+    SSP2STATbits.BF = 0;
+    SSP2BUF = 0;
+    i2cEsclave();
+    verifieEgalite("I2CL04", SSP2BUF, 0);
+    
+    // La lecture continue au-delà des adresses locales, puis le 
+    // pointeur revient au premier registre:
+    esclaveRecoit(1, 0, ((0x10 + I2C_MASQUE_ADRESSES_LOCALES) << 1) | 1);
+    verifieEgalite("I2CL05", SSP2BUF, 100 + I2C_MASQUE_ADRESSES_LOCALES);
+    verifieEgalite("I2CL06", esclaveTransmet(), 100 + I2C_MASQUE_ADRESSES_LOCALES + 1);
+    for (n = I2C_MASQUE_ADRESSES_LOCALES + 2; n < I2C_NOMBRE_DE_REGISTRES; n++) {
+        esclaveTransmet();
+    }
+    verifieEgalite("I2CL07", esclaveTransmet(), 100);
+    
+    // Les registres coïncident avec les champs de la télémétrie:
+    i2cExposeValeur(LECTURE_I2C_SEQUENCE_TELEMETRIE, 100 + LECTURE_I2C_SEQUENCE_TELEMETRIE);
+    verifieEgalite("I2CL10", i2cRegistres.telemetrie.vitesseRc, 100 + LECTURE_I2C_VITESSE_RC);
+    verifieEgalite("I2CL11", i2cRegistres.telemetrie.tensionMoyenne, 100 + LECTURE_I2C_TENSION_MOYENNE);
+    verifieEgalite("I2CL12", i2cRegistres.telemetrie.calibrationRc, 100 + LECTURE_I2C_CALIBRATION_RC);
+}
+
+void lit_un_instantane_coherent() {
+    unsigned char sequence;
+    
+    i2cExposeValeur(LECTURE_I2C_VITESSE_MESUREE, 10);
+    i2cExposeValeur(LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE, 11);
+    i2cPublieTelemetrie();
+    sequence = i2cRegistres.telemetrie.sequence;
+    
+    // Les valeurs exposées ne sont visibles qu'après la publication:
+    i2cExposeValeur(LECTURE_I2C_VITESSE_MESUREE, 20);
+    esclaveRecoit(1, 0, ((0x10 + LECTURE_I2C_VITESSE_MESUREE) << 1) | 1);
+    verifieEgalite("I2CS01", SSP2BUF, 10);
+    
+    // Une lecture commencée continue dans le même instantané, même
+    // si la boucle principale en publie d'autres entre-temps:
+    i2cExposeValeur(LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE, 21);
+    i2cPublieTelemetrie();
+    i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, 22);
+    i2cPublieTelemetrie();
+    i2cExposeValeur(LECTURE_I2C_NOMBRE_DE_MANOEUVRES, 32);
+    i2cPublieTelemetrie();
+    verifieEgalite("I2CS02", esclaveTransmet(), 11);
+    
+    // La lecture suivante rend le dernier instantané:
+    esclaveRecoit(1, 0, ((0x10 + LECTURE_I2C_VITESSE_MESUREE) << 1) | 1);
+    verifieEgalite("I2CS03", SSP2BUF, 20);
+    verifieEgalite("I2CS04", esclaveTransmet(), 21);
+    verifieEgalite("I2CS05", esclaveTransmet(), 32);
+    
+    // Chaque publication a son numéro de séquence:
+    esclaveRecoit(1, 0, ((0x10 + LECTURE_I2C_SEQUENCE_TELEMETRIE) << 1) | 1);
+    verifieEgalite("I2CS06", SSP2BUF, (unsigned char) (sequence + 3));
+}
+
+void ecrit_un_registre() {
+    i2cRappelCommande(rappelTest);
+    nombreDeRappels = 0;
+
+    esclaveRecoit(0, 0, (0x10 + ECRITURE_I2C_LIMITE_COURANT) << 1);
+    verifieEgalite("I2CE01", nombreDeRappels, 0);
+    verifieEgalite("I2CE02", SSP2STATbits.BF, 0);
+    
+    esclaveRecoit(0, 1, 45);
+    verifieEgalite("I2CE03", nombreDeRappels, 0);
+    i2cTraiteCommandes();
+    verifieEgalite("I2CE03", nombreDeRappels, 1);
+    verifieEgalite("I2CE04", adresseRappel, ECRITURE_I2C_LIMITE_COURANT);
+    verifieEgalite("I2CE05", valeurRappel, 45);
+    
+    i2cRappelCommande(faitRienDuTout);
+}
+
+/**
+ * Simule l'écriture d'une commande par le maître.
+ * @param adresse Adresse locale.
+ * @param valeur Valeur.
+ * @param pec Nombre d'octets de PEC à envoyer (0 ou 1).
+ * @param erreur Valeur à ajouter au PEC, pour le corrompre.
+ */
+static void maitreEcrit(unsigned char adresse, unsigned char valeur, 
+        unsigned char pec, unsigned char erreur) {
+    unsigned char octetAdresse = (0x10 + adresse) << 1;
+    
+    esclaveRecoit(0, 0, octetAdresse);
+    esclaveRecoit(0, 1, valeur);
+    if (pec) {
+        esclaveRecoit(0, 1, i2cCrc8(i2cCrc8(0, octetAdresse), valeur) + erreur);
+    }
+    i2cTraiteCommandes();
+}
+
+void calcule_le_pec() {
+    const char *texte = "123456789";
+    unsigned char crc = 0;
+    
+    while (*texte) {
+        crc = i2cCrc8(crc, *texte++);
+    }
+    verifieEgalite("I2CC01", crc, 0xF4);
+}
+
+void rejette_les_commandes_avec_un_pec_faux() {
+    i2cRappelCommande(rappelTest);
+    i2cExposeValeur(LECTURE_I2C_ERREURS_PEC, 0);
+    i2cExposeValeur(LECTURE_I2C_COMMANDES_INCOMPLETES, 0);
+    i2cExposeValeur(LECTURE_I2C_COMMANDES_ACCEPTEES, 0);
+    
+    // Sans PEC, les commandes sont exécutées immédiatement:
+    nombreDeRappels = 0;
+    maitreEcrit(ECRITURE_I2C_VITESSE, 30, 0, 0);
+    verifieEgalite("I2CP01", nombreDeRappels, 1);
+    verifieEgalite("I2CP02", i2cRegistres.telemetrie.commandesAcceptees, 1);
+    
+    // Le PEC est activé par une commande de l'esclave I2C lui-même:
+    maitreEcrit(ECRITURE_I2C_PEC, 1, 0, 0);
+    verifieEgalite("I2CP03", nombreDeRappels, 1);
+    verifieEgalite("I2CP04", i2cRegistres.telemetrie.etatCommande, 
+            I2C_COMMANDE_ACCEPTEE | I2C_PEC_ACTIF);
+    
+    // Commande avec un PEC correct:
+    maitreEcrit(ECRITURE_I2C_VITESSE, 40, 1, 0);
+    verifieEgalite("I2CP10", nombreDeRappels, 2);
+    verifieEgalite("I2CP11", valeurRappel, 40);
+    verifieEgalite("I2CP12", i2cRegistres.telemetrie.commandesAcceptees, 3);
+    
+    // Commande avec un PEC faux:
+    maitreEcrit(ECRITURE_I2C_VITESSE, 255, 1, 1);
+    verifieEgalite("I2CP20", nombreDeRappels, 2);
+    verifieEgalite("I2CP21", i2cRegistres.telemetrie.erreursPec, 1);
+    verifieEgalite("I2CP22", i2cRegistres.telemetrie.etatCommande, 
+            I2C_COMMANDE_ERREUR_PEC | I2C_PEC_ACTIF);
+    
+    // Commande sans PEC, suivie d'une lecture de l'état:
+    maitreEcrit(ECRITURE_I2C_VITESSE, 255, 0, 0);
+    verifieEgalite("I2CP30", nombreDeRappels, 2);
+    esclaveRecoit(1, 0, ((0x10 + LECTURE_I2C_ETAT_COMMANDE) << 1) | 1);
+    verifieEgalite("I2CP31", SSP2BUF, I2C_COMMANDE_INCOMPLETE | I2C_PEC_ACTIF);
+    verifieEgalite("I2CP32", esclaveTransmet(), 1);
+    verifieEgalite("I2CP33", esclaveTransmet(), 1);
+    verifieEgalite("I2CP34", esclaveTransmet(), 3);
+    
+    // Le PEC se désactive avec une commande munie de son PEC:
+    maitreEcrit(ECRITURE_I2C_PEC, 0, 1, 0);
+    verifieEgalite("I2CP40", i2cRegistres.telemetrie.etatCommande, I2C_COMMANDE_ACCEPTEE);
+    maitreEcrit(ECRITURE_I2C_VITESSE, 50, 0, 0);
+    verifieEgalite("I2CP41", nombreDeRappels, 3);
+    verifieEgalite("I2CP42", valeurRappel, 50);
+    
+    i2cRappelCommande(faitRienDuTout);
+}
+
+void depose_les_commandes_dans_la_boite_aux_lettres() {
+    unsigned char n;
+    
+    i2cRappelCommande(rappelTest);
+    nombreDeRappels = 0;
+    
+    // La boîte aux lettres accepte une commande de moins que sa taille:
+    for (n = 1; n < I2C_TAILLE_BOITE_AUX_LETTRES; n++) {
+        esclaveRecoit(0, 0, (0x10 + ECRITURE_I2C_DIRECTION) << 1);
+        esclaveRecoit(0, 1, n);
+        verifieEgalite("I2CB01", i2cRegistres.telemetrie.etatCommande, I2C_COMMANDE_ACCEPTEE);
+    }
+    esclaveRecoit(0, 0, (0x10 + ECRITURE_I2C_VITESSE) << 1);
+    esclaveRecoit(0, 1, 99);
+    verifieEgalite("I2CB02", i2cRegistres.telemetrie.etatCommande, I2C_COMMANDE_REFUSEE);
+    verifieEgalite("I2CB03", nombreDeRappels, 0);
+
+    // Les commandes sont traitées dans l'ordre d'arrivée:
+    i2cTraiteCommandes();
+    verifieEgalite("I2CB04", nombreDeRappels, I2C_TAILLE_BOITE_AUX_LETTRES - 1);
+    verifieEgalite("I2CB05", adresseRappel, ECRITURE_I2C_DIRECTION);
+    verifieEgalite("I2CB06", valeurRappel, I2C_TAILLE_BOITE_AUX_LETTRES - 1);
+
+    // La boîte aux lettres est de nouveau disponible:
+    esclaveRecoit(0, 0, (0x10 + ECRITURE_I2C_VITESSE) << 1);
+    esclaveRecoit(0, 1, 99);
+    i2cTraiteCommandes();
+    verifieEgalite("I2CB07", nombreDeRappels, I2C_TAILLE_BOITE_AUX_LETTRES);
+    verifieEgalite("I2CB08", valeurRappel, 99);
+
+    i2cRappelCommande(faitRienDuTout);
+}
+
+/**
+ * Simule l'interruption du maître à la fin de l'opération précédente.
+ * @return L'octet placé dans le tampon d'émission.
+ */
+static unsigned char maitreEmet() {
+    i2cMaitre();
+    return SSP2BUF;
+}
+
+void emet_une_trame_de_plusieurs_octets() {
+    unsigned char trame[3] = {11, 22, 33};
+    unsigned char n;
+
+    i2cReinitialise();
+    SSP2STATbits.S = 0;
+    SSP2CON2bits.SEN = 0;
+    SSP2CON2bits.PEN = 0;
+
+    // Tous les octets suivent l'adresse, dans la même transaction:
+    verifieEgalite("I2CM01", i2cPrepareTramePourEmission(0x40, trame, 3), 255);
+    verifieEgalite("I2CM02", SSP2CON2bits.SEN, 1);
+    verifieEgalite("I2CM03", maitreEmet(), 0x40);
+    verifieEgalite("I2CM04", maitreEmet(), 11);
+    verifieEgalite("I2CM05", maitreEmet(), 22);
+    verifieEgalite("I2CM06", maitreEmet(), 33);
+    verifieEgalite("I2CM07", SSP2CON2bits.PEN, 0);
+    i2cMaitre();
+    verifieEgalite("I2CM08", SSP2CON2bits.PEN, 1);
+    i2cMaitre();
+    verifieEgalite("I2CM09", i2cEmissionEnCours(), 0);
+
+    // Une trame qui ne tient pas dans la file est perdue en entier:
+    SSP2STATbits.S = 1;
+    for (n = 0; n < FILE_TAILLE / 5; n++) {
+        i2cPrepareTramePourEmission(0x40, trame, 3);
+    }
+    verifieEgalite("I2CM10", i2cPrepareTramePourEmission(0x40, trame, 3), 0);
+    verifieEgalite("I2CM11", i2cPlaceDisponiblePourEmission(), 1);
+
+    // Après une collision, le reste de la trame est abandonné, mais
+    // la trame suivante est émise complète:
+    i2cReinitialise();
+    i2cPrepareTramePourEmission(0x40, trame, 3);
+    i2cPrepareCommandePourEmission(0x42, 44);
+    SSP2STATbits.S = 0;
+    i2cDemarreEmission();
+    verifieEgalite("I2CM20", maitreEmet(), 0x40);
+    verifieEgalite("I2CM21", maitreEmet(), 11);
+    i2cCollision();
+    verifieEgalite("I2CM22", i2cEmissionEnCours(), 0);
+    i2cDemarreEmission();
+    verifieEgalite("I2CM23", maitreEmet(), 0x42);
+    verifieEgalite("I2CM24", maitreEmet(), 44);
+    verifieEgalite("I2CM25", i2cDonneesDisponiblesPourEmission(), 0);
+
+    i2cReinitialise();
+}
+
+void test_i2c() {
+    lit_un_bloc_de_registres_consecutifs();
+    lit_un_instantane_coherent();
+    ecrit_un_registre();
+    depose_les_commandes_dans_la_boite_aux_lettres();
+    calcule_le_pec();
+    rejette_les_commandes_avec_un_pec_faux();
+    emet_une_trame_de_plusieurs_octets();
+}
+#endif
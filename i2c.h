@@ -2,13 +2,30 @@
 #define I2C__H
 
 #define          I2C_ADRESSE_DE_BASE 0b00100000
-#define  I2C_MASQUE_ADRESSES_LOCALES 0b00000111
-#define I2C_MASQUE_ADRESSES_ESCLAVES 0b11110000
+#define  I2C_MASQUE_ADRESSES_LOCALES 0b00001111
+#define I2C_MASQUE_ADRESSES_ESCLAVES 0b11100000
 
 typedef enum {
     ECRITURE_I2C_VITESSE                  = 0,
     ECRITURE_I2C_DIRECTION                = 1,
     ECRITURE_I2C_MANOEUVRE                = 2,
+    ECRITURE_I2C_LIMITE_COURANT           = 3,
+    ECRITURE_I2C_TEMPERATURE_DEBUT        = 4,
+    ECRITURE_I2C_TEMPERATURE_FIN          = 5,
+    ECRITURE_I2C_DELAI_SECURITE_RC        = 6,
+    ECRITURE_I2C_CALIBRATION_RC           = 7,
+    ECRITURE_I2C_VITESSE_DIRECTION        = 8,
+    ECRITURE_I2C_LISSAGE_DIRECTION        = 9,
+    ECRITURE_I2C_SERVO_AUXILIAIRE_1       = 10,
+    ECRITURE_I2C_SERVO_AUXILIAIRE_2       = 11,
+    ECRITURE_I2C_PERIODE_TELEMETRIE       = 12,
+    ECRITURE_I2C_PEC                      = 13,
+    // Les deux derniers registres multiplexent des blocs de champs: 
+    // SELECTION_BLOC choisit une manoeuvre programmable (à partir de 
+    // MANOEUVRE_PROGRAMMABLE) ou un réglage (à partir de REGLAGE), et 
+    // chaque écriture dans CHAMP_BLOC définit le champ suivant du bloc:
+    ECRITURE_I2C_SELECTION_BLOC           = 14,
+    ECRITURE_I2C_CHAMP_BLOC               = 15,
 
     LECTURE_I2C_VITESSE_RC                = 0, // 0x10 = 16
     LECTURE_I2C_RC_GAUCHE_DROITE          = 1, // 0x11 = 17
@@ -16,7 +33,21 @@ typedef enum {
     LECTURE_I2C_VITESSE_MESUREE           = 3, // 0x13 = 19
     LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE  = 4, // 0x14 = 20
     LECTURE_I2C_NOMBRE_DE_MANOEUVRES      = 5, // 0x15 = 21
-    LECTURE_I2C_TENSION_MOYENNE           = 6  // 0x16 = 22
+    LECTURE_I2C_TENSION_MOYENNE           = 6, // 0x16 = 22
+    LECTURE_I2C_COURANT                   = 7, // 0x17 = 23
+    LECTURE_I2C_TEMPERATURE               = 8, // 0x18 = 24
+    LECTURE_I2C_ETAT_THERMIQUE            = 9, // 0x19 = 25
+    LECTURE_I2C_SECURITE_RC               = 10,// 0x1A = 26
+    LECTURE_I2C_PULSATIONS_REJETEES       = 11,// 0x1B = 27
+    LECTURE_I2C_CALIBRATION_RC            = 12,// 0x1C = 28
+    LECTURE_I2C_SEQUENCE_TELEMETRIE       = 13,// 0x1D = 29
+    LECTURE_I2C_ALIMENTATION              = 14,// 0x1E = 30
+    LECTURE_I2C_ETAT_COMMANDE             = 15,// 0x1F = 31
+    // Les registres suivants ne sont accessibles qu'en continuant une
+    // lecture commencée sur un registre précédent:
+    LECTURE_I2C_ERREURS_PEC               = 16,
+    LECTURE_I2C_COMMANDES_INCOMPLETES     = 17,
+    LECTURE_I2C_COMMANDES_ACCEPTEES       = 18
             
 } I2cAdresse;
 
@@ -25,23 +56,104 @@ typedef struct {
     unsigned char valeur;
 } I2cCommande;
 
-/** Liste des valeurs exposées par l'esclave I2C. */
-unsigned char i2cValeursExposees[I2C_MASQUE_ADRESSES_LOCALES + 1];
+/** 
+ * Nombre de registres exposés en lecture par l'esclave I2C. Il y en a
+ * plus que d'adresses locales: les derniers se lisent en continuant 
+ * une lecture groupée.
+ */
+#define I2C_NOMBRE_DE_REGISTRES 32
+#define I2C_MASQUE_REGISTRES (I2C_NOMBRE_DE_REGISTRES - 1)
+
+/**
+ * Résultat de la dernière commande reçue par l'esclave.
+ */
+typedef enum {
+    /** La commande a été acceptée et transmise. */
+    I2C_COMMANDE_ACCEPTEE = 0,
+    /** Le PEC ne correspond pas: la commande a été rejetée. */
+    I2C_COMMANDE_ERREUR_PEC = 1,
+    /** La trame s'est terminée avant le PEC: la commande a été rejetée. */
+    I2C_COMMANDE_INCOMPLETE = 2,
+    /** La boîte aux lettres était pleine: la commande a été rejetée. */
+    I2C_COMMANDE_REFUSEE = 3
+} I2cEtatCommande;
+
+/** 
+ * Nombre de commandes que la boîte aux lettres peut contenir, plus un.
+ * Doit être une puissance de 2.
+ */
+#define I2C_TAILLE_BOITE_AUX_LETTRES 8
+
+/** Drapeau du registre d'état, indiquant que le PEC est exigé. */
+#define I2C_PEC_ACTIF 0x80
+
+/**
+ * Télémétrie exposée par l'esclave I2C. Chaque champ occupe le 
+ * registre de l'adresse LECTURE_I2C_xxx correspondante, et les 
+ * registres se suivent: le maître peut lire tout un bloc en une seule
+ * transaction (voir i2cEsclave).
+ */
+typedef struct {
+    unsigned char vitesseRc;                // LECTURE_I2C_VITESSE_RC
+    unsigned char rcGaucheDroite;           // LECTURE_I2C_RC_GAUCHE_DROITE
+    unsigned char inactiviteTelecommande;   // LECTURE_I2C_INACTIVITE_TELECOMMANDE
+    unsigned char vitesseMesuree;           // LECTURE_I2C_VITESSE_MESUREE
+    unsigned char derniereManoeuvreRecue;   // LECTURE_I2C_DERNIERE_MANOEUVRE_RECUE
+    unsigned char nombreDeManoeuvres;       // LECTURE_I2C_NOMBRE_DE_MANOEUVRES
+    unsigned char tensionMoyenne;           // LECTURE_I2C_TENSION_MOYENNE
+    unsigned char courant;                  // LECTURE_I2C_COURANT
+    unsigned char temperature;              // LECTURE_I2C_TEMPERATURE
+    unsigned char etatThermique;            // LECTURE_I2C_ETAT_THERMIQUE
+    unsigned char securiteRc;               // LECTURE_I2C_SECURITE_RC
+    unsigned char pulsationsRejetees;       // LECTURE_I2C_PULSATIONS_REJETEES
+    unsigned char calibrationRc;            // LECTURE_I2C_CALIBRATION_RC
+    unsigned char sequence;                 // LECTURE_I2C_SEQUENCE_TELEMETRIE
+    unsigned char alimentation;             // LECTURE_I2C_ALIMENTATION
+    unsigned char etatCommande;             // LECTURE_I2C_ETAT_COMMANDE
+    unsigned char erreursPec;               // LECTURE_I2C_ERREURS_PEC
+    unsigned char commandesIncompletes;     // LECTURE_I2C_COMMANDES_INCOMPLETES
+    unsigned char commandesAcceptees;       // LECTURE_I2C_COMMANDES_ACCEPTEES
+} I2cTelemetrie;
+
+/**
+ * Registres exposés par l'esclave I2C, accessibles un par un selon 
+ * leur adresse, ou en tant que bloc de télémétrie.
+ */
+typedef union {
+    unsigned char valeurs[I2C_NOMBRE_DE_REGISTRES];
+    I2cTelemetrie telemetrie;
+} I2cRegistres;
+
+/** 
+ * Registres en cours de mise à jour. Le maître I2C ne les voit qu'à la
+ * prochaine publication (voir i2cPublieTelemetrie).
+ */
+extern I2cRegistres i2cRegistres;
 
 typedef void (*I2cRappelCommande)(unsigned char, unsigned char);
 void i2cRappelCommande(I2cRappelCommande r);
 void i2cExposeValeur(unsigned char adresse, unsigned char valeur);
+unsigned char i2cCrc8(unsigned char crc, unsigned char octet);
+void i2cPublieTelemetrie();
 void i2cPrepareCommandePourEmission(I2cAdresse adresse, unsigned char valeur);
+unsigned char i2cPrepareTramePourEmission(I2cAdresse adresse, 
+                                          const unsigned char *octets, 
+                                          unsigned char nombre);
+unsigned char i2cPlaceDisponiblePourEmission();
+void i2cDemarreEmission();
+unsigned char i2cEmissionEnCours();
+void i2cCollision();
 unsigned char i2cDonneesDisponiblesPourEmission();
 unsigned char i2cRecupereCaracterePourEmission();
 
 void i2cMaitre();
 void i2cEsclave();
+void i2cTraiteCommandes();
 
 void i2cReinitialise();
 
 #ifdef TEST
-void testI2c();
+void test_i2c();
 #endif
 
 #endif
\ No newline at end of file
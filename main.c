@@ -14,10 +14,18 @@
 #include "evenements.h"
 #include "tableauDeBord.h"
 #include "puissance.h"
+#include "profil.h"
 #include "moteur.h"
 #include "direction.h"
 #include "capture.h"
+#include "ppm.h"
+#include "sbus.h"
+#include "servo.h"
+#include "calibration.h"
 #include "i2c.h"
+#include "telemetrie.h"
+#include "sequenceur.h"
+#include "reglages.h"
 
 /**
  * Bits de configuration:
@@ -41,16 +49,16 @@
 #define DEPLACEMENT_DUREE_SOUS_DIVISIONS 10
 #define DEPLACEMENT_NOMBRE_SOUS_DIVISIONS 255
 
-typedef enum {
-    TEMPS_HAUT,
-    TEMPS_BAS
-} EtatGenerateurPWMServo;
-
 typedef enum {
     CAPTURE_FLANC_DESCENDANT = 0x04,
     CAPTURE_FLANC_MONTANT = 0x05
 } CaptureDeFlanc;
 
+/**
+ * Canaux de la télécommande. En mode PPM ou SBUS, ce sont aussi les 
+ * deux premiers canaux de la trame; les suivants sont disponibles avec
+ * ppmValeur ou sbusValeur.
+ */
 typedef enum {
     CANAL_RC_DIRECTION = 0,
     CANAL_RC_VITESSE = 1
@@ -58,32 +66,33 @@ typedef enum {
 
 /**
  * Routine de traitement des interruptions de haute priorité.
- * Utilisée pour produire le signal PWM destiné à diriger les roues avant
- * de la voiture.
+ * Utilisée pour produire les signaux PWM des servos: celui qui dirige
+ * les roues avant de la voiture, et ceux des servos auxiliaires. 
+ * Chaque interruption produit un flanc du plan de la trame, et charge
+ * le temporisateur jusqu'au suivant.
  */
 void interrupt interruptionsHautePriorite() {
-    static EtatGenerateurPWMServo etat = TEMPS_BAS;
+    const FlancServo *flanc;
     
     if (INTCONbits.TMR0IF) {
         INTCONbits.TMR0IF = 0;
-        switch (etat) {
-            case TEMPS_HAUT:
-                etat = TEMPS_BAS;
-                TMR0H = tableauDeBord.positionRouesAvant.tempsBas.partie.haute;
-                TMR0L = tableauDeBord.positionRouesAvant.tempsBas.partie.basse;
-                PORTAbits.RA6 = 0;
-                break;
-
-            case TEMPS_BAS:
-                etat = TEMPS_HAUT;
-                TMR0H = tableauDeBord.positionRouesAvant.tempsHaut.partie.haute;
-                TMR0L = tableauDeBord.positionRouesAvant.tempsHaut.partie.basse;
-                PORTAbits.RA6 = 1;
-                break;
-        }
+        flanc = servoFlancSuivant();
+        TMR0H = flanc->recharge.partie.haute;
+        TMR0L = flanc->recharge.partie.basse;
+        LATA = (LATA & ~SERVO_SORTIES) | flanc->sorties;
     }
 }
 
+/**
+ * Démarre une conversion A/D.
+ * @param demarrage Canal et temps d'acquisition.
+ */
+void demarreConversionAD(DemarrageAD *demarrage) {
+    ADCON0bits.CHS = demarrage->canal;
+    ADCON2bits.ACQT = demarrage->acquisition;
+    ADCON0bits.GODONE = 1;
+}
+
 /**
  * Routine de traitement d'interruptions de basse priorité.
  * Pilotage du moteur sur la base des détecteurs Hall.
@@ -92,33 +101,68 @@ void low_priority interrupt interruptionsBassePriorite() {
     unsigned char hall;
     static unsigned char hall0 = 0;
     static int tempsMesureVitesse = VITESSE_BASE_DE_TEMPS;
+    static unsigned char tempsProfil = PROFIL_DUREE_BASE_DE_TEMPS;
     static unsigned char deplacementDureeSousDivision = DEPLACEMENT_DUREE_SOUS_DIVISIONS;
     static unsigned char nombreSousDivisionsDeTemps = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
     static unsigned char tempsDeDeplacement = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
-    unsigned char mesureRc;
+    static DemarrageAD demarrageAD;
+#ifndef RC_PPM
+    unsigned int mesureRc;
+#endif
+#ifdef RC_SBUS
+    unsigned char erreurSbus;
+    unsigned char octetSbus;
+#endif
 
     // Traitement des conversions AD:
-    if (PIR5bits.TMR4IF) {
-        PIR5bits.TMR4IF = 0;
-
-        if (!ADCON0bits.GODONE) {
-            switch (ADCON0bits.CHS) {
-                case 9:
-                    enfileEvenement(LECTURE_POTENTIOMETRE, ADRESH);
-                    ADCON0bits.CHS = 11;
-                    break;
-                case 11:
-                    enfileEvenement(LECTURE_ALIMENTATION, ADRESH);
-                    ADCON0bits.CHS = 9;
-                    break;
-                default:
-                    ADCON0bits.CHS = 9;
-                    break;
-            }
-            ADCON0bits.GODONE = 1;
+    // Les conversions s'enchaînent selon la table du séquenceur.
+    if (PIR1bits.ADIF) {
+        PIR1bits.ADIF = 0;
+        if (sequenceurConversionTerminee(ADRES, &demarrageAD)) {
+            demarreConversionAD(&demarrageAD);
         }
     }
 
+#if defined(RC_SBUS)
+    // Réception SBUS sur la EUSART (tous les canaux dans une trame
+    // série). L'erreur de format concerne l'octet reçu, et doit être
+    // lue avant lui:
+    if (PIR1bits.RC1IF) {
+        erreurSbus = RCSTA1bits.FERR;
+        if (RCSTA1bits.OERR) {
+            RCSTA1bits.CREN = 0;
+            RCSTA1bits.CREN = 1;
+            erreurSbus = TRUE;
+        }
+        octetSbus = RCREG1;
+        if (erreurSbus) {
+            sbusErreur();
+        } else if (sbusOctet(octetSbus)) {
+            mesureRc = sbusValeur(CANAL_RC_DIRECTION);
+            if (mesureRc != CAPTURE_PULSATION_INVALIDE) {
+                receptionTelecommandeGaucheDroite(mesureRc);
+            }
+            mesureRc = sbusValeur(CANAL_RC_VITESSE);
+            if (mesureRc != CAPTURE_PULSATION_INVALIDE) {
+                receptionTelecommandeAvantArriere(mesureRc);
+            }
+        }
+    }
+#elif defined(RC_PPM)
+    // Capture de l'entrée CCP5, en mode PPM (tous les canaux sur une
+    // seule entrée). Seuls les flancs montants sont capturés:
+    if (PIR4bits.CCP5IF) {
+        PIR4bits.CCP5IF = 0;
+        switch (ppmFlanc(CCPR5)) {
+            case CANAL_RC_DIRECTION:
+                receptionTelecommandeGaucheDroite(ppmValeur(CANAL_RC_DIRECTION));
+                break;
+            case CANAL_RC_VITESSE:
+                receptionTelecommandeAvantArriere(ppmValeur(CANAL_RC_VITESSE));
+                break;
+        }
+    }
+#else
     // Capture de l'entrée CCP4:
     if (PIR4bits.CCP4IF) {
         PIR4bits.CCP4IF = 0;
@@ -129,7 +173,9 @@ void low_priority interrupt interruptionsBassePriorite() {
                 break;
             case CAPTURE_FLANC_DESCENDANT:
                 mesureRc = captureFlancDescendant(CANAL_RC_DIRECTION, CCPR4);
-                receptionTelecommandeGaucheDroite(mesureRc);
+                if (mesureRc != CAPTURE_PULSATION_INVALIDE) {
+                    receptionTelecommandeGaucheDroite(mesureRc);
+                }
                 CCP4CONbits.CCP4M = CAPTURE_FLANC_MONTANT;
                 break;
         }
@@ -145,22 +191,42 @@ void low_priority interrupt interruptionsBassePriorite() {
                 break;
             case CAPTURE_FLANC_DESCENDANT:
                 mesureRc = captureFlancDescendant(CANAL_RC_VITESSE, CCPR5);
-                receptionTelecommandeAvantArriere(mesureRc);
+                if (mesureRc != CAPTURE_PULSATION_INVALIDE) {
+                    receptionTelecommandeAvantArriere(mesureRc);
+                }
                 CCP5CONbits.CCP5M = CAPTURE_FLANC_MONTANT;
                 break;
         }
     }
+#endif
 
     // Traitement pour le moteur:
     if (PIR1bits.TMR2IF) {
         PIR1bits.TMR2IF = 0;
 
+        // Début de la période du PWM: lecture de courant synchronisée:
+        if (!ADCON0bits.GODONE && !PIR1bits.ADIF) {
+            if (sequenceurPeriodePwm(tableauDeBord.rapportCyclique,
+                                     tableauDeBord.phaseCommutee,
+                                     &demarrageAD)) {
+                demarreConversionAD(&demarrageAD);
+            }
+        }
+
         // Événement base de temps:
         if (-- tempsMesureVitesse == 0) {
             enfileEvenement(BASE_DE_TEMPS, 0);
             tempsMesureVitesse = VITESSE_BASE_DE_TEMPS;
         }
 
+        // Événement base de temps du profil de déplacement, et
+        // surveillance du signal de la télécommande:
+        if (-- tempsProfil == 0) {
+            enfileEvenement(BASE_DE_TEMPS_PROFIL, 0);
+            verifieSignalTelecommande();
+            tempsProfil = PROFIL_DUREE_BASE_DE_TEMPS;
+        }
+
         // Mesure le temps entre deux phases:
         if (-- deplacementDureeSousDivision == 0) {
             deplacementDureeSousDivision = DEPLACEMENT_DUREE_SOUS_DIVISIONS;
@@ -189,11 +255,20 @@ void low_priority interrupt interruptionsBassePriorite() {
         }
     }
     
-    // Interruptions I2C
+    // Interruptions I2C. Le MSSP2 est esclave, sauf le temps d'émettre
+    // la télémétrie:
     if (PIR3bits.SSP2IF) {
-        i2cEsclave();
+        if (i2cEmissionEnCours()) {
+            i2cMaitre();
+        } else {
+            i2cEsclave();
+        }
         PIR3bits.SSP2IF = 0;
     }
+    if (PIR3bits.BCL2IF) {
+        i2cCollision();
+        PIR3bits.BCL2IF = 0;
+    }
 }
 
 /**
@@ -206,17 +281,21 @@ void hardwareInitialise() {
 
     // Configure le module A/D:
     ANSELA = 0x00;       // Désactive les convertisseurs A/D
-    ANSELB = 0b00101000; // Active AN9(RB3) et AN13(RB5) comme entrées analogiques.
+    ANSELB = 0b00101100; // Active AN8(RB2), AN9(RB3) et AN13(RB5) comme entrées analogiques.
+                         // AN13(RB5) mesure la température des transistors.
     ANSELC = 0x00;       // Désactive les convertisseurs A/D.
 
-    ADCON2bits.ADFM = 0; // Résultat justifié sur ADRESH.
+    ADCON2bits.ADFM = 1; // Résultat de 10 bits, justifié à droite sur ADRES.
     ADCON2bits.ACQT = 5; // Temps d'acquisition: 12 TAD
     ADCON2bits.ADCS = 6; // TAD de 1uS pour FOSC = 64MHz
 
-    ADCON0bits.CHS = 8;  // Canal AN8 (RB2).
     ADCON0bits.ADON = 1; // Active le module A/D.
+    sequenceurInitialise();
 
-    // Temporisateur 0: PWM pour le servo de direction.
+    PIE1bits.ADIE = 1;   // Active les interruptions.
+    IPR1bits.ADIP = 0;   // Interruptions de basse priorité.
+
+    // Temporisateur 0: PWM pour les servos.
     T0CONbits.T08BIT = 0;       // Compteur de 16 bits.
     T0CONbits.T0CS = 0;         // Source: FOSC / 4
     T0CONbits.PSA = 0;          // Active le diviseur de fréquence.
@@ -241,14 +320,6 @@ void hardwareInitialise() {
     PIE1bits.TMR2IE = 1;        // Active les interruptions.
     IPR1bits.TMR2IP = 0;        // Interruptions de basse priorité.
 
-    // Temporisateur 4: Cadence des conversions A/D:
-    T4CONbits.T4CKPS = 1;       // Pas de division de fréquence.
-    T4CONbits.T4OUTPS = 0;      // Pas de division de fréquence.
-    T4CONbits.TMR4ON = 1;       // Active le temporisateur
-
-    PIE5bits.TMR4IE = 1;        // Active les interruptions.
-    IPR5bits.TMR4IP = 0;        // Interruptions de basse priorité.
-    
     // Active les CCP 1 à 3 en mode PWM, tous sur le TMR2:
     CCP1CONbits.CCP1M = 12;         // Sorties P1A, P1B actives à niveau haut.
     CCP1CONbits.P1M = 0;            // Contrôleur de demi pont (P1A et P1B).
@@ -265,16 +336,35 @@ void hardwareInitialise() {
     PWM3CONbits.P3DC = TEMPS_MORT;  // Temps mort entre sorties complémentaires.
     CCPTMRS0bits.C3TSEL = 0;        // Utilise TMR2.
 
-    // Active les CCP4 et CCP5 en mode capture, tous sur le TMR 1:
+#ifdef RC_SBUS
+    // Active la EUSART en réception SBUS: 100000 bauds, 8 bits plus
+    // un bit de parité (ignoré), signal inversé:
+    BAUDCON1bits.BRG16 = 1;         // Générateur de 16 bits.
+    TXSTA1bits.BRGH = 1;            // Haute vitesse.
+    SPBRGH1 = 0;
+    SPBRG1 = 159;                   // 64MHz / (4 * (159 + 1)) = 100000 bauds.
+    BAUDCON1bits.DTRXP = 1;         // Réception inversée.
+    TXSTA1bits.SYNC = 0;            // Mode asynchrone.
+    RCSTA1bits.RX9 = 1;             // Réception de 9 bits.
+    RCSTA1bits.SPEN = 1;            // Active la EUSART.
+    RCSTA1bits.CREN = 1;            // Active le récepteur.
+    PIE1bits.RC1IE = 1;             // Active les interruptions.
+    IPR1bits.RC1IP = 0;             // Basse priorité.
+#else
+    // Active les CCP4 et CCP5 en mode capture, tous sur le TMR 1.
+    // En mode PPM, seul le CCP5 est utilisé:
+#ifndef RC_PPM
     CCP4CONbits.CCP4M = 5;          // Capture du flanc montant.
     CCPTMRS1bits.C4TSEL = 0;        // Utilise TMR1
     PIE4bits.CCP4IE = 1;            // Active les interruptions.
     IPR4bits.CCP4IP = 0;            // Basse priorité.
+#endif
     
     CCP5CONbits.CCP5M = 5;          // Capture du flanc montant.
     CCPTMRS1bits.C5TSEL = 0;        // Utilise TMR1
     PIE4bits.CCP5IE = 1;            // Active les interruptions.
     IPR4bits.CCP5IP = 0;            // Basse priorité.
+#endif
     
     // Active le MSSP2 en mode Esclave I2C:
     SSP2CON1bits.SSPEN = 1;             // Active le module SSP.    
@@ -289,6 +379,8 @@ void hardwareInitialise() {
 
     PIE3bits.SSP2IE = 1;                // Interruption en cas de transmission I2C...
     IPR3bits.SSP2IP = 0;                // ... de basse priorité.
+    PIE3bits.BCL2IE = 1;                // Interruption en cas de collision en mode maître...
+    IPR3bits.BCL2IP = 0;                // ... de basse priorité.
 
     // Active les interruptions générales:
     RCONbits.IPEN = 1;
@@ -299,9 +391,13 @@ void hardwareInitialise() {
     PORTA = 0;
     PORTB = 0;
     PORTC = 0;
-    TRISA = 0b10111111;  // RA6 est une sortie.
+    TRISA = 0b00011111;  // RA5, RA6 et RA7 sont les sorties des servos.
     TRISB = 0b11111111;  // I2C + Entrées analogiques du port B.
+#ifdef RC_SBUS
+    TRISC = 0b10000000;  // RC7 (RX1) est une entrée, les autres des sorties.
+#else
     TRISC = 0b00000000;  // Tous les bits du port C comme sorties.
+#endif
 }
 
 /**
@@ -311,12 +407,20 @@ void hardwareInitialise() {
  */
 void main() {
     struct EVENEMENT_ET_VALEUR *ev;
+    unsigned char baseDeTemps;
 
     // Configure tous les ports comme entrées:
     TRISA = 0xFF;
     TRISB = 0xFF;
     TRISC = 0xFF;
 
+    // Établit les courbes de la télécommande avant les interruptions:
+    initialiseCapture();
+    ppmInitialise();
+    sbusInitialise();
+    servoInitialise();
+    calibrationInitialise();
+
     // Initialise le hardware:
     hardwareInitialise();
     
@@ -325,18 +429,35 @@ void main() {
     initialiseEvenements();
     initialiseMessagesInternes();
     initialiseDirection();
+    telemetrieInitialise();
 
     // Surveille la file d'événements, et les traite au fur
-    // et à mesure:
+    // et à mesure. Prépare aussi la trame suivante des servos
+    // quand l'interruption la demande, et traite les commandes reçues
+    // par le bus I2C (elles produisent des messages internes). Une fois
+    // toutes les machines passées par la base de temps, publie la 
+    // télémétrie:
     while(fileDeborde() == 0) {
+        servoPlanifie();
+        i2cTraiteCommandes();
         ev = defileEvenement();
+        if (ev == 0) {
+            ev = defileMessageInterne();
+        }
         if (ev != 0) {
+            baseDeTemps = (ev->evenement == BASE_DE_TEMPS);
             do {
                 MOTEUR_machine(ev);
                 PUISSANCE_machine(ev);
                 DIRECTION_machine(ev);
+                CALIBRATION_machine(ev);
+                TELEMETRIE_machine(ev);
+                SEQUENCEUR_machine(ev);
                 ev = defileMessageInterne();
             } while (ev != 0);
+            if (baseDeTemps) {
+                i2cPublieTelemetrie();
+            }
         }
     }
 
@@ -375,6 +496,16 @@ void main() {
     test_direction();
     test_capture();
     test_puissance();
+    test_profil();
+    test_sequenceur();
+    test_filtre();
+    test_calibration();
+    test_ppm();
+    test_sbus();
+    test_servo();
+    test_i2c();
+    test_telemetrie();
+    test_reglages();
 
     finaliseTests();
     
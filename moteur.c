@@ -47,6 +47,8 @@ const Pwm const pwmParPhase[7] = {
 /**
  * Configure les PWM par rapport à la phase spécifiée, à la tension moyenne
  * et à la direction de rotation.
+ * La phase et le rapport cyclique sont aussi publiés sur le tableau de 
+ * bord, pour synchroniser la lecture de courant avec le PWM.
  * @param tensionMoyenne Tension moyenne à utiliser. Il est conseillé de ne pas utiliser
  * une valeur trop forte ici, pour ne pas brûler le circuit.
  */
@@ -58,9 +60,13 @@ void calculeAmplitudes(MagnitudeEtDirection *tensionMoyenne, unsigned char phase
         AH = 0;
         BH = 0;
         CH = 0;
+        tableauDeBord.phaseCommutee = 0;
+        tableauDeBord.rapportCyclique = 0;
     } else {
         pwm = pwmParPhase[phase];
         magnitude = tensionMoyenne->magnitude;
+        tableauDeBord.phaseCommutee = phase;
+        tableauDeBord.rapportCyclique = magnitude;
         switch (tensionMoyenne->direction) {
             case AVANT:
                 AH = pwm.avant.A.H ? magnitude : 0;
@@ -150,7 +156,7 @@ void mesureVitesse(unsigned char phase, MagnitudeEtDirection *mesureDeVitesse) {
 }
 
 void MOTEUR_machine(EvenementEtValeur *ev) {
-    static MagnitudeEtDirection *tensionMoyenne;
+    static MagnitudeEtDirection *tensionMoyenne = &tableauDeBord.tensionMoyenne;
     static MagnitudeEtDirection mesureDeVitesse = {0, AVANT};
     static unsigned char phase;
 
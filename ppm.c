@@ -0,0 +1,181 @@
+#include "domaine.h"
+#include "capture.h"
+#include "ppm.h"
+#include "test.h"
+
+/** 
+ * Durée minimum, en ticks, de l'intervalle de synchronisation
+ * entre deux trames (3ms). Les intervalles des canaux ne dépassent
+ * pas 2,2ms.
+ */
+#define PPM_SYNCHRONISATION 6000
+
+/** Instant du flanc précédent. */
+unsigned int ppmInstantPrecedent = 0;
+
+/** 
+ * Indique si le décodeur est synchronisé. Il ne l'est pas avant le
+ * premier intervalle de synchronisation, ni après une pulsation
+ * invalide.
+ */
+unsigned char ppmSynchronise = FALSE;
+
+/** Prochain canal à décoder dans la trame en cours. */
+unsigned char ppmCanal = 0;
+
+/** Nombre de canaux de la dernière trame complète. */
+unsigned char ppmCanauxDerniereTrame = 0;
+
+/** Dernière valeur décodée de chaque canal. */
+unsigned int ppmValeurs[PPM_NOMBRE_MAX_DE_CANAUX];
+
+/**
+ * Initialise le décodeur PPM. Le décodage commence à la prochaine
+ * synchronisation.
+ */
+void ppmInitialise() {
+    unsigned char canal;
+
+    ppmSynchronise = FALSE;
+    ppmCanal = 0;
+    ppmCanauxDerniereTrame = 0;
+    for (canal = 0; canal < PPM_NOMBRE_MAX_DE_CANAUX; canal++) {
+        ppmValeurs[canal] = NEUTRE_CONSIGNE;
+    }
+}
+
+/**
+ * Signale un flanc du signal PPM. Dans un signal PPM, la valeur de 
+ * chaque canal est l'intervalle entre deux flancs consécutifs du 
+ * même sens, et les trames sont séparées par un intervalle plus long.
+ * Une pulsation invalide désynchronise le décodeur jusqu'à la 
+ * prochaine trame, pour ne pas attribuer les valeurs au mauvais canal.
+ * @param instant Instant au quel a été capturé le flanc.
+ * @return Le numéro du canal décodé, ou PPM_AUCUN_CANAL.
+ */
+unsigned char ppmFlanc(unsigned int instant) {
+    unsigned int duree;
+    unsigned char canal;
+    unsigned int valeur;
+
+    duree = instant - ppmInstantPrecedent;
+    ppmInstantPrecedent = instant;
+
+    if (duree >= PPM_SYNCHRONISATION) {
+        if (ppmSynchronise) {
+            ppmCanauxDerniereTrame = ppmCanal;
+        }
+        ppmSynchronise = TRUE;
+        ppmCanal = 0;
+        return PPM_AUCUN_CANAL;
+    }
+    if ((!ppmSynchronise) || (ppmCanal >= PPM_NOMBRE_MAX_DE_CANAUX)) {
+        return PPM_AUCUN_CANAL;
+    }
+
+    canal = ppmCanal;
+    valeur = captureConvertit(canal, duree);
+    if (valeur == CAPTURE_PULSATION_INVALIDE) {
+        ppmSynchronise = FALSE;
+        return PPM_AUCUN_CANAL;
+    }
+    ppmValeurs[canal] = valeur;
+    ppmCanal++;
+    return canal;
+}
+
+/**
+ * Récupère la dernière valeur décodée d'un canal.
+ * @param canal Le canal.
+ * @return La consigne, entre 0 et CONSIGNE_MAX.
+ */
+unsigned int ppmValeur(unsigned char canal) {
+    return ppmValeurs[canal];
+}
+
+/**
+ * Indique le nombre de canaux de la dernière trame complète.
+ * @return Le nombre de canaux, ou 0 si aucune trame n'a été reçue.
+ */
+unsigned char ppmNombreDeCanaux() {
+    return ppmCanauxDerniereTrame;
+}
+
+#ifdef TEST
+/**
+ * Simule une trame PPM.
+ * @param instant Instant du flanc de synchronisation.
+ * @param durees Durée de chaque canal.
+ * @param nombre Nombre de canaux.
+ * @return Instant du dernier flanc.
+ */
+unsigned int trame(unsigned int instant, const unsigned int *durees, unsigned char nombre) {
+    unsigned char n;
+
+    ppmFlanc(instant);
+    for (n = 0; n < nombre; n++) {
+        instant += durees[n];
+        ppmFlanc(instant);
+    }
+    return instant;
+}
+
+void decode_une_trame_de_8_canaux() {
+    const unsigned int durees[] = {3000, 2000, 4000, 2500, 3500, 3000, 2000, 4000};
+    unsigned int instant;
+
+    initialiseCapture();
+    ppmInitialise();
+
+    // Avant la première synchronisation, rien n'est décodé:
+    verifieEgalite("PPM01", ppmFlanc(1000), PPM_AUCUN_CANAL);
+    verifieEgalite("PPM02", ppmFlanc(4000), PPM_AUCUN_CANAL);
+
+    // Intervalle de synchronisation, puis les canaux dans l'ordre:
+    verifieEgalite("PPM03", ppmFlanc(20000), PPM_AUCUN_CANAL);
+    verifieEgalite("PPM04", ppmFlanc(23000), 0);
+    verifieEgalite("PPM05", ppmFlanc(25000), 1);
+    instant = trame(40000, durees, 8);
+    verifieEgalite("PPM11", ppmValeur(0), NEUTRE_CONSIGNE);
+    verifieEgalite("PPM12", ppmValeur(1), 0);
+    verifieEgalite("PPM13", ppmValeur(2), CONSIGNE_MAX);
+    verifieEgalite("PPM14", ppmValeur(3), 1024);
+    verifieEgalite("PPM15", ppmValeur(4), 3071);
+    verifieEgalite("PPM16", ppmValeur(7), CONSIGNE_MAX);
+
+    // Un canal de trop est ignoré:
+    verifieEgalite("PPM17", ppmFlanc(instant + 3000), PPM_AUCUN_CANAL);
+
+    // Le nombre de canaux est connu à la trame suivante:
+    trame(instant + 10000, durees, 6);
+    verifieEgalite("PPM21", ppmNombreDeCanaux(), 8);
+    ppmFlanc(instant + 40000);
+    verifieEgalite("PPM22", ppmNombreDeCanaux(), 6);
+}
+
+void se_desynchronise_apres_une_pulsation_invalide() {
+    const unsigned int durees[] = {3000, 3000, 3000, 3000};
+    unsigned int instant;
+
+    initialiseCapture();
+    ppmInitialise();
+    instant = trame(10000, durees, 4);
+
+    // Un parasite au milieu de la trame:
+    ppmFlanc(instant + 10000);
+    verifieEgalite("PPMD01", ppmFlanc(instant + 13000), 0);
+    verifieEgalite("PPMD02", ppmFlanc(instant + 13200), PPM_AUCUN_CANAL);
+    verifieEgalite("PPMD03", ppmFlanc(instant + 16000), PPM_AUCUN_CANAL);
+    verifieEgalite("PPMD04", captureNombreDePulsationsRejetees(1), 1);
+
+    // Resynchronisation à la trame suivante:
+    verifieEgalite("PPMD11", ppmFlanc(instant + 30000), PPM_AUCUN_CANAL);
+    verifieEgalite("PPMD12", ppmFlanc(instant + 33000), 0);
+    verifieEgalite("PPMD13", ppmFlanc(instant + 36000), 1);
+}
+
+void test_ppm() {
+    decode_une_trame_de_8_canaux();
+    se_desynchronise_apres_une_pulsation_invalide();
+}
+#endif
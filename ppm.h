@@ -0,0 +1,19 @@
+#ifndef PPM__H
+#define	PPM__H
+
+/** Nombre maximum de canaux dans une trame PPM. */
+#define PPM_NOMBRE_MAX_DE_CANAUX 8
+
+/** Valeur retournée par ppmFlanc si aucun canal n'est décodé. */
+#define PPM_AUCUN_CANAL 255
+
+void ppmInitialise();
+unsigned char ppmFlanc(unsigned int instant);
+unsigned int ppmValeur(unsigned char canal);
+unsigned char ppmNombreDeCanaux();
+
+#ifdef TEST
+void test_ppm();
+#endif
+
+#endif
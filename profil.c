@@ -0,0 +1,584 @@
+#include "profil.h"
+#include "test.h"
+
+/**
+ * Paramètres par défaut du profil. Toutes les grandeurs sont exprimées
+ * en 1/256 de phase, et le pas de temps est PROFIL_DUREE_BASE_DE_TEMPS.
+ */
+#define PROFIL_VITESSE_MAX 768
+#define PROFIL_ACCELERATION 32
+#define PROFIL_JERK 8
+
+/**
+ * Vitesse minimum du profil. Garantit que le profil arrive au bout
+ * même si la décélération a commencé un peu trop tôt.
+ */
+#define PROFIL_VITESSE_MIN 32
+
+/**
+ * Paramètres du générateur de profil.
+ */
+typedef struct {
+    /** Vitesse maximum, en 1/256 de phase par pas de temps. */
+    unsigned int vitesseMax;
+
+    /** Accélération maximum, en 1/256 de phase par pas de temps². */
+    unsigned int acceleration;
+
+    /**
+     * Variation maximum de l'accélération, en 1/256 de phase par pas
+     * de temps³. Avec 0, le profil est trapézoïdal; sinon il est en S.
+     */
+    unsigned int jerk;
+} ParametresProfil;
+
+static ParametresProfil parametresProfil = {
+    PROFIL_VITESSE_MAX,
+    PROFIL_ACCELERATION,
+    PROFIL_JERK
+};
+
+/**
+ * État du générateur de profil.
+ */
+typedef struct {
+    /** Distance totale à parcourir, en 1/256 de phase. */
+    unsigned int distance;
+
+    /** Position de consigne actuelle, en 1/256 de phase. */
+    unsigned int position;
+
+    /** Vitesse de consigne actuelle, en 1/256 de phase par pas de temps. */
+    unsigned int vitesse;
+
+    /** Accélération actuelle, en 1/256 de phase par pas de temps². */
+    int acceleration;
+
+    /** Nombre de phases entières déjà transmises au régulateur. */
+    unsigned char phasesEmises;
+
+    /** Indique que le freinage a commencé: le profil ne réaccélère plus. */
+    unsigned char freinage;
+} Profil;
+
+static Profil profil = {0, 0, 0, 0, 0, FALSE};
+
+/**
+ * Établit les paramètres du générateur de profil.
+ * Les nouveaux paramètres s'appliquent dès le prochain pas de temps.
+ * @param vitesseMax Vitesse maximum, en 1/256 de phase par pas de temps.
+ * @param acceleration Accélération maximum, en 1/256 de phase par pas de temps².
+ * @param jerk Variation maximum de l'accélération par pas de temps. 0 pour
+ * un profil trapézoïdal.
+ */
+void profilConfigure(unsigned int vitesseMax,
+                     unsigned int acceleration,
+                     unsigned int jerk) {
+    if (vitesseMax < PROFIL_VITESSE_MIN) {
+        vitesseMax = PROFIL_VITESSE_MIN;
+    }
+    if (acceleration == 0) {
+        acceleration = 1;
+    }
+    parametresProfil.vitesseMax = vitesseMax;
+    parametresProfil.acceleration = acceleration;
+    parametresProfil.jerk = jerk;
+}
+
+/**
+ * Établit la vitesse maximum du générateur de profil, sans modifier
+ * l'accélération ni le jerk. Si le profil en cours va plus vite, il
+ * ralentit progressivement jusqu'à la nouvelle vitesse maximum.
+ * @param vitesseMax Vitesse maximum, en 1/256 de phase par pas de temps,
+ * ou 0 pour la vitesse maximum par défaut. Une vitesse supérieure à la
+ * vitesse maximum par défaut est ramenée à celle-ci.
+ */
+void profilEtablitVitesseMax(unsigned int vitesseMax) {
+    if ((vitesseMax == 0) || (vitesseMax > PROFIL_VITESSE_MAX)) {
+        vitesseMax = PROFIL_VITESSE_MAX;
+    }
+    if (vitesseMax < PROFIL_VITESSE_MIN) {
+        vitesseMax = PROFIL_VITESSE_MIN;
+    }
+    parametresProfil.vitesseMax = vitesseMax;
+}
+
+/**
+ * Établit l'accélération et le jerk du générateur de profil, sans 
+ * modifier la vitesse maximum. Les nouveaux paramètres s'appliquent 
+ * dès le prochain pas de temps.
+ * @param acceleration Accélération maximum, en 1/256 de phase par pas
+ * de temps², ou 0 pour rétablir l'accélération et le jerk par défaut.
+ * @param jerk Variation maximum de l'accélération par pas de temps. 0 
+ * pour un profil trapézoïdal.
+ */
+void profilEtablitAcceleration(unsigned int acceleration, unsigned int jerk) {
+    if (acceleration == 0) {
+        acceleration = PROFIL_ACCELERATION;
+        jerk = PROFIL_JERK;
+    }
+    parametresProfil.acceleration = acceleration;
+    parametresProfil.jerk = jerk;
+}
+
+/**
+ * Démarre un nouveau profil, à partir de l'arrêt.
+ * @param distance Distance à parcourir, en phases.
+ */
+void profilDemarre(unsigned char distance) {
+    profil.distance = ((unsigned int) distance) << 8;
+    profil.position = 0;
+    profil.vitesse = 0;
+    profil.acceleration = 0;
+    profil.phasesEmises = 0;
+    profil.freinage = FALSE;
+}
+
+/**
+ * Prolonge le profil en cours, sans repasser par l'arrêt: la vitesse
+ * et l'accélération sont conservées, et le freinage est repoussé à la
+ * fin de la nouvelle distance.
+ * @param distance Distance supplémentaire à parcourir, en phases.
+ * @return TRUE si le profil est prolongé, FALSE s'il est déjà terminé
+ * ou si la distance totale restante dépasserait 255 phases.
+ */
+unsigned char profilProlonge(unsigned char distance) {
+    unsigned int dejaEmises;
+
+    if (profilTermine()) {
+        return FALSE;
+    }
+    if (profilDistanceRestante() + distance > 255) {
+        return FALSE;
+    }
+
+    // Ramène l'origine aux phases déjà émises, pour garder de la place:
+    dejaEmises = ((unsigned int) profil.phasesEmises) << 8;
+    profil.distance -= dejaEmises;
+    profil.position -= dejaEmises;
+    profil.phasesEmises = 0;
+
+    profil.distance += ((unsigned int) distance) << 8;
+    profil.freinage = FALSE;
+    return TRUE;
+}
+
+/**
+ * Rend la distance que la consigne doit encore parcourir.
+ * @return La distance, en phases entières pas encore émises.
+ */
+unsigned char profilDistanceRestante() {
+    return (unsigned char) (profil.distance >> 8) - profil.phasesEmises;
+}
+
+/**
+ * Calcule la distance nécessaire pour s'arrêter depuis la vitesse actuelle.
+ * @return La distance, en 1/256 de phase.
+ */
+unsigned long distanceDeFreinage() {
+    unsigned long v = profil.vitesse;
+    unsigned long a, t;
+    unsigned long d = 0;
+
+    // Si le profil accélère encore, la vitesse continue de monter
+    // pendant que le jerk ramène l'accélération à zéro:
+    if ((profil.acceleration > 0) && (parametresProfil.jerk > 0)) {
+        a = profil.acceleration;
+        t = (a + parametresProfil.jerk - 1) / parametresProfil.jerk;
+        d = v * t + (a * t * t) / 2;
+        v += (a * t) / 2;
+    }
+
+    // Décélération constante, plus la correction d'intégration discrète
+    // et la distance du pas en cours, qui est déjà engagé:
+    d += (v * v) / (2 * parametresProfil.acceleration) + v / 2 + v;
+
+    // Temps supplémentaire pour établir la décélération:
+    if (parametresProfil.jerk > 0) {
+        d += (v * parametresProfil.acceleration) / (2 * parametresProfil.jerk);
+    }
+    return d;
+}
+
+/**
+ * Avance le profil d'un pas de temps.
+ * @return Le nombre de phases dont la consigne avance pendant ce pas.
+ */
+unsigned char profilAvance() {
+    unsigned long restant;
+    unsigned long position;
+    long vitesse;
+    int accelerationCible;
+    unsigned char ralentit = FALSE;
+    unsigned char phases;
+
+    restant = profil.distance - profil.position;
+    if (restant == 0) {
+        return 0;
+    }
+
+    // Accélère, maintient la vitesse, ou freine. Une fois que le
+    // freinage a commencé, le profil ne réaccélère plus, même si
+    // l'estimation de la distance de freinage diminue. Si la vitesse
+    // maximum a été abaissée en cours de route, le profil ralentit
+    // avec la même décélération que pour freiner:
+    if (restant <= distanceDeFreinage()) {
+        accelerationCible = - (int) parametresProfil.acceleration;
+        profil.freinage = TRUE;
+    } else if (profil.vitesse > parametresProfil.vitesseMax) {
+        accelerationCible = - (int) parametresProfil.acceleration;
+        ralentit = TRUE;
+    } else if (profil.freinage) {
+        accelerationCible = 0;
+    } else if (profil.vitesse < parametresProfil.vitesseMax) {
+        accelerationCible = parametresProfil.acceleration;
+    } else {
+        accelerationCible = 0;
+    }
+
+    // Limite la variation d'accélération:
+    if (parametresProfil.jerk == 0) {
+        profil.acceleration = accelerationCible;
+    } else if (profil.acceleration < accelerationCible) {
+        profil.acceleration += parametresProfil.jerk;
+        if (profil.acceleration > accelerationCible) {
+            profil.acceleration = accelerationCible;
+        }
+    } else if (profil.acceleration > accelerationCible) {
+        profil.acceleration -= parametresProfil.jerk;
+        if (profil.acceleration < accelerationCible) {
+            profil.acceleration = accelerationCible;
+        }
+    }
+
+    // Intègre l'accélération:
+    vitesse = (long) profil.vitesse + profil.acceleration;
+    if (ralentit) {
+        if (vitesse <= parametresProfil.vitesseMax) {
+            vitesse = parametresProfil.vitesseMax;
+            profil.acceleration = 0;
+        }
+    } else if (vitesse > parametresProfil.vitesseMax) {
+        vitesse = parametresProfil.vitesseMax;
+    }
+    if (vitesse < PROFIL_VITESSE_MIN) {
+        vitesse = PROFIL_VITESSE_MIN;
+        profil.acceleration = 0;
+    }
+
+    // Intègre la vitesse, sans jamais dépasser la distance:
+    position = (unsigned long) profil.position + vitesse;
+    if (position >= profil.distance) {
+        position = profil.distance;
+        vitesse = 0;
+        profil.acceleration = 0;
+    }
+    profil.position = (unsigned int) position;
+    profil.vitesse = (unsigned int) vitesse;
+
+    // Transmet seulement les phases entières:
+    phases = (unsigned char) (profil.position >> 8) - profil.phasesEmises;
+    profil.phasesEmises += phases;
+    return phases;
+}
+
+/**
+ * Rend la vitesse de consigne actuelle.
+ * @return La vitesse, en 1/256 de phase par pas de temps.
+ */
+unsigned int profilVitesse() {
+    return profil.vitesse;
+}
+
+/**
+ * Rend l'accélération de consigne actuelle.
+ * @return L'accélération, en 1/256 de phase par pas de temps².
+ */
+int profilAcceleration() {
+    return profil.acceleration;
+}
+
+/**
+ * Indique si le profil est arrivé au bout de la distance.
+ * @return TRUE si la consigne a atteint la distance demandée.
+ */
+unsigned char profilTermine() {
+    if (profil.position == profil.distance) {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+#ifdef TEST
+/**
+ * Parcourt le profil complet et vérifie qu'il arrive exactement à la
+ * distance demandée, sans jamais dépasser la vitesse maximum.
+ */
+void parcourt_exactement_la_distance_demandee() {
+    unsigned int total = 0;
+    unsigned int pas = 0;
+    unsigned char phases;
+    unsigned char phasesMax = 0;
+
+    profilConfigure(512, 32, 0);
+    profilDemarre(190);
+    verifieEgalite("PRF_D00", profilTermine(), FALSE);
+
+    while (!profilTermine() && pas < 1000) {
+        phases = profilAvance();
+        if (phases > phasesMax) {
+            phasesMax = phases;
+        }
+        total += phases;
+        pas++;
+    }
+    verifieEgalite("PRF_D01", total, 190);
+    verifieIntervale("PRF_D02", phasesMax, 1, 2);
+    verifieIntervale("PRF_D03", pas, 95, 140);
+    verifieEgalite("PRF_D04", profilAvance(), 0);
+}
+
+/**
+ * Au démarrage, la consigne avance progressivement.
+ */
+void demarre_progressivement() {
+    unsigned int total = 0;
+    unsigned char n;
+
+    profilConfigure(768, 32, 0);
+    profilDemarre(100);
+    for (n = 0; n < 8; n++) {
+        total += profilAvance();
+    }
+    // 32 + 64 + ... + 256 = 1152 / 256 = 4 phases:
+    verifieEgalite("PRF_P01", total, 4);
+}
+
+/**
+ * Avec une limite de jerk, l'accélération s'établit plus lentement.
+ */
+void limite_la_variation_d_acceleration() {
+    unsigned int totalTrapeze = 0;
+    unsigned int totalS = 0;
+    unsigned char n;
+
+    profilConfigure(768, 32, 0);
+    profilDemarre(200);
+    for (n = 0; n < 10; n++) {
+        totalTrapeze += profilAvance();
+    }
+
+    profilConfigure(768, 32, 4);
+    profilDemarre(200);
+    for (n = 0; n < 10; n++) {
+        totalS += profilAvance();
+    }
+    verifieNonZero("PRF_J01", totalS < totalTrapeze);
+
+    while (!profilTermine()) {
+        totalS += profilAvance();
+    }
+    verifieEgalite("PRF_J02", totalS, 200);
+}
+
+/**
+ * Sur une distance courte, le freinage commence alors que le profil 
+ * accélère encore: il doit tout de même arriver au bout à la vitesse
+ * minimum, sans réaccélérer.
+ */
+void freine_a_temps_sur_une_courte_distance() {
+    unsigned int vitesseFinale = 0;
+    int accelerationPrecedente = 0;
+    unsigned char reaccelere = FALSE;
+
+    profilConfigure(PROFIL_VITESSE_MAX, PROFIL_ACCELERATION, PROFIL_JERK);
+    profilDemarre(8);
+    while (!profilTermine()) {
+        vitesseFinale = profilVitesse();
+        profilAvance();
+        if ((accelerationPrecedente < 0) && (profilAcceleration() > 0)) {
+            reaccelere = TRUE;
+        }
+        accelerationPrecedente = profilAcceleration();
+    }
+    verifieEgalite("PRF_C01", vitesseFinale, PROFIL_VITESSE_MIN);
+    verifieEgalite("PRF_C02", reaccelere, FALSE);
+}
+
+/**
+ * La vitesse maximum peut être limitée sans toucher à l'accélération.
+ */
+void limite_la_vitesse_maximum() {
+    unsigned int vitesseMax = 0;
+
+    profilConfigure(768, 32, 0);
+    profilEtablitVitesseMax(256);
+    profilDemarre(100);
+    while (!profilTermine()) {
+        profilAvance();
+        if (profilVitesse() > vitesseMax) {
+            vitesseMax = profilVitesse();
+        }
+    }
+    verifieEgalite("PRF_V01", vitesseMax, 256);
+
+    profilEtablitVitesseMax(0);
+    verifieEgalite("PRF_V02", parametresProfil.vitesseMax, PROFIL_VITESSE_MAX);
+    verifieEgalite("PRF_V03", parametresProfil.acceleration, 32);
+
+    // La vitesse maximum par défaut ne peut pas être dépassée:
+    profilEtablitVitesseMax(255 << 4);
+    verifieEgalite("PRF_V04", parametresProfil.vitesseMax, PROFIL_VITESSE_MAX);
+}
+
+/**
+ * L'accélération et le jerk peuvent être modifiés sans toucher à la
+ * vitesse maximum.
+ */
+void etablit_l_acceleration_et_le_jerk() {
+    unsigned int pas = 0;
+
+    profilConfigure(256, PROFIL_ACCELERATION, PROFIL_JERK);
+    profilEtablitAcceleration(16, 0);
+    verifieEgalite("PRF_A01", parametresProfil.vitesseMax, 256);
+    verifieEgalite("PRF_A02", parametresProfil.acceleration, 16);
+    verifieEgalite("PRF_A03", parametresProfil.jerk, 0);
+
+    // Profil trapézoïdal, qui part de la vitesse minimum: 15 pas pour
+    // atteindre la vitesse maximum:
+    profilDemarre(100);
+    while (profilVitesse() < 256) {
+        profilAvance();
+        pas++;
+    }
+    verifieEgalite("PRF_A04", pas, 15);
+
+    profilEtablitAcceleration(0, 0);
+    verifieEgalite("PRF_A05", parametresProfil.acceleration, PROFIL_ACCELERATION);
+    verifieEgalite("PRF_A06", parametresProfil.jerk, PROFIL_JERK);
+}
+
+/**
+ * Un profil prolongé avant sa fin ne s'arrête pas entre les deux
+ * distances, et parcourt exactement leur somme.
+ */
+void prolonge_sans_s_arreter() {
+    unsigned int total = 0;
+    unsigned int vitesseALaJonction = 0;
+    unsigned char restant;
+    unsigned char prolonge = FALSE;
+
+    profilConfigure(512, 32, 0);
+    profilDemarre(100);
+    while (!profilTermine()) {
+        total += profilAvance();
+        if (!prolonge && profilDistanceRestante() <= 40) {
+            restant = profilDistanceRestante();
+            verifieEgalite("PRF_L01", profilProlonge(100), TRUE);
+            verifieEgalite("PRF_L02", profilDistanceRestante(), restant + 100);
+            prolonge = TRUE;
+        }
+        if (vitesseALaJonction == 0 && total >= 100) {
+            vitesseALaJonction = profilVitesse();
+        }
+    }
+    verifieEgalite("PRF_L03", total, 200);
+    verifieEgalite("PRF_L04", vitesseALaJonction, 512);
+
+    // Un profil terminé ne peut plus être prolongé:
+    verifieEgalite("PRF_L05", profilProlonge(10), FALSE);
+
+    // La distance restante ne peut pas dépasser 255 phases:
+    profilDemarre(200);
+    profilAvance();
+    verifieEgalite("PRF_L06", profilProlonge(100), FALSE);
+    verifieEgalite("PRF_L07", profilDistanceRestante(), 200);
+}
+
+/**
+ * Enchaîne une distance parcourue à la vitesse maximum par défaut avec
+ * une distance parcourue à vitesse réduite, comme deux manoeuvres
+ * enchaînées.
+ * @param jerk Variation maximum de l'accélération.
+ * @param pasAVitesseReduite Reçoit le nombre de pas parcourus à la
+ * vitesse réduite.
+ * @return La plus grande variation de vitesse entre deux pas.
+ */
+unsigned int enchaineUneDistanceLente(unsigned int jerk, unsigned int *pasAVitesseReduite) {
+    unsigned int total = 0;
+    unsigned int vitessePrecedente = 0;
+    unsigned int variation;
+    unsigned int variationMax = 0;
+    unsigned char prolonge = FALSE;
+
+    *pasAVitesseReduite = 0;
+    profilConfigure(PROFIL_VITESSE_MAX, PROFIL_ACCELERATION, jerk);
+    profilDemarre(100);
+    while (!profilTermine()) {
+        total += profilAvance();
+        if (profilVitesse() > vitessePrecedente) {
+            variation = profilVitesse() - vitessePrecedente;
+        } else {
+            variation = vitessePrecedente - profilVitesse();
+        }
+        if (profilTermine()) {
+            // La dernière avance s'arrête sur la distance:
+            variation = 0;
+        }
+        if (variation > variationMax) {
+            variationMax = variation;
+        }
+        vitessePrecedente = profilVitesse();
+        if (profilVitesse() == 256) {
+            (*pasAVitesseReduite)++;
+        }
+        if (!prolonge && profilDistanceRestante() <= 60) {
+            profilEtablitVitesseMax(256);
+            profilProlonge(100);
+            prolonge = TRUE;
+        }
+    }
+    verifieEgalite("PRF_R00", total, 200);
+    return variationMax;
+}
+
+/**
+ * Si la vitesse maximum est abaissée en cours de route, le profil
+ * ralentit progressivement, sans dépasser l'accélération maximum.
+ */
+void ralentit_progressivement_vers_une_vitesse_maximum_abaissee() {
+    unsigned int pasAVitesseReduite;
+
+    verifieIntervale("PRF_R01", enchaineUneDistanceLente(0, &pasAVitesseReduite), 1, PROFIL_ACCELERATION);
+    verifieNonZero("PRF_R02", pasAVitesseReduite > 10);
+
+    verifieIntervale("PRF_R11", enchaineUneDistanceLente(PROFIL_JERK, &pasAVitesseReduite), 1, PROFIL_ACCELERATION);
+    verifieNonZero("PRF_R12", pasAVitesseReduite > 10);
+}
+
+/**
+ * Un profil de distance nulle est immédiatement terminé.
+ */
+void termine_immediatement_une_distance_nulle() {
+    profilDemarre(0);
+    verifieEgalite("PRF_Z01", profilTermine(), TRUE);
+    verifieEgalite("PRF_Z02", profilAvance(), 0);
+}
+
+/**
+ * Tests unitaires pour le générateur de profil.
+ */
+void test_profil() {
+    parcourt_exactement_la_distance_demandee();
+    demarre_progressivement();
+    limite_la_variation_d_acceleration();
+    freine_a_temps_sur_une_courte_distance();
+    limite_la_vitesse_maximum();
+    etablit_l_acceleration_et_le_jerk();
+    prolonge_sans_s_arreter();
+    ralentit_progressivement_vers_une_vitesse_maximum_abaissee();
+    termine_immediatement_une_distance_nulle();
+
+    profilConfigure(PROFIL_VITESSE_MAX, PROFIL_ACCELERATION, PROFIL_JERK);
+}
+#endif
@@ -0,0 +1,29 @@
+#include "domaine.h"
+
+#ifndef __PROFIL_H
+#define __PROFIL_H
+
+/**
+ * Nombre de périodes du PWM moteur (TMR2) entre deux pas du
+ * générateur de profil. 156 périodes de 64uS font environ 10mS.
+ */
+#define PROFIL_DUREE_BASE_DE_TEMPS 156
+
+void profilConfigure(unsigned int vitesseMax,
+                     unsigned int acceleration,
+                     unsigned int jerk);
+void profilEtablitVitesseMax(unsigned int vitesseMax);
+void profilEtablitAcceleration(unsigned int acceleration, unsigned int jerk);
+void profilDemarre(unsigned char distance);
+unsigned char profilProlonge(unsigned char distance);
+unsigned char profilDistanceRestante();
+unsigned char profilAvance();
+unsigned int profilVitesse();
+int profilAcceleration();
+unsigned char profilTermine();
+
+#ifdef TEST
+void test_profil();
+#endif
+
+#endif
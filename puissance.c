@@ -5,12 +5,28 @@
 #include "puissance.h"
 #include "test.h"
 #include "tableauDeBord.h"
+#include "profil.h"
 #include "i2c.h"
 
 #define TENSION_MOYENNE_MAX 180 * 64 
 #define TENSION_MOYENNE_MAX_REDUITE 40 * 64
-#define TENSION_ALIMENTATION_MIN 7.4
-#define LECTURE_ALIMENTATION_MIN (unsigned char) (255 * (TENSION_ALIMENTATION_MIN / 2) / 5)
+
+/**
+ * Tensions d'alimentation, en volts. La tension d'alimentation arrive
+ * sur l'entrée analogique à travers un diviseur par 2, et le convertisseur
+ * A/D a une référence de 5V: il ne peut pas mesurer plus de 10V. Une
+ * batterie qui descend de 16.8V (4S chargée) à 7.2V n'est donc pas
+ * mesurable sans modifier le diviseur. Les seuils correspondent donc
+ * à une batterie 2S: la compensation ramène la tension à 7.4V nominale,
+ * la puissance est réduite en dessous de 7.0V, et coupée à 6.4V.
+ */
+#define TENSION_ALIMENTATION_NOMINALE 7.4
+#define TENSION_ALIMENTATION_MIN 7.0
+#define TENSION_ALIMENTATION_COUPURE 6.4
+#define LECTURE_ALIMENTATION(tension) (unsigned int) (LECTURE_AD_MAX * ((tension) / 2) / 5)
+#define LECTURE_ALIMENTATION_NOMINALE LECTURE_ALIMENTATION(TENSION_ALIMENTATION_NOMINALE)
+#define LECTURE_ALIMENTATION_MIN LECTURE_ALIMENTATION(TENSION_ALIMENTATION_MIN)
+#define LECTURE_ALIMENTATION_COUPURE LECTURE_ALIMENTATION(TENSION_ALIMENTATION_COUPURE)
 
 /**
  * Énumère les type de régulation PID.
@@ -32,170 +48,570 @@ ModePid modePid = MODE_PID_DEPLACEMENT;
 
 /** 
  * La tension moyenne maximum peut varier si la tension d'alimentation
- * tombe en dessous d'un certain seuil.
+ * tombe en dessous d'un certain seuil, ou si la température monte.
  */
 static int tensionMoyenneMax = TENSION_MOYENNE_MAX;
 
+/** Tension moyenne maximum admise selon la tension d'alimentation. */
+static int tensionMoyenneMaxAlimentation = TENSION_MOYENNE_MAX;
+
+/** Lecture de la tension d'alimentation filtrée, multipliée par 16. */
+static unsigned int alimentationFiltree = LECTURE_ALIMENTATION_NOMINALE * 16;
+
+/** Dernière lecture filtrée de la tension d'alimentation. */
+static unsigned int alimentation = LECTURE_ALIMENTATION_NOMINALE;
+
+/**
+ * Facteur de compensation de la tension d'alimentation, multiplié 
+ * par 256. C'est la tension nominale divisée par la tension mesurée.
+ */
+static unsigned int compensationAlimentation = 256;
+
+/** Tension moyenne maximum admise selon la température. */
+static int tensionMoyenneMaxTemperature = TENSION_MOYENNE_MAX;
+
 /**
- * En mode manoeuvre il s'agit toujours d'atteindre le déplacement zéro.
+ * Convertit une lecture du capteur de température en degrés.
+ * Le capteur produit 500mV à 0°C, plus 10mV/°C, et le convertisseur A/D
+ * lit LECTURE_AD_MAX pour 5V.
+ */
+#define DEGRES(lecture) ((int) (((unsigned long) (lecture) * 500) / LECTURE_AD_MAX) - 50)
+
+/** Lecture du capteur de température correspondant à environ 25°C. */
+#define LECTURE_TEMPERATURE_AMBIANTE 153
+
+/** Température par défaut à partir de laquelle la puissance est réduite. */
+#define TEMPERATURE_DEBUT_REDUCTION 80
+
+/** Température par défaut à laquelle la puissance est réduite au minimum. */
+#define TEMPERATURE_FIN_REDUCTION 110
+
+/** Tension moyenne maximum lorsque la réduction thermique est complète. */
+#define TENSION_MOYENNE_MAX_THERMIQUE TENSION_MOYENNE_MAX_REDUITE
+
+/** Température, en °C, à partir de laquelle la puissance est réduite. */
+static unsigned char temperatureDebutReduction = TEMPERATURE_DEBUT_REDUCTION;
+
+/** Température, en °C, à laquelle la puissance est réduite au minimum. */
+static unsigned char temperatureFinReduction = TEMPERATURE_FIN_REDUCTION;
+
+/** Lecture de température filtrée, multipliée par 16. */
+static unsigned int temperatureFiltree = LECTURE_TEMPERATURE_AMBIANTE * 16;
+
+/** Dernière température calculée, en °C. */
+static int temperature = DEGRES(LECTURE_TEMPERATURE_AMBIANTE);
+
+/** 
+ * Courant maximum mesurable, en Ampères.
+ * Le capteur produit 50mV/A, et le convertisseur A/D lit LECTURE_AD_MAX 
+ * pour 5V.
+ */
+#define COURANT_MAX 100
+
+/** Convertit des Ampères en unités de lecture du capteur de courant. */
+#define LECTURE_COURANT(amperes) (unsigned int) (((unsigned long) (amperes) * LECTURE_AD_MAX) / COURANT_MAX)
+
+/** Convertit une lecture du capteur de courant en Ampères. */
+#define AMPERES(lecture) (unsigned char) (((unsigned long) (lecture) * COURANT_MAX) / LECTURE_AD_MAX)
+
+/** Limite de courant par défaut, en Ampères. */
+#define LIMITE_COURANT_DEFAUT 40
+
+/** Courant maximum admis, en unités de lecture du capteur. */
+static unsigned int limiteCourant = LECTURE_COURANT(LIMITE_COURANT_DEFAUT);
+
+/** 
+ * Magnitude maximum de la tension moyenne, établie par la boucle
+ * de limitation de courant.
  */
-static MagnitudeEtDirection deplacementZero = {AVANT, 0};
+static unsigned char tensionLimiteeParCourant = 255;
+
+/** Diviseur appliqué lors de la dernière correction de tension moyenne. */
+static unsigned char diviseurTensionMoyenne = 6;
 
 /** Paramètres PID. */
 #define P_VITESSE 24
 #define D_VITESSE 9
 
-#define P_DEPLACEMENT 2
-#define D_DEPLACEMENT 1
+#define P_DEPLACEMENT 740 // Par phase d'erreur de déplacement.
+#define V_DEPLACEMENT 30  // Par 1/256 de phase par pas d'erreur de vitesse.
+#define F_DEPLACEMENT 8   // Anticipation, selon la vitesse du profil.
+#define A_DEPLACEMENT 288 // Anticipation, selon l'accélération du profil.
+
+/** Nombre de pas de profil sur lesquels on mesure la vitesse. */
+#define NOMBRE_PAS_MESURE_VITESSE 4
 
 static int tensionMoyenne = 0;   // Tension moyenne, multipliée par 32
 static int erreurPrecedente = 0; // Erreur précédente, pour calculer D.
 
+/** 
+ * Vitesse demandée, en seizièmes des unités de vitesse mesurée, pour
+ * profiter de toute la résolution des consignes de 12 bits.
+ */
+static int consigneVitesse = 0;
+
+/** Phases parcourues pendant chacun des derniers pas de profil. */
+static signed char phasesParPas[NOMBRE_PAS_MESURE_VITESSE];
+static unsigned char indicePhasesParPas = 0;
+
+/** Phases parcourues depuis le début du pas de profil en cours. */
+static signed char phasesPasEnCours = 0;
+
+/** Direction du déplacement produit par le générateur de profil. */
+static Direction directionProfil = AVANT;
+
+/** Indique que DEPLACEMENT_ATTEINT a déjà été émis pour ce déplacement. */
+static unsigned char deplacementSignale = FALSE;
+
+#ifdef REGULATEUR_AJUSTABLE
+/**
+ * Sur la machine hôte, les paramètres des régulateurs deviennent des
+ * variables, pour que le simulateur puisse les balayer.
+ */
+static ParametresRegulateurs parametresRegulateurs = {
+    P_VITESSE, D_VITESSE,
+    P_DEPLACEMENT, V_DEPLACEMENT, F_DEPLACEMENT, A_DEPLACEMENT,
+    TENSION_MOYENNE_MAX
+};
+#undef P_VITESSE
+#undef D_VITESSE
+#undef P_DEPLACEMENT
+#undef V_DEPLACEMENT
+#undef F_DEPLACEMENT
+#undef A_DEPLACEMENT
+#undef TENSION_MOYENNE_MAX
+#define P_VITESSE parametresRegulateurs.pVitesse
+#define D_VITESSE parametresRegulateurs.dVitesse
+#define P_DEPLACEMENT parametresRegulateurs.pDeplacement
+#define V_DEPLACEMENT parametresRegulateurs.vDeplacement
+#define F_DEPLACEMENT parametresRegulateurs.fDeplacement
+#define A_DEPLACEMENT parametresRegulateurs.aDeplacement
+#define TENSION_MOYENNE_MAX parametresRegulateurs.tensionMoyenneMax
+
+/**
+ * Copie les paramètres des régulateurs par défaut.
+ * @param parametres Les paramètres à initialiser.
+ */
+void parametresRegulateursParDefaut(ParametresRegulateurs *parametres) {
+    *parametres = parametresRegulateurs;
+}
+
+/**
+ * Établit les paramètres des régulateurs. À appeler avant le premier
+ * événement, puisque les limites de tension moyenne sont réinitialisées.
+ * @param parametres Les nouveaux paramètres.
+ */
+void etablitParametresRegulateurs(const ParametresRegulateurs *parametres) {
+    parametresRegulateurs = *parametres;
+    tensionMoyenneMax = TENSION_MOYENNE_MAX;
+    tensionMoyenneMaxAlimentation = TENSION_MOYENNE_MAX;
+    tensionMoyenneMaxTemperature = TENSION_MOYENNE_MAX;
+}
+#endif
+
 /**
  * Réinitialise le PID.
  */
 void initialisePid() {
+    unsigned char n;
+
     tensionMoyenne = 0;
     erreurPrecedente = 0;
+    tensionLimiteeParCourant = 255;
+    for (n = 0; n < NOMBRE_PAS_MESURE_VITESSE; n++) {
+        phasesParPas[n] = 0;
+    }
+    phasesPasEnCours = 0;
 }
 
-void corrigeTensionMoyenne(int correction, unsigned char diviseur) {
+/**
+ * Transfère la tension moyenne sur le tableau de bord, en respectant
+ * la limite établie par la boucle de courant.
+ * @return TRUE si la tension moyenne du tableau de bord a changé.
+ */
+unsigned char publieTensionMoyenne() {
     int magnitude;
+    Direction direction;
+    
+    if (tensionMoyenne < 0) {
+        direction = ARRIERE;
+        magnitude = -tensionMoyenne;
+    } else {
+        direction = AVANT;
+        magnitude = tensionMoyenne;
+    }
+    if (magnitude > tensionMoyenneMax) {
+        magnitude = tensionMoyenneMax;
+    }
+    magnitude >>= diviseurTensionMoyenne;
+
+    // Compense les variations de la tension d'alimentation:
+    magnitude = (int) (((unsigned long) magnitude * compensationAlimentation) >> 8);
+    if (magnitude > 255) {
+        magnitude = 255;
+    }
+
+    // Respecte la limite de courant:
+    if (magnitude > tensionLimiteeParCourant) {
+        magnitude = tensionLimiteeParCourant;
+    }
+    
+    if ((tableauDeBord.tensionMoyenne.direction == direction)
+            && (tableauDeBord.tensionMoyenne.magnitude == magnitude)) {
+        return FALSE;
+    }
+    tableauDeBord.tensionMoyenne.direction = direction;
+    tableauDeBord.tensionMoyenne.magnitude = (unsigned char) magnitude;
+    i2cExposeValeur(LECTURE_I2C_TENSION_MOYENNE, tableauDeBord.tensionMoyenne.magnitude);
+    return TRUE;
+}
+
+void corrigeTensionMoyenne(int correction, unsigned char diviseur) {
+    int limite;
 
     // Corrige la tension moyenne:
     tensionMoyenne += correction;
 
     // Limite la tension moyenne:
-    if (tensionMoyenne < -tensionMoyenneMax) {
-        tensionMoyenne = -tensionMoyenneMax;
+    limite = tensionMoyenneMax;
+    if ((((int) tensionLimiteeParCourant) << diviseur) < limite) {
+        // Évite que le régulateur accumule de la tension pendant
+        // que la limite de courant est active:
+        limite = ((int) tensionLimiteeParCourant) << diviseur;
     }
-    if (tensionMoyenne > tensionMoyenneMax) {
-        tensionMoyenne = tensionMoyenneMax;
+    if (tensionMoyenne < -limite) {
+        tensionMoyenne = -limite;
+    }
+    if (tensionMoyenne > limite) {
+        tensionMoyenne = limite;
     }
 
     // Transfère la tension moyenne sur le tableau de bord:
-    if (tensionMoyenne < 0) {
-        tableauDeBord.tensionMoyenne.direction = ARRIERE;
-        magnitude = -tensionMoyenne;
+    diviseurTensionMoyenne = diviseur;
+    publieTensionMoyenne();
+}
+
+/**
+ * Boucle interne de limitation de courant.
+ * Réduit la tension maximum admise en proportion du dépassement de
+ * la limite de courant, puis la rétablit progressivement.
+ * Le dépassement est divisé par 4 pour conserver le gain de la boucle
+ * avec les lectures de 10 bits.
+ * @param lecture Lecture du capteur de courant, sur 10 bits.
+ */
+void regulateurCourant(unsigned int lecture) {
+    unsigned int exces;
+
+    if (lecture > limiteCourant) {
+        exces = (lecture - limiteCourant) >> 2;
+        if (tensionLimiteeParCourant > exces) {
+            tensionLimiteeParCourant -= exces;
+        } else {
+            tensionLimiteeParCourant = 0;
+        }
     } else {
-        tableauDeBord.tensionMoyenne.direction = AVANT;
-        magnitude = tensionMoyenne;
+        if (tensionLimiteeParCourant < 255) {
+            tensionLimiteeParCourant++;
+        }
+    }
+}
+
+/**
+ * Établit la tension moyenne maximum, en retenant la plus restrictive
+ * entre la limite d'alimentation et la limite thermique.
+ */
+void etablitTensionMoyenneMax() {
+    if (tensionMoyenneMaxTemperature < tensionMoyenneMaxAlimentation) {
+        tensionMoyenneMax = tensionMoyenneMaxTemperature;
+    } else {
+        tensionMoyenneMax = tensionMoyenneMaxAlimentation;
+    }
+}
+
+/**
+ * Filtre la lecture de la tension d'alimentation. Si elle a changé, 
+ * recalcule le facteur de compensation et la tension moyenne maximum
+ * selon la courbe de coupure.
+ * Entre la tension minimum et la tension de coupure, la tension 
+ * moyenne maximum diminue linéairement jusqu'à zéro.
+ * @param lecture Lecture de la tension d'alimentation, sur 10 bits.
+ */
+void mesureAlimentation(unsigned int lecture) {
+    long reduction;
+
+    alimentationFiltree -= alimentationFiltree >> 4;
+    alimentationFiltree += lecture;
+    lecture = alimentationFiltree >> 4;
+    if (lecture == alimentation) {
+        return;
+    }
+    alimentation = lecture;
+    i2cExposeValeur(LECTURE_I2C_ALIMENTATION, (unsigned char) (alimentation >> 2));
+
+    // Facteur de compensation (une seule division par lecture):
+    if (alimentation > LECTURE_ALIMENTATION_COUPURE) {
+        compensationAlimentation = 
+            (unsigned int) ((((unsigned long) LECTURE_ALIMENTATION_NOMINALE) << 8) / alimentation);
+    }
+
+    // Courbe de coupure:
+    if (alimentation >= LECTURE_ALIMENTATION_MIN) {
+        tensionMoyenneMaxAlimentation = TENSION_MOYENNE_MAX;
+    } else if (alimentation <= LECTURE_ALIMENTATION_COUPURE) {
+        tensionMoyenneMaxAlimentation = 0;
+    } else {
+        reduction = (long) TENSION_MOYENNE_MAX;
+        reduction *= alimentation - LECTURE_ALIMENTATION_COUPURE;
+        reduction /= LECTURE_ALIMENTATION_MIN - LECTURE_ALIMENTATION_COUPURE;
+        tensionMoyenneMaxAlimentation = (int) reduction;
+    }
+    etablitTensionMoyenneMax();
+}
+
+/**
+ * Calcule la tension moyenne maximum selon la courbe de réduction
+ * thermique, et met à jour l'état thermique.
+ * Entre le début et la fin de la réduction, la tension maximum
+ * diminue linéairement avec la température.
+ */
+void calculeReductionThermique() {
+    long reduction;
+    EtatThermique etatThermique;
+
+    if (temperature <= temperatureDebutReduction) {
+        tensionMoyenneMaxTemperature = TENSION_MOYENNE_MAX;
+        etatThermique = ETAT_THERMIQUE_NORMAL;
+    } else if (temperature >= temperatureFinReduction) {
+        tensionMoyenneMaxTemperature = TENSION_MOYENNE_MAX_THERMIQUE;
+        etatThermique = ETAT_THERMIQUE_REDUCTION_MAXIMUM;
+    } else {
+        reduction = (long) (TENSION_MOYENNE_MAX - TENSION_MOYENNE_MAX_THERMIQUE);
+        reduction *= temperature - temperatureDebutReduction;
+        reduction /= temperatureFinReduction - temperatureDebutReduction;
+        tensionMoyenneMaxTemperature = TENSION_MOYENNE_MAX - (int) reduction;
+        etatThermique = ETAT_THERMIQUE_REDUCTION;
+    }
+    etablitTensionMoyenneMax();
+    i2cExposeValeur(LECTURE_I2C_ETAT_THERMIQUE, etatThermique);
+}
+
+/**
+ * Filtre la lecture du capteur de température, et recalcule
+ * la réduction thermique si la température a changé.
+ * @param lecture Lecture du capteur de température, sur 10 bits.
+ */
+void mesureTemperature(unsigned int lecture) {
+    int nouvelleTemperature;
+
+    temperatureFiltree -= temperatureFiltree >> 4;
+    temperatureFiltree += lecture;
+    nouvelleTemperature = DEGRES(temperatureFiltree >> 4);
+    if (nouvelleTemperature != temperature) {
+        temperature = nouvelleTemperature;
+        if (temperature < 0) {
+            i2cExposeValeur(LECTURE_I2C_TEMPERATURE, 0);
+        } else {
+            i2cExposeValeur(LECTURE_I2C_TEMPERATURE, (unsigned char) temperature);
+        }
+        calculeReductionThermique();
     }
-    magnitude >>= diviseur;
-    tableauDeBord.tensionMoyenne.magnitude = (unsigned char) magnitude;
-    i2cExposeValeur(LECTURE_I2C_TENSION_MOYENNE, tableauDeBord.tensionMoyenne.magnitude);
+}
+
+/**
+ * Établit la courbe de réduction thermique.
+ * @param debut Température, en °C, à partir de laquelle la puissance 
+ * est réduite.
+ * @param fin Température, en °C, à laquelle la puissance est réduite 
+ * au minimum.
+ */
+void etablitCourbeDeReductionThermique(unsigned char debut, unsigned char fin) {
+    if (debut == 255) {
+        debut = 254;
+    }
+    if (fin <= debut) {
+        fin = debut + 1;
+    }
+    temperatureDebutReduction = debut;
+    temperatureFinReduction = fin;
+    calculeReductionThermique();
+}
+
+/**
+ * Établit la limite de courant.
+ * @param amperes Limite de courant, en Ampères.
+ */
+void etablitLimiteDeCourant(unsigned char amperes) {
+    if (amperes > COURANT_MAX) {
+        amperes = COURANT_MAX;
+    }
+    limiteCourant = LECTURE_COURANT(amperes);
 }
 
 /**
  * Corrige la tension moyenne du {@link TableauDeBord} selon la différence 
  * observée entre la vitesse mesurée et la vitesse demandée.
+ * Les erreurs sont calculées en seizièmes d'unité de vitesse.
  * @param vitesseMesuree Dernière vitesse mesurée.
- * @param vitesseDemandee Dernière vitesse demandée.
+ * @param consigne Vitesse demandée, en seizièmes d'unité de vitesse.
  */
-void regulateurVitesse(MagnitudeEtDirection *vitesseMesuree, 
-                       MagnitudeEtDirection *vitesseDemandee) {        
+void regulateurVitesse(MagnitudeEtDirection *vitesseMesuree, int consigne) {        
     int erreurD;
     int erreurP;
-    int correction;
+    int mesure;
+    long correction;
+
+    mesure = ((int) vitesseMesuree->magnitude) << 4;
+    if (vitesseMesuree->direction == ARRIERE) {
+        mesure = -mesure;
+    }
 
     // Calcule l'erreur P:
-    erreurP = compareAetB(vitesseDemandee, vitesseMesuree);
-    correction  = erreurP * P_VITESSE;
+    erreurP = consigne - mesure;
+    correction  = (long) erreurP * P_VITESSE;
     
     // Calcule l'erreur D:
     erreurD = erreurP - erreurPrecedente;
     erreurPrecedente = erreurP;
-    correction += erreurD * D_VITESSE;
+    correction += (long) erreurD * D_VITESSE;
 
-    corrigeTensionMoyenne(correction, 6);
+    corrigeTensionMoyenne((int) (correction >> 4), 6);
 }
 
+/**
+ * Démarre le générateur de profil vers le déplacement demandé.
+ * L'erreur de déplacement n'est pas modifiée ici: c'est le générateur de 
+ * profil qui l'alimente, pas à pas, à chaque BASE_DE_TEMPS_PROFIL.
+ * @param valeur Déplacement demandé, entre 0 et 255. 128 est neutre.
+ */
 void initialiseRegulateurDeDeplacement(unsigned char valeur) {
     MagnitudeEtDirection magnitudeEtDirection;
     convertitEnMagnitudeEtDirection(valeur, &magnitudeEtDirection);
-    opereAmoinsB(&(tableauDeBord.deplacementDemande), &magnitudeEtDirection);
+    directionProfil = magnitudeEtDirection.direction;
+    profilDemarre(magnitudeEtDirection.magnitude);
+    deplacementSignale = FALSE;
 }
 
 /**
- * Corrige la tension moyenne du {@link TableauDeBord} pour réduire l'erreur
- * de déplacement à zéro.
- * @param erreurDePosition Distance encore à parcourir.
- * @param tempsDeDeplacement Temps écoulé depuis la dernière mesure de distance.
- * @return 0 tant que le déplacement demandé n'est pas atteint.
- */
-unsigned char regulateurDeplacement(MagnitudeEtDirection *deplacementMesure, 
-                           unsigned char tempsDeDeplacement) {
- 
-    static const unsigned char const div[255] = {
-        8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-        8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 
-        9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 
-        10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 
-        11, 11, 11, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 13, 
-        13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14, 
-        14, 15, 15, 15, 15, 15, 15, 15, 15, 15, 16, 16, 16, 16, 16, 16, 16, 17, 
-        17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 20, 
-        20, 20, 20, 20, 21, 21, 21, 21, 21, 22, 22, 22, 22, 23, 23, 23, 24, 24, 
-        24, 24, 25, 25, 25, 26, 26, 26, 27, 27, 27, 28, 28, 29, 29, 30, 30, 30, 
-        31, 31, 32, 32, 33, 34, 34, 35, 35, 36, 37, 37, 38, 39, 40, 40, 41, 42, 
-        43, 44, 45, 46, 47, 48, 49, 51, 52, 53, 55, 56, 58, 60, 61, 63, 65, 68, 
-        70, 72, 75, 78, 81, 85, 88, 92, 97, 102, 107, 113, 120, 127, 136, 145, 
-        156, 170, 185, 204, 226, 255, 255, 255, 255, 255, 255, 255, 255     
-    };
- 
-    int erreurP;
-    int erreurD;
-    int correction;
-    
-    /** Calcule l'erreur P: */
-    switch (tableauDeBord.deplacementDemande.direction) {
-        case ARRIERE:
-            erreurP = tableauDeBord.deplacementDemande.magnitude;
-            break;
-        case AVANT:
-            erreurP = - tableauDeBord.deplacementDemande.magnitude;
-            break;
+ * Émet DEPLACEMENT_ATTEINT, une seule fois par déplacement: une fois 
+ * arrivé, le moteur peut encore osciller d'une phase autour de la 
+ * position, et chaque retour ne doit pas déclencher une autre manoeuvre.
+ */
+void signaleDeplacementAtteint() {
+    if (!deplacementSignale) {
+        deplacementSignale = TRUE;
+        enfileMessageInterne(DEPLACEMENT_ATTEINT, 0);
     }
+}
 
-    // Calcule l'erreur D:
-    if (deplacementMesure->magnitude == 1) {
-        switch (deplacementMesure->direction) {
-            case ARRIERE:
-                erreurP++;
-                erreurD = div[tempsDeDeplacement];
-                break;
-            case AVANT:
-                erreurP--;
-                erreurD = -div[tempsDeDeplacement];
-                break;
-        }
-    } else {
-        erreurD = 0;
+/**
+ * Prolonge le déplacement en cours, sans passer par l'arrêt. La distance
+ * supplémentaire s'ajoute à celle que le générateur de profil doit encore
+ * transmettre à l'erreur de déplacement.
+ * Un changement de sens ne peut pas se faire sans s'arrêter: il est ignoré.
+ * @param valeur Déplacement supplémentaire, entre 0 et 255. 128 est neutre.
+ */
+void prolongeRegulateurDeDeplacement(unsigned char valeur) {
+    MagnitudeEtDirection magnitudeEtDirection;
+    convertitEnMagnitudeEtDirection(valeur, &magnitudeEtDirection);
+    if (magnitudeEtDirection.direction == directionProfil) {
+        profilProlonge(magnitudeEtDirection.magnitude);
     }
-    
-    // Calcule la correction:
-    correction = erreurP * P_DEPLACEMENT + erreurD * D_DEPLACEMENT;
+}
 
-    // Corrige la tension moyenne:
-    corrigeTensionMoyenne(correction, 7);
-    
-    // Met à jour le déplacement
-    if (erreurP < 0) {
-        tableauDeBord.deplacementDemande.direction = AVANT;
-        tableauDeBord.deplacementDemande.magnitude = - erreurP;
-    } else {
-        tableauDeBord.deplacementDemande.direction = ARRIERE;
-        tableauDeBord.deplacementDemande.magnitude = erreurP;        
+/**
+ * Calcule l'erreur de déplacement, c'est à dire la distance encore
+ * à parcourir pour rejoindre la consigne.
+ * @return La distance, en phases. Positive en marche avant.
+ */
+int erreurDeDeplacement() {
+    if (tableauDeBord.deplacementDemande.direction == ARRIERE) {
+        return tableauDeBord.deplacementDemande.magnitude;
+    }
+    return - (int) tableauDeBord.deplacementDemande.magnitude;
+}
+
+/**
+ * Met à jour l'erreur de déplacement selon le déplacement mesuré.
+ * @param deplacementMesure Dernier déplacement mesuré.
+ * @return 0 tant que le déplacement demandé n'est pas atteint, ou que
+ * le générateur de profil n'est pas arrivé au bout.
+ */
+unsigned char mesureDeplacement(MagnitudeEtDirection *deplacementMesure) {
+    if (deplacementMesure->magnitude == 1) {
+        opereAplusB(&(tableauDeBord.deplacementDemande), deplacementMesure);
+        if (deplacementMesure->direction == AVANT) {
+            phasesPasEnCours++;
+        } else {
+            phasesPasEnCours--;
+        }
     }
-    if (erreurP == 0) {
+    if ((tableauDeBord.deplacementDemande.magnitude == 0) && profilTermine()) {
         return TRUE;
     }
     return FALSE;
 }
 
-unsigned char regulateurDeplacementArrete() {
-    static MagnitudeEtDirection deplacementZero = {AVANT, 0};
-    return regulateurDeplacement(&deplacementZero, 0);
+/**
+ * Avance la consigne d'un pas du générateur de profil, et établit la 
+ * tension moyenne du {@link TableauDeBord} pour suivre le profil.
+ * La tension est la somme de l'anticipation (vitesse et accélération du 
+ * profil), de la correction de position et de la correction de vitesse.
+ * @return TRUE si la consigne vient d'atteindre le déplacement demandé, et
+ * que le déplacement mesuré l'a rejoint.
+ */
+unsigned char regulateurDeplacement() {
+    MagnitudeEtDirection pas;
+    unsigned char n;
+    unsigned char atteint = FALSE;
+    int vitesseDemandee;
+    int vitesseMesuree;
+    int accelerationDemandee;
+    long tension;
+
+    // Avance la consigne:
+    if (!profilTermine()) {
+        pas.direction = directionProfil;
+        pas.magnitude = profilAvance();
+        opereAmoinsB(&(tableauDeBord.deplacementDemande), &pas);
+        if (profilTermine() && (tableauDeBord.deplacementDemande.magnitude == 0)) {
+            atteint = TRUE;
+        }
+    }
+
+    // Mesure la vitesse sur les derniers pas:
+    phasesParPas[indicePhasesParPas++] = phasesPasEnCours;
+    if (indicePhasesParPas >= NOMBRE_PAS_MESURE_VITESSE) {
+        indicePhasesParPas = 0;
+    }
+    phasesPasEnCours = 0;
+    vitesseMesuree = 0;
+    for (n = 0; n < NOMBRE_PAS_MESURE_VITESSE; n++) {
+        vitesseMesuree += phasesParPas[n];
+    }
+    vitesseMesuree = (vitesseMesuree * 256) / NOMBRE_PAS_MESURE_VITESSE;
+
+    // Vitesse et accélération de la consigne:
+    vitesseDemandee = profilVitesse();
+    accelerationDemandee = profilAcceleration();
+    if (directionProfil == ARRIERE) {
+        vitesseDemandee = -vitesseDemandee;
+        accelerationDemandee = -accelerationDemandee;
+    }
+
+    // Calcule la tension:
+    tension  = (long) vitesseDemandee * F_DEPLACEMENT;
+    tension += (long) accelerationDemandee * A_DEPLACEMENT;
+    tension += (long) erreurDeDeplacement() * P_DEPLACEMENT;
+    tension += (long) (vitesseDemandee - vitesseMesuree) * V_DEPLACEMENT;
+    if (tension < -tensionMoyenneMax) {
+        tension = -tensionMoyenneMax;
+    }
+    if (tension > tensionMoyenneMax) {
+        tension = tensionMoyenneMax;
+    }
+    corrigeTensionMoyenne((int) tension - tensionMoyenne, 7);
+
+    return atteint;
 }
 
 /**
@@ -207,51 +623,82 @@ void PUISSANCE_machine(EvenementEtValeur *ev) {
     
     switch(ev->evenement) {
         case LECTURE_ALIMENTATION:
-            if (ev->valeur < LECTURE_ALIMENTATION_MIN) {
-                if (tensionMoyenneMax > TENSION_MOYENNE_MAX_REDUITE) {
-                    tensionMoyenneMax -= 32;
-                }
-            } else {
-                if (tensionMoyenneMax < TENSION_MOYENNE_MAX) {
-                    tensionMoyenneMax += 32;
-                }
+            mesureAlimentation(ev->valeur);
+            if (publieTensionMoyenne()) {
+                enfileMessageInterne(MOTEUR_TENSION_MOYENNE, 0);
+            }
+            break;
+
+        case LECTURE_TEMPERATURE:
+            mesureTemperature(ev->valeur);
+            break;
+
+        case TEMPERATURE_DEBUT_REDUCTION_DEMANDEE:
+            etablitCourbeDeReductionThermique(ev->valeur, temperatureFinReduction);
+            break;
+
+        case TEMPERATURE_FIN_REDUCTION_DEMANDEE:
+            etablitCourbeDeReductionThermique(temperatureDebutReduction, ev->valeur);
+            break;
+
+        case LECTURE_COURANT:
+            i2cExposeValeur(LECTURE_I2C_COURANT, AMPERES(LECTURE_AD(ev->valeur)));
+            regulateurCourant(LECTURE_AD(ev->valeur));
+            if (publieTensionMoyenne()) {
+                enfileMessageInterne(MOTEUR_TENSION_MOYENNE, 0);
             }
             break;
 
+        case LIMITE_COURANT_DEMANDEE:
+            etablitLimiteDeCourant(ev->valeur);
+            break;
+
+        case PROFIL_DEMANDE:
+            profilEtablitAcceleration(ev->valeur >> 8, ev->valeur & 0xFF);
+            break;
+
         case VITESSE_MESUREE:
             if (modePid == MODE_PID_VITESSE) {
                 regulateurVitesse(&(tableauDeBord.vitesseMesuree), 
-                                  &(tableauDeBord.vitesseDemandee));
+                                  consigneVitesse);
                 enfileMessageInterne(MOTEUR_TENSION_MOYENNE, 0);
             }
             break;
             
-        case DEPLACEMENT_ARRETE:
+        case BASE_DE_TEMPS_PROFIL:
             if (modePid == MODE_PID_DEPLACEMENT) {
-                regulateurDeplacementArrete();
+                if (regulateurDeplacement()) {
+                    signaleDeplacementAtteint();
+                }
                 enfileMessageInterne(MOTEUR_TENSION_MOYENNE, 0);
             }
             break;
             
         case MOTEUR_PHASE:
             if (modePid == MODE_PID_DEPLACEMENT) {
-                if (regulateurDeplacement(&(tableauDeBord.deplacementMesure), 
-                                      tableauDeBord.tempsDeDeplacement)) {
-                    enfileMessageInterne(DEPLACEMENT_ATTEINT, 0);
+                if (mesureDeplacement(&(tableauDeBord.deplacementMesure))) {
+                    signaleDeplacementAtteint();
                 }
-                enfileMessageInterne(MOTEUR_TENSION_MOYENNE, 0);
             }
             break;
 
         case VITESSE_DEMANDEE:
             modePid = MODE_PID_VITESSE;
-            convertitEnMagnitudeEtDirection(ev->valeur, &(tableauDeBord.vitesseDemandee));
+            consigneVitesse = convertitConsigne(ev->valeur);
+            convertitEnMagnitudeEtDirection((unsigned char) (ev->valeur >> 4), 
+                                            &(tableauDeBord.vitesseDemandee));
             break;
             
         case DEPLACEMENT_DEMANDE:
             modePid = MODE_PID_DEPLACEMENT;
             initialiseRegulateurDeDeplacement(ev->valeur);
             break;
+
+        case DEPLACEMENT_PROLONGE:
+            if (modePid == MODE_PID_DEPLACEMENT) {
+                prolongeRegulateurDeDeplacement(ev->valeur);
+            }
+            break;
     }
 }
 
@@ -340,7 +787,7 @@ float calculeTempsDePhase(float acceleration, float vitesse, float distance) {
 
 }
 void test_pid_atteint_la_vitesse_demandee() {
-    EvenementEtValeur vitesseDemandee = {VITESSE_DEMANDEE, NEUTRE + 50};
+    EvenementEtValeur vitesseDemandee = {VITESSE_DEMANDEE, CONSIGNE(NEUTRE + 50)};
     tableauDeBord.vitesseMesuree.direction = AVANT;
     tableauDeBord.vitesseMesuree.magnitude = 0;
     initialisePid();
@@ -350,6 +797,20 @@ void test_pid_atteint_la_vitesse_demandee() {
     verifieEgalite("PIDV01", tableauDeBord.vitesseMesuree.magnitude, 50 * 2);
 }
 
+/**
+ * Simule une tension d'alimentation stable.
+ * @param lecture Lecture de la tension d'alimentation.
+ */
+void etablitLectureAlimentation(unsigned int lecture) {
+    EvenementEtValeur lectureAlimentation = {LECTURE_ALIMENTATION, 0};
+    int n;
+
+    lectureAlimentation.valeur = lecture;
+    for (n = 0; n < 1000; n++) {
+        PUISSANCE_machine(&lectureAlimentation);
+    }
+}
+
 void test_limite_la_tension_moyenne_maximum() {
     int n;
     EvenementEtValeur evenementEtValeur;
@@ -358,12 +819,12 @@ void test_limite_la_tension_moyenne_maximum() {
 
     // Marche avant:
     evenementEtValeur.evenement = VITESSE_DEMANDEE;
-    evenementEtValeur.valeur = 80;
+    evenementEtValeur.valeur = CONSIGNE(80);
     PUISSANCE_machine(&evenementEtValeur);    
 
     for (n = 0; n < 1000; n++) {
         // Avertit que l'alimentation est trop basse:
-        evenementEtValeur.valeur = LECTURE_ALIMENTATION_MIN - 1;
+        evenementEtValeur.valeur = LECTURE_ALIMENTATION_COUPURE;
         evenementEtValeur.evenement = LECTURE_ALIMENTATION;
         PUISSANCE_machine(&evenementEtValeur);    
 
@@ -374,78 +835,234 @@ void test_limite_la_tension_moyenne_maximum() {
     }
 
     // La tension moyenne de sortie est à zéro:
-    verifieEgalite("PMAX01", tableauDeBord.tensionMoyenne.magnitude, TENSION_MOYENNE_MAX_REDUITE/64);
+    verifieEgalite("PMAX01", tableauDeBord.tensionMoyenne.magnitude, 0);
+
+    // À mi-chemin de la courbe de coupure, la tension est réduite:
+    etablitLectureAlimentation((LECTURE_ALIMENTATION_COUPURE + LECTURE_ALIMENTATION_MIN) / 2);
+    for (n = 0; n < 100; n++) {
+        PUISSANCE_machine(&evenementEtValeur);            
+    }
+    verifieIntervale("PMAX02", tableauDeBord.tensionMoyenne.magnitude, 
+            TENSION_MOYENNE_MAX / 64 / 2 - 5, TENSION_MOYENNE_MAX / 64 / 2 + 15);
+
+    // À la tension nominale, la tension maximum est rétablie:
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_NOMINALE);
+    for (n = 0; n < 100; n++) {
+        PUISSANCE_machine(&evenementEtValeur);            
+    }
+    verifieEgalite("PMAX03", tableauDeBord.tensionMoyenne.magnitude, TENSION_MOYENNE_MAX / 64);
 }
 
-void test_pid_atteint_le_deplacement_demande() {
-    EvenementEtValeur deplacementDemande = {DEPLACEMENT_DEMANDE, NEUTRE + 50};
+void test_compense_la_tension_d_alimentation() {
+    EvenementEtValeur *message;
+
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_NOMINALE);
+    initialisePid();
+    corrigeTensionMoyenne(100 << 6, 6);
+    verifieEgalite("PALI01", tableauDeBord.tensionMoyenne.magnitude, 100);
+    verifieEgalite("PALI02", i2cRegistres.valeurs[LECTURE_I2C_ALIMENTATION], LECTURE_ALIMENTATION_NOMINALE >> 2);
+
+    // Une alimentation plus forte réduit le rapport cyclique:
+    initialiseMessagesInternes();
+    etablitLectureAlimentation(940);
+    verifieEgalite("PALI11", tableauDeBord.tensionMoyenne.magnitude, 
+            (100 * ((LECTURE_ALIMENTATION_NOMINALE * 256L) / 940)) >> 8);
+    message = defileMessageInterne();
+    verifieNonZero("PALI12", (int) message);
+    if (message) {
+        verifieEgalite("PALI13", message->evenement, MOTEUR_TENSION_MOYENNE);
+    }
+
+    // Une alimentation plus faible augmente le rapport cyclique:
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_MIN + 2);
+    verifieEgalite("PALI21", tableauDeBord.tensionMoyenne.magnitude, 
+            (100 * ((LECTURE_ALIMENTATION_NOMINALE * 256L) / (LECTURE_ALIMENTATION_MIN + 2))) >> 8);
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_NOMINALE);
+    verifieEgalite("PALI22", tableauDeBord.tensionMoyenne.magnitude, 100);
+
+    // Le rapport cyclique ne dépasse jamais le maximum:
+    corrigeTensionMoyenne(TENSION_MOYENNE_MAX, 6);
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_COUPURE + 1);
+    verifieIntervale("PALI31", tableauDeBord.tensionMoyenne.magnitude, 0, 255);
+
+    initialiseMessagesInternes();
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_NOMINALE);
+    initialisePid();
+}
+
+/**
+ * Simule le moteur et la voiture pendant un déplacement, en passant
+ * les changements de phase et les pas du générateur de profil au
+ * régulateur. Le déplacement doit déjà être demandé.
+ * @param duree Durée simulée, en secondes.
+ * @param positionMax Reçoit la position maximum atteinte, en phases.
+ * @return Nombre de DEPLACEMENT_ATTEINT émis.
+ */
+int simuleDeplacement(float duree, int *positionMax) {
     EvenementEtValeur deplacementArrete = {DEPLACEMENT_ARRETE, 0};
+    EvenementEtValeur baseDeTempsProfil = {BASE_DE_TEMPS_PROFIL, 0};
     EvenementEtValeur moteurPhase = {MOTEUR_PHASE, 0};
-    int n;
+    EvenementEtValeur *message;
+    int position;
+    int deplacementsAtteints;
     float alpha, omega, delta;
     float tau;
-    float tp;
-    float nt, ntt;
+    float t, tp;
+    float nt, ntt, ntp;
     float u;
 
-    initialisePid();
-    initialiseTableauDeBord();
+    omega = 0;
+    delta = 0;
+    position = 0;
+    *positionMax = 0;
+    deplacementsAtteints = 0;
+    nt = 255;
+    ntt = 255.0 / 1584.1;
+    ntp = PROFIL_DUREE_BASE_DE_TEMPS / 15625.0;
 
-    PUISSANCE_machine(&deplacementDemande);
-    verifieEgalite("PIDD01", tableauDeBord.deplacementDemande.magnitude, 2 * 50);
+    for (t = 0; t < duree; t += tp) {
+        u = 7.2 * tableauDeBord.tensionMoyenne.magnitude / 255.0;
+        if (tableauDeBord.tensionMoyenne.direction == ARRIERE) {
+            u = -u;
+        }
 
-    omega = 0;
-    
-    for (n = 0; n < 150; n++) {
-        delta = 0;
-        nt = 255;
-        ntt = 255.0 / 1584.1;
-        do {
-            u = 7.2 * tableauDeBord.tensionMoyenne.magnitude / 255.0;
-            if (tableauDeBord.tensionMoyenne.direction == ARRIERE) {
-                u = -u;
-            }
+        tau = 0.0613 * (u - omega / 230.4);
+        alpha = tau * 10333.2;
+        tp = calculeTempsDePhase(alpha, omega, 1.041) / 5.0;
+        if (tp > ntt) {
+            tp = ntt;
+        }
+        if (tp > ntp) {
+            tp = ntp;
+        }
+        delta += tp * tp * alpha / 2.0 + tp * omega;
+        omega += alpha * tp;
+        if (nt > 0) {
+            nt -= tp * 1584.1;
+        }
 
-            tau = 0.0613 * (u - omega / 230.4);
-            alpha = tau * 10333.2;
-            tp = calculeTempsDePhase(alpha, omega, 1.041) / 5.0;
-            if (tp > ntt) {
-                tp = ntt;
+        // Le moteur change de phase:
+        if (fabs(delta) >= 1.041) {
+            tableauDeBord.deplacementMesure.magnitude = 1;
+            if (delta < 0) {
+                tableauDeBord.deplacementMesure.direction = ARRIERE;
+                delta += 1.041;
+                position--;
+            } else {
+                tableauDeBord.deplacementMesure.direction = AVANT;
+                delta -= 1.041;
+                position++;
             }
-            delta += tp * tp * alpha / 2.0 + tp * omega;
-            omega += alpha * tp;
-
-            ntt -= tp;
-            if (ntt <= 0) {
-                tableauDeBord.deplacementMesure.magnitude = 0;
-                PUISSANCE_machine(&deplacementArrete);
-                verifieEgalite("PIDD01", defileMessageInterne()->evenement, MOTEUR_TENSION_MOYENNE);
-                ntt = 255.0 / 1584.1;
-            }            
-            if (nt > 0) {
-                nt -= tp * 1584.1;
-            } 
-        } while (fabs(delta) < 1.041);
-        
-        tableauDeBord.deplacementMesure.magnitude = 1;
-        if (delta < 0) {
-            tableauDeBord.deplacementMesure.direction = ARRIERE;
-        } else {
-            tableauDeBord.deplacementMesure.direction = AVANT;
+            if (position > *positionMax) {
+                *positionMax = position;
+            }
+            tableauDeBord.tempsDeDeplacement = (unsigned char) nt;
+            nt = 255;
+            ntt = 255.0 / 1584.1;
+            PUISSANCE_machine(&moteurPhase);
+            while ((message = defileMessageInterne()) != 0) {
+                if (message->evenement == DEPLACEMENT_ATTEINT) {
+                    deplacementsAtteints++;
+                }
+            }
+        }
+
+        // Le moteur est arrêté:
+        ntt -= tp;
+        if (ntt <= 0) {
+            tableauDeBord.deplacementMesure.magnitude = 0;
+            PUISSANCE_machine(&deplacementArrete);
+            ntt = 255.0 / 1584.1;
         }
-        tableauDeBord.tempsDeDeplacement = (unsigned char) nt;
-        PUISSANCE_machine(&moteurPhase);
-        if (tableauDeBord.deplacementDemande.magnitude == 0) {
-            verifieEgalite("PIDD02", defileMessageInterne()->evenement, DEPLACEMENT_ATTEINT);
+
+        // Pas du générateur de profil:
+        ntp -= tp;
+        if (ntp <= 0) {
+            PUISSANCE_machine(&baseDeTempsProfil);
+            while ((message = defileMessageInterne()) != 0) {
+                if (message->evenement == DEPLACEMENT_ATTEINT) {
+                    deplacementsAtteints++;
+                }
+            }
+            ntp = PROFIL_DUREE_BASE_DE_TEMPS / 15625.0;
         }
-        verifieEgalite("PIDD03", defileMessageInterne()->evenement, MOTEUR_TENSION_MOYENNE);
     }
+    return deplacementsAtteints;
+}
+
+void test_pid_atteint_le_deplacement_demande() {
+    EvenementEtValeur deplacementDemande = {DEPLACEMENT_DEMANDE, NEUTRE + 50};
+    int positionMax;
+    int deplacementsAtteints;
+
+    initialisePid();
+    initialiseTableauDeBord();
+
+    // La consigne part de zéro, le générateur de profil l'alimente:
+    PUISSANCE_machine(&deplacementDemande);
+    verifieEgalite("PIDD01", tableauDeBord.deplacementDemande.magnitude, 0);
+
+    // Simule trois secondes de fonctionnement:
+    deplacementsAtteints = simuleDeplacement(3.0, &positionMax);
     verifieEgalite("PIDD10", tableauDeBord.vitesseMesuree.magnitude, 0);
-    verifieIntervale("PIDD11", tableauDeBord.deplacementDemande.magnitude, 0, 10);
+    verifieIntervale("PIDD11", tableauDeBord.deplacementDemande.magnitude, 0, 1);
+    verifieEgalite("PIDD12", profilTermine(), TRUE);
+    verifieIntervale("PIDD13", positionMax, 2 * 50, 2 * 50 + 1);
+    verifieEgalite("PIDD14", deplacementsAtteints, 1);
+}
+
+/**
+ * Un déplacement court ne dépasse jamais la position demandée.
+ */
+void test_pid_ne_depasse_pas_un_deplacement_court() {
+    EvenementEtValeur deplacementDemande = {DEPLACEMENT_DEMANDE, NEUTRE + 8};
+    int positionMax;
+    int deplacementsAtteints;
+
+    initialisePid();
+    initialiseTableauDeBord();
+    PUISSANCE_machine(&deplacementDemande);
+    deplacementsAtteints = simuleDeplacement(2.0, &positionMax);
+    verifieEgalite("PIDC01", positionMax, 2 * 8);
+    verifieEgalite("PIDC02", deplacementsAtteints, 1);
+    verifieEgalite("PIDC03", profilTermine(), TRUE);
+}
+
+void test_prolonge_le_deplacement_dans_le_meme_sens() {
+    EvenementEtValeur deplacementDemande = {DEPLACEMENT_DEMANDE, NEUTRE + 50};
+    EvenementEtValeur baseDeTempsProfil = {BASE_DE_TEMPS_PROFIL, 0};
+    EvenementEtValeur prolongeAvant = {DEPLACEMENT_PROLONGE, NEUTRE + 30};
+    EvenementEtValeur prolongeArriere = {DEPLACEMENT_PROLONGE, NEUTRE - 30};
+    EvenementEtValeur vitesseDemandee = {VITESSE_DEMANDEE, NEUTRE_CONSIGNE};
+    unsigned char restant;
+
+    initialisePid();
+    initialiseTableauDeBord();
+    PUISSANCE_machine(&deplacementDemande);
+    PUISSANCE_machine(&baseDeTempsProfil);
+    PUISSANCE_machine(&baseDeTempsProfil);
+    restant = profilDistanceRestante();
+
+    // Les déplacements sont en phases, soit le double de la valeur:
+    PUISSANCE_machine(&prolongeAvant);
+    verifieEgalite("PIDP01", profilDistanceRestante(), restant + 60);
+
+    // Un changement de sens demande de s'arrêter d'abord:
+    PUISSANCE_machine(&prolongeArriere);
+    verifieEgalite("PIDP02", profilDistanceRestante(), restant + 60);
+
+    // Seulement en mode déplacement:
+    PUISSANCE_machine(&vitesseDemandee);
+    PUISSANCE_machine(&prolongeAvant);
+    verifieEgalite("PIDP03", profilDistanceRestante(), restant + 60);
+
+    initialiseMessagesInternes();
+    initialisePid();
+    initialiseTableauDeBord();
 }
 
 void test_MOTEUR_TENSION_MOYENNE_a_chaque_VITESSE_MESUREE() {
-    EvenementEtValeur evVitesseDemandee = {VITESSE_DEMANDEE, 150};
+    EvenementEtValeur evVitesseDemandee = {VITESSE_DEMANDEE, CONSIGNE(150)};
     EvenementEtValeur evVitesseMesuree = {VITESSE_MESUREE, 128};
     unsigned char n;
     
@@ -457,6 +1074,132 @@ void test_MOTEUR_TENSION_MOYENNE_a_chaque_VITESSE_MESUREE() {
     }
 }
 
+void test_limite_le_courant() {
+    EvenementEtValeur vitesseDemandee = {VITESSE_DEMANDEE, CONSIGNE(NEUTRE + 100)};
+    EvenementEtValeur vitesseMesuree = {VITESSE_MESUREE, 0};
+    EvenementEtValeur limiteCourantDemandee = {LIMITE_COURANT_DEMANDEE, 10};
+    EvenementEtValeur lectureCourant = {LECTURE_COURANT, 0};
+    EvenementEtValeur *message;
+    unsigned char magnitude;
+    unsigned char n;
+
+    initialisePid();
+    initialiseMessagesInternes();
+    PUISSANCE_machine(&limiteCourantDemandee);
+    PUISSANCE_machine(&vitesseDemandee);
+    for (n = 0; n < 50; n++) {
+        PUISSANCE_machine(&vitesseMesuree);
+    }
+    initialiseMessagesInternes();
+    magnitude = tableauDeBord.tensionMoyenne.magnitude;
+    verifieNonZero("PCOU01", magnitude > 0);
+
+    // Un courant en dessous de la limite ne change rien:
+    lectureCourant.valeur = LECTURE_COURANT(10) - 1;
+    PUISSANCE_machine(&lectureCourant);
+    verifieEgalite("PCOU02", tableauDeBord.tensionMoyenne.magnitude, magnitude);
+    verifieEgalite("PCOU03", (int) defileMessageInterne(), 0);
+    verifieEgalite("PCOU04", i2cRegistres.valeurs[LECTURE_I2C_COURANT], 9);
+
+    // Un courant au dessus de la limite réduit la tension:
+    lectureCourant.valeur = LECTURE_COURANT(10) + 80;
+    for (n = 0; n < 20; n++) {
+        PUISSANCE_machine(&lectureCourant);
+    }
+    verifieIntervale("PCOU11", tableauDeBord.tensionMoyenne.magnitude, 0, magnitude - 20);
+    message = defileMessageInterne();
+    verifieNonZero("PCOU12", (int) message);
+    if (message) {
+        verifieEgalite("PCOU13", message->evenement, MOTEUR_TENSION_MOYENNE);
+    }
+
+    // Le régulateur de vitesse n'accumule pas de tension:
+    for (n = 0; n < 50; n++) {
+        PUISSANCE_machine(&vitesseMesuree);
+    }
+    verifieIntervale("PCOU21", tableauDeBord.tensionMoyenne.magnitude, 0, magnitude - 20);
+
+    // Le courant redescend, la tension se rétablit progressivement:
+    lectureCourant.valeur = 0;
+    for (n = 0; n < 255; n++) {
+        PUISSANCE_machine(&lectureCourant);
+    }
+    for (n = 0; n < 50; n++) {
+        PUISSANCE_machine(&vitesseMesuree);
+    }
+    verifieEgalite("PCOU31", tableauDeBord.tensionMoyenne.magnitude, magnitude);
+
+    initialiseMessagesInternes();
+    limiteCourantDemandee.valeur = LIMITE_COURANT_DEFAUT;
+    PUISSANCE_machine(&limiteCourantDemandee);
+}
+
+void test_reduit_la_puissance_selon_la_temperature() {
+    EvenementEtValeur lectureTemperature = {LECTURE_TEMPERATURE, 0};
+    EvenementEtValeur debutReduction = {TEMPERATURE_DEBUT_REDUCTION_DEMANDEE, 80};
+    EvenementEtValeur finReduction = {TEMPERATURE_FIN_REDUCTION_DEMANDEE, 110};
+    int n;
+
+    PUISSANCE_machine(&debutReduction);
+    PUISSANCE_machine(&finReduction);
+
+    // Rétablit la limite selon l'alimentation:
+    etablitLectureAlimentation(LECTURE_ALIMENTATION_NOMINALE);
+    verifieEgalite("PTEM00", tensionMoyenneMax, TENSION_MOYENNE_MAX);
+
+    // Température ambiante: pas de réduction.
+    lectureTemperature.valeur = LECTURE_TEMPERATURE_AMBIANTE;
+    for (n = 0; n < 200; n++) {
+        PUISSANCE_machine(&lectureTemperature);
+    }
+    verifieEgalite("PTEM01", tensionMoyenneMax, TENSION_MOYENNE_MAX);
+    verifieEgalite("PTEM02", i2cRegistres.valeurs[LECTURE_I2C_ETAT_THERMIQUE], ETAT_THERMIQUE_NORMAL);
+
+    // Une lecture isolée est filtrée:
+    lectureTemperature.valeur = LECTURE_AD_MAX;
+    PUISSANCE_machine(&lectureTemperature);
+    verifieEgalite("PTEM03", tensionMoyenneMax, TENSION_MOYENNE_MAX);
+
+    // 95°C, à mi-chemin de la courbe (lecture 297 = 95°C):
+    lectureTemperature.valeur = 297;
+    for (n = 0; n < 200; n++) {
+        PUISSANCE_machine(&lectureTemperature);
+    }
+    verifieEgalite("PTEM11", temperature, 95);
+    verifieEgalite("PTEM12", i2cRegistres.valeurs[LECTURE_I2C_TEMPERATURE], 95);
+    verifieEgalite("PTEM13", i2cRegistres.valeurs[LECTURE_I2C_ETAT_THERMIQUE], ETAT_THERMIQUE_REDUCTION);
+    verifieEgalite("PTEM14", tensionMoyenneMax, 
+            (TENSION_MOYENNE_MAX + TENSION_MOYENNE_MAX_THERMIQUE) / 2);
+
+    // Au delà de la courbe, la puissance reste au minimum:
+    lectureTemperature.valeur = 400;
+    for (n = 0; n < 200; n++) {
+        PUISSANCE_machine(&lectureTemperature);
+    }
+    verifieEgalite("PTEM21", tensionMoyenneMax, TENSION_MOYENNE_MAX_THERMIQUE);
+    verifieEgalite("PTEM22", i2cRegistres.valeurs[LECTURE_I2C_ETAT_THERMIQUE], ETAT_THERMIQUE_REDUCTION_MAXIMUM);
+
+    // La courbe est configurable:
+    debutReduction.valeur = 150;
+    PUISSANCE_machine(&debutReduction);
+    finReduction.valeur = 160;
+    PUISSANCE_machine(&finReduction);
+    verifieEgalite("PTEM31", tensionMoyenneMax, TENSION_MOYENNE_MAX);
+    verifieEgalite("PTEM32", i2cRegistres.valeurs[LECTURE_I2C_ETAT_THERMIQUE], ETAT_THERMIQUE_NORMAL);
+
+    // Une courbe inversée est corrigée:
+    finReduction.valeur = 100;
+    PUISSANCE_machine(&finReduction);
+    verifieEgalite("PTEM41", temperatureFinReduction, 151);
+
+    // Rétablit la température ambiante et la courbe par défaut:
+    lectureTemperature.valeur = LECTURE_TEMPERATURE_AMBIANTE;
+    for (n = 0; n < 200; n++) {
+        PUISSANCE_machine(&lectureTemperature);
+    }
+    etablitCourbeDeReductionThermique(TEMPERATURE_DEBUT_REDUCTION, TEMPERATURE_FIN_REDUCTION);
+}
+
 /**
  * Tests unitaires pour le calcul de tension.
  * @return Nombre de tests en erreur.
@@ -464,7 +1207,12 @@ void test_MOTEUR_TENSION_MOYENNE_a_chaque_VITESSE_MESUREE() {
 void test_puissance() {
     test_pid_atteint_la_vitesse_demandee();
     test_pid_atteint_le_deplacement_demande();
+    test_pid_ne_depasse_pas_un_deplacement_court();
+    test_prolonge_le_deplacement_dans_le_meme_sens();
     test_MOTEUR_TENSION_MOYENNE_a_chaque_VITESSE_MESUREE();
     test_limite_la_tension_moyenne_maximum();
+    test_limite_le_courant();
+    test_reduit_la_puissance_selon_la_temperature();
+    test_compense_la_tension_d_alimentation();
 }
 #endif
\ No newline at end of file
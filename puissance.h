@@ -3,6 +3,18 @@
 #ifndef __PUISSANCE_H
 #define __PUISSANCE_H
 
+/**
+ * État thermique, exposé sur le bus I2C.
+ */
+typedef enum {
+    /** La température est normale. */
+    ETAT_THERMIQUE_NORMAL = 0,
+    /** La puissance est réduite à cause de la température. */
+    ETAT_THERMIQUE_REDUCTION = 1,
+    /** La puissance est réduite au minimum à cause de la température. */
+    ETAT_THERMIQUE_REDUCTION_MAXIMUM = 2
+} EtatThermique;
+
 /**
  * Machine à états pour réguler la puissance (tension moyenne) appliquée
  * au moteur.
@@ -10,6 +22,33 @@
  */
 void PUISSANCE_machine(EvenementEtValeur *ev);
 
+#ifdef REGULATEUR_AJUSTABLE
+/**
+ * Paramètres des régulateurs de vitesse et de déplacement.
+ * Dans le micrologiciel ce sont des constantes; le simulateur de la
+ * machine hôte les rend ajustables avec REGULATEUR_AJUSTABLE.
+ */
+typedef struct {
+    /** Gain proportionnel du régulateur de vitesse. */
+    int pVitesse;
+    /** Gain dérivé du régulateur de vitesse. */
+    int dVitesse;
+    /** Gain proportionnel du régulateur de déplacement. */
+    int pDeplacement;
+    /** Gain sur l'erreur de vitesse du régulateur de déplacement. */
+    int vDeplacement;
+    /** Anticipation selon la vitesse du profil. */
+    int fDeplacement;
+    /** Anticipation selon l'accélération du profil. */
+    int aDeplacement;
+    /** Tension moyenne maximum, multipliée par 64. */
+    int tensionMoyenneMax;
+} ParametresRegulateurs;
+
+void parametresRegulateursParDefaut(ParametresRegulateurs *parametres);
+void etablitParametresRegulateurs(const ParametresRegulateurs *parametres);
+#endif
+
 #ifdef TEST
 /** Tests unitaires pour le calcul de puissance. */
 void test_puissance();
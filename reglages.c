@@ -0,0 +1,137 @@
+#include "reglages.h"
+#include "tableauDeBord.h"
+#include "test.h"
+
+#ifdef TEST
+#include "filtre.h"
+#endif
+
+/** Nombre maximum de champs d'un réglage. */
+#define NOMBRE_CHAMPS_REGLAGE 3
+
+/** Réglage en cours de définition (voir Reglage). */
+static unsigned char reglageADefinir = 0;
+
+/** Nombre de champs déjà reçus du réglage en cours de définition. */
+static unsigned char champsRecus = 0;
+
+/** Champs déjà reçus du réglage en cours de définition. */
+static unsigned char champs[NOMBRE_CHAMPS_REGLAGE];
+
+/**
+ * Commence la définition d'un réglage.
+ * @param reglage Numéro du réglage (voir Reglage).
+ */
+void reglagesSelectionne(unsigned char reglage) {
+    reglageADefinir = reglage;
+    champsRecus = 0;
+}
+
+/**
+ * Définit le prochain champ du réglage en cours de définition, et 
+ * transmet le réglage dès que son dernier champ est reçu. Le réglage
+ * est appliqué par la machine à états du module concerné, dans la
+ * boucle principale. Les champs au-delà du dernier sont ignorés.
+ * @param valeur Valeur du champ.
+ */
+void reglagesDefinitChamp(unsigned char valeur) {
+    if (champsRecus >= NOMBRE_CHAMPS_REGLAGE) {
+        return;
+    }
+    champs[champsRecus++] = valeur;
+    switch (reglageADefinir) {
+        case REGLAGE_FILTRE:
+            if (champsRecus == 3) {
+                enfileMessageInterne(FILTRE_DEMANDE, 
+                        FILTRE_DEMANDE_VALEUR(champs[0], champs[1], champs[2]));
+            }
+            break;
+
+        case REGLAGE_POINT_D_ECHANTILLONNAGE:
+            if (champsRecus == 1) {
+                enfileMessageInterne(POINT_D_ECHANTILLONNAGE_DEMANDE, champs[0]);
+            }
+            break;
+
+        case REGLAGE_PROFIL:
+            if (champsRecus == 2) {
+                enfileMessageInterne(PROFIL_DEMANDE, 
+                        (((unsigned int) champs[0]) << 8) | champs[1]);
+            }
+            break;
+    }
+}
+
+#ifdef TEST
+void transmet_le_filtre_avec_son_dernier_champ() {
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+
+    reglagesSelectionne(REGLAGE_FILTRE);
+    reglagesDefinitChamp(11);
+    reglagesDefinitChamp(FILTRE_MOYENNE);
+    verifieEgalite("REG_F01", (int) defileMessageInterne(), 0);
+    reglagesDefinitChamp(3);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("REG_F02", evenementEtValeur->evenement, FILTRE_DEMANDE);
+    verifieEgalite("REG_F03", FILTRE_DEMANDE_CANAL(evenementEtValeur->valeur), 11);
+    verifieEgalite("REG_F04", FILTRE_DEMANDE_TYPE(evenementEtValeur->valeur), FILTRE_MOYENNE);
+    verifieEgalite("REG_F05", FILTRE_DEMANDE_PARAMETRE(evenementEtValeur->valeur), 3);
+
+    // Les champs en trop sont ignorés:
+    reglagesDefinitChamp(4);
+    verifieEgalite("REG_F06", (int) defileMessageInterne(), 0);
+}
+
+void transmet_le_point_d_echantillonnage() {
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+
+    reglagesSelectionne(REGLAGE_POINT_D_ECHANTILLONNAGE);
+    reglagesDefinitChamp(160);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("REG_P01", evenementEtValeur->evenement, POINT_D_ECHANTILLONNAGE_DEMANDE);
+    verifieEgalite("REG_P02", evenementEtValeur->valeur, 160);
+
+    // Les champs en trop sont ignorés:
+    reglagesDefinitChamp(20);
+    verifieEgalite("REG_P03", (int) defileMessageInterne(), 0);
+}
+
+void transmet_le_profil_avec_son_dernier_champ() {
+    EvenementEtValeur *evenementEtValeur;
+
+    initialiseMessagesInternes();
+
+    reglagesSelectionne(REGLAGE_PROFIL);
+    reglagesDefinitChamp(24);
+    verifieEgalite("REG_A01", (int) defileMessageInterne(), 0);
+    reglagesDefinitChamp(6);
+    evenementEtValeur = defileMessageInterne();
+    verifieEgalite("REG_A02", evenementEtValeur->evenement, PROFIL_DEMANDE);
+    verifieEgalite("REG_A03", evenementEtValeur->valeur, (24 << 8) | 6);
+
+    // Les champs en trop sont ignorés:
+    reglagesDefinitChamp(8);
+    verifieEgalite("REG_A04", (int) defileMessageInterne(), 0);
+}
+
+void ignore_les_reglages_inexistants() {
+    initialiseMessagesInternes();
+
+    reglagesSelectionne(REGLAGE + 15);
+    reglagesDefinitChamp(1);
+    reglagesDefinitChamp(2);
+    reglagesDefinitChamp(3);
+    verifieEgalite("REG_I01", (int) defileMessageInterne(), 0);
+}
+
+void test_reglages() {
+    transmet_le_filtre_avec_son_dernier_champ();
+    transmet_le_point_d_echantillonnage();
+    transmet_le_profil_avec_son_dernier_champ();
+    ignore_les_reglages_inexistants();
+}
+#endif
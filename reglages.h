@@ -0,0 +1,45 @@
+#include "domaine.h"
+
+#ifndef __REGLAGES_H
+#define __REGLAGES_H
+
+/** 
+ * Numéro du premier réglage. Sélectionné par ECRITURE_I2C_SELECTION_BLOC,
+ * un numéro de réglage désigne un réglage dont les champs suivent dans
+ * ECRITURE_I2C_CHAMP_BLOC. Le réglage s'applique dès que son dernier 
+ * champ est reçu.
+ */
+#define REGLAGE 0xF0
+
+/**
+ * Réglages accessibles par le bus I2C (voir REGLAGE).
+ */
+typedef enum {
+    /** 
+     * Filtre d'un canal analogique. Champs: canal (ANx), type de filtre
+     * (voir TypeFiltre) et paramètre du filtre.
+     */
+    REGLAGE_FILTRE = REGLAGE,
+
+    /** 
+     * Point d'échantillonnage du courant. Champ: position dans le temps
+     * de conduction des transistors, en 256èmes.
+     */
+    REGLAGE_POINT_D_ECHANTILLONNAGE = REGLAGE + 1,
+
+    /**
+     * Dynamique du profil de déplacement. Champs: accélération, en 
+     * 1/256 de phase par pas de temps² (0 rétablit l'accélération et 
+     * le jerk par défaut), puis jerk (0 pour un profil trapézoïdal).
+     */
+    REGLAGE_PROFIL = REGLAGE + 2
+} Reglage;
+
+void reglagesSelectionne(unsigned char reglage);
+void reglagesDefinitChamp(unsigned char valeur);
+
+#ifdef TEST
+void test_reglages();
+#endif
+
+#endif
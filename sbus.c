@@ -0,0 +1,338 @@
+#include "domaine.h"
+#include "capture.h"
+#include "sbus.h"
+#include "test.h"
+
+/** Premier octet de chaque trame. */
+#define SBUS_EN_TETE 0x0F
+
+/** Position de l'octet des drapeaux dans la trame. */
+#define SBUS_POSITION_DRAPEAUX 23
+
+/** Position du dernier octet de la trame. */
+#define SBUS_POSITION_FIN 24
+
+/** Nombre de bits par canal. */
+#define SBUS_BITS_PAR_CANAL 11
+
+/**
+ * Durée de pulsation, en ticks de 0,5us, équivalente à la valeur
+ * SBUS 0. La valeur 992 équivaut à 1,5ms, et chaque pas à 0,625us.
+ */
+#define SBUS_DUREE_ZERO 1760
+
+/**
+ * Valeurs des canaux. Une des deux trames est la dernière trame
+ * valide, l'autre est en cours de réception.
+ */
+unsigned int sbusCanaux[2][SBUS_NOMBRE_DE_CANAUX];
+
+/** Index de la dernière trame valide dans sbusCanaux. */
+unsigned char sbusTrameValide = 0;
+
+/** Position du prochain octet dans la trame. 0 pour attendre l'en-tête. */
+unsigned char sbusPosition = 0;
+
+/** Prochain canal à décoder dans la trame en cours. */
+unsigned char sbusCanal = 0;
+
+/** Bits reçus mais pas encore attribués à un canal. */
+unsigned long sbusBits = 0;
+
+/** Nombre de bits dans sbusBits. */
+unsigned char sbusNombreDeBits = 0;
+
+/** Drapeaux de la trame en cours. */
+unsigned char sbusDrapeauxEnCours = 0;
+
+/** Drapeaux de la dernière trame complète. */
+unsigned char sbusDerniersDrapeaux = 0;
+
+/** 
+ * Octet précédent. Un en-tête n'est reconnu qu'après un octet de fin,
+ * pour ne pas se synchroniser sur un 0x0F au milieu des canaux.
+ */
+unsigned char sbusOctetPrecedent = 0;
+
+/** Nombre de trames rejetées. */
+unsigned char sbusTramesRejetees = 0;
+
+/**
+ * Initialise le décodeur SBUS. Toutes les valeurs sont au neutre, et
+ * le décodage commence au prochain en-tête.
+ */
+void sbusInitialise() {
+    unsigned char canal;
+
+    sbusPosition = 0;
+    sbusOctetPrecedent = 0;
+    sbusTrameValide = 0;
+    sbusDerniersDrapeaux = 0;
+    sbusTramesRejetees = 0;
+    for (canal = 0; canal < SBUS_NOMBRE_DE_CANAUX; canal++) {
+        sbusCanaux[0][canal] = 992;
+    }
+}
+
+/**
+ * Indique si l'octet peut terminer une trame: fin SBUS (0x00) ou 
+ * SBUS2 (0x04, 0x14, 0x24, 0x34).
+ * @param octet L'octet.
+ * @return TRUE si c'est un octet de fin.
+ */
+unsigned char estFinDeTrame(unsigned char octet) {
+    return (octet == 0x00) || ((octet & 0xCF) == 0x04);
+}
+
+/**
+ * Rejette la trame en cours. Le décodage reprend au prochain en-tête.
+ */
+void rejetteTrame() {
+    sbusPosition = 0;
+    if (sbusTramesRejetees < 255) {
+        sbusTramesRejetees++;
+    }
+}
+
+/**
+ * Reçoit un octet de la EUSART.
+ * Une trame SBUS se compose d'un en-tête, de 22 octets contenant
+ * les 16 canaux de 11 bits (bit de poids faible en premier), d'un octet
+ * de drapeaux et d'un octet de fin. Chaque octet décode au plus un
+ * canal, ce qui limite le temps passé dans l'interruption.
+ * Les valeurs de la trame ne sont publiées qu'une fois l'octet de fin
+ * vérifié. Les trames de sécurité ne sont pas publiées: la
+ * surveillance du signal de la télécommande se charge du neutre.
+ * @param octet L'octet reçu.
+ * @return TRUE si une trame complète vient d'être publiée.
+ */
+unsigned char sbusOctet(unsigned char octet) {
+    unsigned char precedent = sbusOctetPrecedent;
+
+    sbusOctetPrecedent = octet;
+    switch (sbusPosition) {
+        case 0:
+            if ((octet == SBUS_EN_TETE) && estFinDeTrame(precedent)) {
+                sbusBits = 0;
+                sbusNombreDeBits = 0;
+                sbusCanal = 0;
+                sbusPosition = 1;
+            }
+            return FALSE;
+
+        case SBUS_POSITION_DRAPEAUX:
+            sbusDrapeauxEnCours = octet;
+            sbusPosition++;
+            return FALSE;
+
+        case SBUS_POSITION_FIN:
+            if (!estFinDeTrame(octet)) {
+                rejetteTrame();
+                return FALSE;
+            }
+            sbusPosition = 0;
+            sbusDerniersDrapeaux = sbusDrapeauxEnCours;
+            if (sbusDrapeauxEnCours & SBUS_SECURITE) {
+                return FALSE;
+            }
+            sbusTrameValide ^= 1;
+            return TRUE;
+
+        default:
+            sbusBits |= ((unsigned long) octet) << sbusNombreDeBits;
+            sbusNombreDeBits += 8;
+            if (sbusNombreDeBits >= SBUS_BITS_PAR_CANAL) {
+                sbusCanaux[sbusTrameValide ^ 1][sbusCanal++] =
+                        ((unsigned int) sbusBits) & 0x7FF;
+                sbusBits >>= SBUS_BITS_PAR_CANAL;
+                sbusNombreDeBits -= SBUS_BITS_PAR_CANAL;
+            }
+            sbusPosition++;
+            return FALSE;
+    }
+}
+
+/**
+ * Signale une erreur de réception (erreur de format ou débordement).
+ * La trame en cours est rejetée, et le décodage reprend après le
+ * prochain octet de fin.
+ */
+void sbusErreur() {
+    sbusOctetPrecedent = SBUS_EN_TETE;
+    if (sbusPosition != 0) {
+        rejetteTrame();
+    }
+}
+
+/**
+ * Récupère la valeur brute d'un canal de la dernière trame valide.
+ * @param canal Le canal, entre 0 et SBUS_NOMBRE_DE_CANAUX - 1.
+ * @return La valeur, entre 0 et 2047.
+ */
+unsigned int sbusValeurBrute(unsigned char canal) {
+    return sbusCanaux[sbusTrameValide][canal];
+}
+
+/**
+ * Convertit la valeur d'un canal de la dernière trame valide selon la
+ * courbe du canal. La valeur SBUS est ramenée à la durée de pulsation
+ * équivalente, pour que la calibration s'applique comme aux autres
+ * modes de réception.
+ * @param canal Le canal, entre 0 et CAPTURE_NOMBRE_DE_CANAUX - 1.
+ * @return La consigne (voir captureConvertit).
+ */
+unsigned int sbusValeur(unsigned char canal) {
+    unsigned int duree = sbusValeurBrute(canal);
+    duree = SBUS_DUREE_ZERO + ((duree * 5) >> 2);
+    return captureConvertit(canal, duree);
+}
+
+/**
+ * Récupère les drapeaux de la dernière trame complète.
+ * @return Une combinaison de SbusDrapeau.
+ */
+unsigned char sbusDrapeaux() {
+    return sbusDerniersDrapeaux;
+}
+
+/**
+ * Indique le nombre de trames rejetées.
+ * @return Le nombre de trames rejetées, jusqu'à 255.
+ */
+unsigned char sbusNombreDeTramesRejetees() {
+    return sbusTramesRejetees;
+}
+
+#ifdef TEST
+/**
+ * Trame enregistrée à la sortie d'un récepteur: canaux 992, 172, 1811,
+ * 992, 1500, 300, 992 (x8), 1024, 2047.
+ */
+const unsigned char trameEnregistree[SBUS_TAILLE_TRAME] = {
+    0x0F, 0xE0, 0x63, 0xC5, 0xC4, 0xC1, 0xC7, 0x5D, 0x96, 0x80, 0x0F,
+    0x7C, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x01, 0xF0,
+    0xFF, 0x00, 0x00
+};
+
+/**
+ * Transmet une suite d'octets au décodeur.
+ * @param octets Les octets.
+ * @param nombre Nombre d'octets.
+ * @return Nombre de trames publiées.
+ */
+unsigned char transmet(const unsigned char *octets, unsigned char nombre) {
+    unsigned char n;
+    unsigned char trames = 0;
+
+    for (n = 0; n < nombre; n++) {
+        if (sbusOctet(octets[n])) {
+            trames++;
+        }
+    }
+    return trames;
+}
+
+/**
+ * Transmet la trame enregistrée, avec d'autres drapeaux et octet de fin.
+ * @param drapeaux Octet de drapeaux.
+ * @param fin Octet de fin.
+ * @return TRUE si la trame est publiée.
+ */
+unsigned char transmetAvec(unsigned char drapeaux, unsigned char fin) {
+    transmet(trameEnregistree, SBUS_POSITION_DRAPEAUX);
+    sbusOctet(drapeaux);
+    return sbusOctet(fin);
+}
+
+void decode_une_trame_enregistree() {
+    initialiseCapture();
+    sbusInitialise();
+
+    verifieEgalite("SBUS01", sbusValeurBrute(0), 992);
+    verifieEgalite("SBUS02", transmet(trameEnregistree, SBUS_TAILLE_TRAME - 1), 0);
+    verifieEgalite("SBUS03", sbusOctet(0x00), TRUE);
+
+    verifieEgalite("SBUS11", sbusValeurBrute(0), 992);
+    verifieEgalite("SBUS12", sbusValeurBrute(1), 172);
+    verifieEgalite("SBUS13", sbusValeurBrute(2), 1811);
+    verifieEgalite("SBUS14", sbusValeurBrute(4), 1500);
+    verifieEgalite("SBUS15", sbusValeurBrute(5), 300);
+    verifieEgalite("SBUS16", sbusValeurBrute(13), 992);
+    verifieEgalite("SBUS17", sbusValeurBrute(14), 1024);
+    verifieEgalite("SBUS18", sbusValeurBrute(15), 2047);
+    verifieEgalite("SBUS19", sbusDrapeaux(), 0);
+
+    verifieEgalite("SBUS21", sbusValeur(0), NEUTRE_CONSIGNE);
+    verifieEgalite("SBUS22", sbusValeur(1), 0);
+    verifieEgalite("SBUS23", sbusValeur(2), CONSIGNE_MAX);
+
+    // Fin SBUS2, et drapeau de trame perdue:
+    verifieEgalite("SBUS31", transmetAvec(SBUS_TRAME_PERDUE, 0x14), TRUE);
+    verifieEgalite("SBUS32", sbusDrapeaux(), SBUS_TRAME_PERDUE);
+    verifieEgalite("SBUS33", sbusNombreDeTramesRejetees(), 0);
+}
+
+void se_resynchronise_apres_une_erreur() {
+    const unsigned char parasites[] = {0x00, 0x55, 0xF0, 0x00};
+    unsigned char n;
+
+    initialiseCapture();
+    sbusInitialise();
+
+    // Des octets avant l'en-tête sont ignorés:
+    transmet(parasites, sizeof(parasites));
+    verifieEgalite("SBUSR01", transmet(trameEnregistree, SBUS_TAILLE_TRAME), 1);
+    verifieEgalite("SBUSR02", sbusValeurBrute(2), 1811);
+
+    // Une trame avec un mauvais octet de fin est rejetée, et les
+    // valeurs précédentes restent publiées:
+    sbusInitialise();
+    verifieEgalite("SBUSR11", transmetAvec(0, 0x0F), FALSE);
+    verifieEgalite("SBUSR12", sbusValeurBrute(2), 992);
+    verifieEgalite("SBUSR13", sbusNombreDeTramesRejetees(), 1);
+
+    // L'en-tête suivant n'est reconnu qu'après un octet de fin:
+    verifieEgalite("SBUSR14", transmet(trameEnregistree, SBUS_TAILLE_TRAME), 0);
+
+    // Une erreur de réception rejette la trame en cours. L'octet 0x0F
+    // au milieu des canaux n'est pas pris pour un en-tête:
+    transmet(trameEnregistree, 10);
+    sbusErreur();
+    verifieEgalite("SBUSR21", transmet(&trameEnregistree[10], SBUS_TAILLE_TRAME - 10), 0);
+    verifieEgalite("SBUSR22", sbusNombreDeTramesRejetees(), 2);
+    verifieEgalite("SBUSR23", transmet(trameEnregistree, SBUS_TAILLE_TRAME), 1);
+    verifieEgalite("SBUSR24", sbusValeurBrute(2), 1811);
+
+    // Une erreur entre deux trames n'est pas comptée, mais le décodage
+    // attend le prochain octet de fin:
+    sbusErreur();
+    verifieEgalite("SBUSR31", sbusNombreDeTramesRejetees(), 2);
+    verifieEgalite("SBUSR32", transmet(trameEnregistree, SBUS_TAILLE_TRAME), 0);
+
+    // Plusieurs trames consécutives:
+    for (n = 0; n < 3; n++) {
+        verifieEgalite("SBUSR41", transmet(trameEnregistree, SBUS_TAILLE_TRAME), 1);
+    }
+}
+
+void ne_publie_pas_les_trames_de_securite() {
+    initialiseCapture();
+    sbusInitialise();
+
+    verifieEgalite("SBUSS01", transmetAvec(SBUS_SECURITE | SBUS_TRAME_PERDUE, 0x00), FALSE);
+    verifieEgalite("SBUSS02", sbusDrapeaux(), SBUS_SECURITE | SBUS_TRAME_PERDUE);
+    verifieEgalite("SBUSS03", sbusValeurBrute(1), 992);
+    verifieEgalite("SBUSS04", sbusNombreDeTramesRejetees(), 0);
+
+    // La liaison est rétablie:
+    verifieEgalite("SBUSS11", transmetAvec(0, 0x00), TRUE);
+    verifieEgalite("SBUSS12", sbusDrapeaux(), 0);
+    verifieEgalite("SBUSS13", sbusValeurBrute(1), 172);
+}
+
+void test_sbus() {
+    decode_une_trame_enregistree();
+    se_resynchronise_apres_une_erreur();
+    ne_publie_pas_les_trames_de_securite();
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef SBUS__H
+#define	SBUS__H
+
+/** Nombre de canaux proportionnels dans une trame SBUS. */
+#define SBUS_NOMBRE_DE_CANAUX 16
+
+/** Nombre d'octets d'une trame SBUS, en-tête et fin compris. */
+#define SBUS_TAILLE_TRAME 25
+
+/**
+ * Drapeaux transmis dans l'avant dernier octet de la trame.
+ */
+typedef enum {
+    /** Le récepteur a perdu une trame radio, et répète les valeurs. */
+    SBUS_TRAME_PERDUE = 0x04,
+    /** Le récepteur a perdu la liaison radio, et envoie ses valeurs de sécurité. */
+    SBUS_SECURITE = 0x08
+} SbusDrapeau;
+
+void sbusInitialise();
+unsigned char sbusOctet(unsigned char octet);
+void sbusErreur();
+unsigned int sbusValeurBrute(unsigned char canal);
+unsigned int sbusValeur(unsigned char canal);
+unsigned char sbusDrapeaux();
+unsigned char sbusNombreDeTramesRejetees();
+
+#ifdef TEST
+void test_sbus();
+#endif
+
+#endif
@@ -0,0 +1,468 @@
+#include <xc.h>
+#include "sequenceur.h"
+#include "evenements.h"
+#include "test.h"
+
+/** Temps d'acquisition des conversions enchaînées: 12 TAD. */
+#define ACQUISITION_ENCHAINEE 5
+
+/**
+ * Temps entre le début de la période du PWM et le démarrage de la
+ * conversion synchronisée, dû à la latence de l'interruption, en uS.
+ */
+#define LATENCE_INTERRUPTION 4
+
+/** Temps d'acquisition minimum d'une conversion synchronisée, en uS. */
+#define ACQUISITION_MIN 2
+
+/**
+ * Temps d'acquisition en uS (ou TAD) pour chaque valeur de ADCON2bits.ACQT.
+ */
+static const unsigned char acquisitionParCode[] = {0, 2, 4, 6, 8, 12, 16, 20};
+
+/**
+ * Conversion synchronisée avec le PWM moteur: le courant est mesuré 
+ * une fois par période du PWM (15600 lectures/s), au point 
+ * d'échantillonnage choisi dans le temps de conduction des transistors,
+ * loin des commutations. Suréchantillonnée 4x, elle produit 3900 
+ * événements/s.
+ */
+static const ConversionAD conversionSynchronisee = 
+    {8, 1, 2, LECTURE_COURANT, FILTRE_AUCUN, 0};
+
+/**
+ * Table des conversions enchaînées.
+ * Une conversion enchaînée dure environ 23uS (12 TAD d'acquisition et
+ * 11 TAD de conversion, avec TAD = 1uS). Elle suit la conversion 
+ * synchronisée, ce qui laisse le convertisseur libre au début de la 
+ * période suivante: on en fait donc une par période du PWM.
+ * Un tour de séquence parcourt la table, et convertit les canaux dont
+ * le diviseur est atteint. Avec la table ci-dessous, chaque canal est 
+ * lu 5200 fois par seconde, et suréchantillonné 16x produit 325 
+ * événements/s. Pour ajouter une entrée analogique, il suffit 
+ * d'ajouter une ligne.
+ * La lecture suréchantillonnée passe ensuite par le filtre du canal:
+ * une médiane élimine les pointes isolées sur l'alimentation, qui
+ * feraient varier la tension moyenne maximum.
+ */
+static const ConversionAD conversions[] = {
+    // Canal  Diviseur  Décalage  Événement               Filtre            Paramètre
+    {9,       1,        4,        LECTURE_POTENTIOMETRE,  FILTRE_IIR,       2},
+    {11,      1,        4,        LECTURE_ALIMENTATION,   FILTRE_MEDIANE_5, 0},
+    {13,      1,        4,        LECTURE_TEMPERATURE,    FILTRE_MOYENNE,   3},
+};
+
+#define NOMBRE_DE_CONVERSIONS (sizeof(conversions) / sizeof(ConversionAD))
+
+/**
+ * État de chaque entrée de la table.
+ */
+typedef struct {
+    /** Somme des lectures suréchantillonnées. */
+    unsigned int somme;
+    /** Nombre de lectures restant avant d'émettre l'événement. */
+    unsigned char lectures;
+    /** Nombre de tours restant avant la prochaine conversion. */
+    unsigned char attente;
+    /** Filtre appliqué aux lectures suréchantillonnées. */
+    Filtre filtre;
+} EtatConversionAD;
+
+static EtatConversionAD etats[NOMBRE_DE_CONVERSIONS];
+static EtatConversionAD etatSynchronisee;
+
+/** Phase commutée pendant les lectures synchronisées en cours. */
+static unsigned char phaseSynchronisee;
+
+/** Indique que la conversion en cours est la conversion synchronisée. */
+static unsigned char synchroniseeEnCours;
+
+/** Entrée de la table en cours de conversion. */
+static unsigned char conversionEnCours;
+
+/**
+ * Point d'échantillonnage dans le temps de conduction, en 256èmes.
+ */
+static unsigned char pointDEchantillonnage = 128;
+
+/**
+ * Cumule une lecture, et émet l'événement avec la lecture filtrée
+ * lorsque toutes les lectures suréchantillonnées sont cumulées.
+ * @param conversion L'entrée de la table.
+ * @param etat L'état de l'entrée.
+ * @param lecture La lecture, sur 10 bits.
+ * @param etiquette Bits ajoutés à la valeur de l'événement, au 
+ * delà des 10 bits de la lecture.
+ * @return TRUE si l'événement est émis.
+ */
+static unsigned char cumuleLecture(const ConversionAD *conversion, 
+                                   EtatConversionAD *etat, 
+                                   unsigned int lecture,
+                                   unsigned int etiquette) {
+    etat->somme += lecture;
+    if (--etat->lectures == 0) {
+        enfileEvenement(conversion->evenement, 
+                        filtreApplique(&etat->filtre, 
+                            etat->somme >> conversion->decalage) | etiquette);
+        etat->somme = 0;
+        etat->lectures = 1 << conversion->decalage;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Cherche la prochaine entrée de la table à convertir.
+ * @param demarrage Pour indiquer la conversion à démarrer.
+ */
+static void prochaineConversion(DemarrageAD *demarrage) {
+    EtatConversionAD *etat;
+
+    while(1) {
+        if (++conversionEnCours >= NOMBRE_DE_CONVERSIONS) {
+            conversionEnCours = 0;
+        }
+        etat = &etats[conversionEnCours];
+        if (--etat->attente == 0) {
+            etat->attente = conversions[conversionEnCours].diviseur;
+            demarrage->canal = conversions[conversionEnCours].canal;
+            demarrage->acquisition = ACQUISITION_ENCHAINEE;
+            synchroniseeEnCours = FALSE;
+            return;
+        }
+    }
+}
+
+/**
+ * Réinitialise le séquenceur.
+ */
+void sequenceurInitialise() {
+    unsigned char n;
+
+    for (n = 0; n < NOMBRE_DE_CONVERSIONS; n++) {
+        etats[n].somme = 0;
+        etats[n].lectures = 1 << conversions[n].decalage;
+        etats[n].attente = 1;
+        filtreConfigure(&etats[n].filtre, 
+                        conversions[n].filtre, conversions[n].parametreFiltre);
+    }
+    etatSynchronisee.somme = 0;
+    etatSynchronisee.lectures = 1 << conversionSynchronisee.decalage;
+    filtreConfigure(&etatSynchronisee.filtre, 
+                    conversionSynchronisee.filtre, 
+                    conversionSynchronisee.parametreFiltre);
+    phaseSynchronisee = 0;
+    synchroniseeEnCours = FALSE;
+    conversionEnCours = NOMBRE_DE_CONVERSIONS - 1;
+}
+
+/**
+ * Établit le point d'échantillonnage de la conversion synchronisée.
+ * L'interruption de TMR2 lit le point d'échantillonnage en un seul
+ * octet: il n'y a pas besoin de la suspendre.
+ * @param point Position dans le temps de conduction des transistors,
+ * en 256èmes. 128 correspond au milieu.
+ */
+void sequenceurEtablitPointDEchantillonnage(unsigned char point) {
+    pointDEchantillonnage = point;
+}
+
+/**
+ * Change le filtre appliqué aux lectures d'un canal.
+ * Doit être appelée depuis la boucle principale: l'interruption de 
+ * fin de conversion, qui utilise le filtre, est suspendue le temps 
+ * de le reconfigurer.
+ * @param canal Le canal analogique (ANx).
+ * @param type Le type de filtre.
+ * @param parametre Le paramètre du filtre.
+ * @return TRUE si le canal existe.
+ */
+unsigned char sequenceurConfigureFiltre(unsigned char canal, 
+                                        TypeFiltre type, 
+                                        unsigned char parametre) {
+    Filtre *filtre = 0;
+    unsigned char n;
+
+    if (canal == conversionSynchronisee.canal) {
+        filtre = &etatSynchronisee.filtre;
+    }
+    for (n = 0; n < NOMBRE_DE_CONVERSIONS; n++) {
+        if (conversions[n].canal == canal) {
+            filtre = &etats[n].filtre;
+        }
+    }
+    if (filtre == 0) {
+        return FALSE;
+    }
+    PIE1bits.ADIE = 0;
+    filtreConfigure(filtre, type, parametre);
+    PIE1bits.ADIE = 1;
+    return TRUE;
+}
+
+/**
+ * Choisit la conversion à démarrer au début d'une période du PWM.
+ * La conversion synchronisée démarre tout de suite, et son temps 
+ * d'acquisition est choisi pour que l'échantillon soit pris au point 
+ * d'échantillonnage (ou le plus près possible, si le temps de 
+ * conduction est long). Si le temps de conduction est trop court, 
+ * il n'y a pas de lecture de courant, et on démarre une conversion
+ * enchaînée à la place.
+ * À appeler depuis l'interruption de TMR2, si le convertisseur est libre.
+ * @param rapportCyclique Rapport cyclique des transistors hauts.
+ * @param phase Phase commutée, entre 1 et 6, ou 0.
+ * @param demarrage Pour indiquer la conversion à démarrer.
+ * @return TRUE s'il faut démarrer une conversion.
+ */
+unsigned char sequenceurPeriodePwm(unsigned char rapportCyclique, 
+                                   unsigned char phase,
+                                   DemarrageAD *demarrage) {
+    unsigned char instant;
+    unsigned char code;
+
+    // Instant d'échantillonnage, en uS depuis le début de la période:
+    // chaque pas du rapport cyclique dure 0.25uS.
+    instant = (unsigned char) 
+            (((unsigned int) rapportCyclique * pointDEchantillonnage) >> 10);
+    if ((phase == 0) || (instant < LATENCE_INTERRUPTION + ACQUISITION_MIN)) {
+        prochaineConversion(demarrage);
+        return TRUE;
+    }
+    instant -= LATENCE_INTERRUPTION;
+    code = sizeof(acquisitionParCode) - 1;
+    while (acquisitionParCode[code] > instant) {
+        code--;
+    }
+
+    // Les lectures suréchantillonnées sont toutes de la même phase:
+    if (phase != phaseSynchronisee) {
+        phaseSynchronisee = phase;
+        etatSynchronisee.somme = 0;
+        etatSynchronisee.lectures = 1 << conversionSynchronisee.decalage;
+    }
+    demarrage->canal = conversionSynchronisee.canal;
+    demarrage->acquisition = code;
+    synchroniseeEnCours = TRUE;
+    return TRUE;
+}
+
+/**
+ * Traite le résultat de la conversion en cours, et choisit la suivante.
+ * Lorsque toutes les lectures suréchantillonnées d'un canal sont 
+ * cumulées, émet l'événement correspondant avec leur moyenne. Les
+ * lectures de courant sont étiquetées avec la phase pendant laquelle
+ * elles ont été prises (voir PHASE_LECTURE_AD).
+ * À appeler depuis l'interruption de fin de conversion.
+ * @param lecture Le résultat de la conversion, sur 10 bits.
+ * @param demarrage Pour indiquer la conversion à démarrer.
+ * @return TRUE s'il faut démarrer une autre conversion, FALSE s'il
+ * faut attendre la prochaine période du PWM.
+ */
+unsigned char sequenceurConversionTerminee(unsigned int lecture, 
+                                           DemarrageAD *demarrage) {
+    if (synchroniseeEnCours) {
+        cumuleLecture(&conversionSynchronisee, &etatSynchronisee, lecture,
+                      ((unsigned int) phaseSynchronisee) << 12);
+        prochaineConversion(demarrage);
+        return TRUE;
+    }
+    cumuleLecture(&conversions[conversionEnCours], 
+                  &etats[conversionEnCours], lecture, 0);
+    return FALSE;
+}
+
+void SEQUENCEUR_machine(EvenementEtValeur *ev) {
+    switch (ev->evenement) {
+        case FILTRE_DEMANDE:
+            sequenceurConfigureFiltre(FILTRE_DEMANDE_CANAL(ev->valeur),
+                                      FILTRE_DEMANDE_TYPE(ev->valeur),
+                                      FILTRE_DEMANDE_PARAMETRE(ev->valeur));
+            break;
+
+        case POINT_D_ECHANTILLONNAGE_DEMANDE:
+            sequenceurEtablitPointDEchantillonnage((unsigned char) ev->valeur);
+            break;
+    }
+}
+
+#ifdef TEST
+void enchaine_les_canaux_selon_la_table() {
+    DemarrageAD demarrage;
+
+    initialiseEvenements();
+    sequenceurInitialise();
+    sequenceurEtablitPointDEchantillonnage(128);
+
+    // Sans phase commutée, une conversion enchaînée par période:
+    verifieEgalite("SEQ-01", sequenceurPeriodePwm(0, 0, &demarrage), TRUE);
+    verifieEgalite("SEQ-02", demarrage.canal, 9);
+    verifieEgalite("SEQ-03", demarrage.acquisition, ACQUISITION_ENCHAINEE);
+    verifieEgalite("SEQ-04", sequenceurConversionTerminee(0, &demarrage), FALSE);
+    sequenceurPeriodePwm(0, 0, &demarrage);
+    verifieEgalite("SEQ-05", demarrage.canal, 11);
+    sequenceurConversionTerminee(0, &demarrage);
+    sequenceurPeriodePwm(0, 0, &demarrage);
+    verifieEgalite("SEQ-06", demarrage.canal, 13);
+    sequenceurConversionTerminee(0, &demarrage);
+    sequenceurPeriodePwm(0, 0, &demarrage);
+    verifieEgalite("SEQ-07", demarrage.canal, 9);
+    sequenceurConversionTerminee(0, &demarrage);
+}
+
+void synchronise_la_lecture_de_courant_avec_le_pwm() {
+    DemarrageAD demarrage;
+
+    initialiseEvenements();
+    sequenceurInitialise();
+    sequenceurEtablitPointDEchantillonnage(128);
+
+    // Temps de conduction de 50uS, échantillon à 25uS (au mieux 24uS):
+    verifieEgalite("SEQS01", sequenceurPeriodePwm(200, 1, &demarrage), TRUE);
+    verifieEgalite("SEQS02", demarrage.canal, 8);
+    verifieEgalite("SEQS03", demarrage.acquisition, 7);
+
+    // Suivie d'une conversion enchaînée:
+    verifieEgalite("SEQS04", sequenceurConversionTerminee(0, &demarrage), TRUE);
+    verifieEgalite("SEQS05", demarrage.canal, 9);
+    verifieEgalite("SEQS06", demarrage.acquisition, ACQUISITION_ENCHAINEE);
+    verifieEgalite("SEQS07", sequenceurConversionTerminee(0, &demarrage), FALSE);
+
+    // Temps de conduction de 20uS, échantillon à 10uS:
+    sequenceurPeriodePwm(80, 1, &demarrage);
+    verifieEgalite("SEQS10", demarrage.canal, 8);
+    verifieEgalite("SEQS11", demarrage.acquisition, 3);
+    sequenceurConversionTerminee(0, &demarrage);
+    sequenceurConversionTerminee(0, &demarrage);
+
+    // Temps de conduction trop court: pas de lecture de courant:
+    sequenceurPeriodePwm(40, 1, &demarrage);
+    verifieEgalite("SEQS20", demarrage.canal, 13);
+    verifieEgalite("SEQS21", sequenceurConversionTerminee(0, &demarrage), FALSE);
+
+    // Échantillon au quart du temps de conduction:
+    sequenceurEtablitPointDEchantillonnage(64);
+    sequenceurPeriodePwm(200, 1, &demarrage);
+    verifieEgalite("SEQS30", demarrage.canal, 8);
+    verifieEgalite("SEQS31", demarrage.acquisition, 4);
+    sequenceurEtablitPointDEchantillonnage(128);
+}
+
+/**
+ * Simule une période du PWM, avec une lecture de courant et une 
+ * lecture enchaînée.
+ */
+void periodeAvecLectures(unsigned char phase, 
+                         unsigned int courant, 
+                         unsigned int lecture) {
+    DemarrageAD demarrage;
+    sequenceurPeriodePwm(200, phase, &demarrage);
+    sequenceurConversionTerminee(courant, &demarrage);
+    sequenceurConversionTerminee(lecture, &demarrage);
+}
+
+void emet_la_moyenne_des_lectures_surechantillonnees() {
+    EvenementEtValeur *ev;
+    unsigned char n;
+
+    initialiseEvenements();
+    sequenceurInitialise();
+    sequenceurEtablitPointDEchantillonnage(128);
+
+    // Le courant est suréchantillonné 4x, sur 10 bits:
+    periodeAvecLectures(2, 1000, 10);
+    periodeAvecLectures(2, 1001, 20);
+    periodeAvecLectures(2, 1023, 30);
+    verifieEgalite("SEQM01", defileEvenement(), 0);
+    periodeAvecLectures(2, 1000, 10);
+    ev = defileEvenement();
+    verifieEgalite("SEQM02", ev->evenement, LECTURE_COURANT);
+    verifieEgalite("SEQM03", LECTURE_AD(ev->valeur), (1000 + 1001 + 1023 + 1000) / 4);
+    verifieEgalite("SEQM04", PHASE_LECTURE_AD(ev->valeur), 2);
+
+    // Un changement de phase recommence le suréchantillonnage:
+    periodeAvecLectures(3, 50, 20);
+    periodeAvecLectures(3, 50, 30);
+    periodeAvecLectures(4, 80, 10);
+    periodeAvecLectures(4, 80, 20);
+    periodeAvecLectures(4, 84, 30);
+    verifieEgalite("SEQM10", defileEvenement(), 0);
+    periodeAvecLectures(4, 84, 10);
+    ev = defileEvenement();
+    verifieEgalite("SEQM11", ev->evenement, LECTURE_COURANT);
+    verifieEgalite("SEQM12", LECTURE_AD(ev->valeur), 82);
+    verifieEgalite("SEQM13", PHASE_LECTURE_AD(ev->valeur), 4);
+
+    // Les autres canaux sont suréchantillonnés 16x, avec une lecture 
+    // enchaînée par période: le potentiomètre a déjà 4 lectures, 
+    // l'alimentation et la température en ont 3.
+    for (n = 0; n < 38; n++) {
+        periodeAvecLectures(4, 84, 10);
+    }
+    for (n = 0; n < 9; n++) {
+        ev = defileEvenement();
+        verifieEgalite("SEQM20", ev->evenement, LECTURE_COURANT);
+    }
+    ev = defileEvenement();
+    verifieEgalite("SEQM21", ev->evenement, LECTURE_POTENTIOMETRE);
+    verifieEgalite("SEQM22", ev->valeur, 10);
+    ev = defileEvenement();
+    verifieEgalite("SEQM23", ev->evenement, LECTURE_ALIMENTATION);
+    verifieEgalite("SEQM24", ev->valeur, (3 * 20 + 13 * 10) / 16);
+    ev = defileEvenement();
+    verifieEgalite("SEQM25", ev->evenement, LECTURE_TEMPERATURE);
+    verifieEgalite("SEQM26", ev->valeur, (3 * 30 + 13 * 10) / 16);
+    verifieEgalite("SEQM27", defileEvenement(), 0);
+}
+
+void filtre_les_lectures_avant_de_les_emettre() {
+    EvenementEtValeur *ev;
+    unsigned char n;
+
+    initialiseEvenements();
+    sequenceurInitialise();
+    verifieEgalite("SEQF01", sequenceurConfigureFiltre(8, FILTRE_MEDIANE_3, 0), TRUE);
+    verifieEgalite("SEQF02", sequenceurConfigureFiltre(12, FILTRE_IIR, 2), FALSE);
+    verifieEgalite("SEQF05", PIE1bits.ADIE, 1);
+
+    // Une pointe isolée de courant est éliminée par la médiane:
+    for (n = 0; n < 4; n++) {
+        periodeAvecLectures(1, 40, 0);
+    }
+    for (n = 0; n < 4; n++) {
+        periodeAvecLectures(1, 240, 0);
+    }
+    for (n = 0; n < 4; n++) {
+        periodeAvecLectures(1, 40, 0);
+    }
+    for (n = 0; n < 3; n++) {
+        ev = defileEvenement();
+        verifieEgalite("SEQF03", ev->evenement, LECTURE_COURANT);
+        verifieEgalite("SEQF04", LECTURE_AD(ev->valeur), 40);
+    }
+    sequenceurConfigureFiltre(8, FILTRE_AUCUN, 0);
+}
+
+void applique_les_reglages_demandes() {
+    EvenementEtValeur filtreDemande = 
+        {FILTRE_DEMANDE, FILTRE_DEMANDE_VALEUR(8, FILTRE_IIR, 3)};
+    EvenementEtValeur pointDemande = {POINT_D_ECHANTILLONNAGE_DEMANDE, 160};
+
+    sequenceurInitialise();
+    SEQUENCEUR_machine(&filtreDemande);
+    verifieEgalite("SEQR01", etatSynchronisee.filtre.type, FILTRE_IIR);
+    verifieEgalite("SEQR02", etatSynchronisee.filtre.parametre, 3);
+
+    SEQUENCEUR_machine(&pointDemande);
+    verifieEgalite("SEQR03", pointDEchantillonnage, 160);
+    sequenceurEtablitPointDEchantillonnage(128);
+    sequenceurInitialise();
+}
+
+void test_sequenceur() {
+    enchaine_les_canaux_selon_la_table();
+    synchronise_la_lecture_de_courant_avec_le_pwm();
+    emet_la_moyenne_des_lectures_surechantillonnees();
+    filtre_les_lectures_avant_de_les_emettre();
+    applique_les_reglages_demandes();
+}
+#endif
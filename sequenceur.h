@@ -0,0 +1,59 @@
+#include "domaine.h"
+#include "filtre.h"
+
+#ifndef __SEQUENCEUR_H
+#define __SEQUENCEUR_H
+
+/**
+ * Décrit une entrée de la table de conversions A/D.
+ */
+typedef struct {
+    /** Canal analogique (ANx) à convertir. */
+    unsigned char canal;
+    /** Le canal est converti un tour de séquence sur 'diviseur'. */
+    unsigned char diviseur;
+    /**
+     * Suréchantillonnage, exprimé comme un décalage: 0 (1x), 2 (4x)
+     * ou 4 (16x). L'événement est émis avec la moyenne des lectures.
+     */
+    unsigned char decalage;
+    /** Événement émis avec la lecture. */
+    enum EVENEMENT evenement;
+    /** Filtre appliqué par défaut aux lectures, avant de les émettre. */
+    TypeFiltre filtre;
+    /** Paramètre du filtre par défaut. */
+    unsigned char parametreFiltre;
+} ConversionAD;
+
+/**
+ * Décrit la conversion A/D à démarrer.
+ */
+typedef struct {
+    /** Canal analogique (ANx) à convertir. */
+    unsigned char canal;
+    /** Temps d'acquisition, selon le codage de ADCON2bits.ACQT. */
+    unsigned char acquisition;
+} DemarrageAD;
+
+void sequenceurInitialise();
+void sequenceurEtablitPointDEchantillonnage(unsigned char point);
+unsigned char sequenceurConfigureFiltre(unsigned char canal, 
+                                        TypeFiltre type, 
+                                        unsigned char parametre);
+unsigned char sequenceurPeriodePwm(unsigned char rapportCyclique, 
+                                   unsigned char phase,
+                                   DemarrageAD *demarrage);
+unsigned char sequenceurConversionTerminee(unsigned int lecture, 
+                                           DemarrageAD *demarrage);
+
+/**
+ * Machine à états pour appliquer les réglages du séquenceur.
+ * @param ev Événement à traiter.
+ */
+void SEQUENCEUR_machine(EvenementEtValeur *ev);
+
+#ifdef TEST
+void test_sequenceur();
+#endif
+
+#endif
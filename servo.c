@@ -0,0 +1,485 @@
+#include "domaine.h"
+#include "tableauDeBord.h"
+#include "servo.h"
+#include "test.h"
+
+/** Durée de pulsation au repos, en ticks (1,5ms). */
+#define SERVO_DUREE_NEUTRE 3024
+
+/**
+ * État d'un canal de servo.
+ */
+typedef struct {
+    /** Position cible, en ticks. 0 pour ne pas produire de pulsation. */
+    unsigned int cible;
+    /** Position courante, en 1/16 de tick. */
+    unsigned int position;
+    /** Vitesse maximum, en ticks par trame. 0 pour ne pas la limiter. */
+    unsigned char vitesse;
+    /** Décalage du lissage exponentiel. 0 pour ne pas lisser. */
+    unsigned char lissage;
+} Servo;
+
+/** État des canaux. */
+Servo servos[SERVO_NOMBRE_DE_CANAUX];
+
+/** Sortie (bit du port A) de chaque canal. */
+const unsigned char servoSorties[SERVO_NOMBRE_DE_CANAUX] = {
+    0b01000000,     // SERVO_ROUES_AVANT: RA6
+    0b10000000,     // SERVO_AUXILIAIRE_1: RA7
+    0b00100000      // SERVO_AUXILIAIRE_2: RA5
+};
+
+/**
+ * Vitesse maximum des roues avant demandée par la manoeuvre en cours,
+ * en ticks par trame. 0 pour appliquer la vitesse du canal.
+ */
+unsigned char servoVitesseManoeuvre = 0;
+
+/**
+ * Plans des trames. L'interruption produit le plan actif pendant que
+ * la boucle principale prépare l'autre.
+ * L'échange se fait sans désactiver les interruptions: chaque index 
+ * n'a qu'un seul auteur, et tient sur un octet, ce qui rend sa lecture
+ * et son écriture atomiques. Un plan n'est jamais modifié entre sa
+ * publication et la fin de la trame où il est produit.
+ */
+PlanServo servoPlans[2];
+
+/** 
+ * Index du plan produit par l'interruption. Seule l'interruption le
+ * modifie, au début de chaque trame.
+ */
+unsigned char servoPlanActif = 0;
+
+/** 
+ * Index du dernier plan complet. Seule la boucle principale le 
+ * modifie, une fois le plan prêt. Tant qu'il diffère de 
+ * servoPlanActif, le plan attend le début de la trame suivante.
+ */
+unsigned char servoPlanPret = 0;
+
+/** Index du prochain flanc dans le plan actif. */
+unsigned char servoFlanc = 0;
+
+/**
+ * Initialise tous les canaux au neutre, sans limite de vitesse ni
+ * lissage, et prépare le plan de la première trame. La boucle 
+ * principale peut préparer la suivante.
+ */
+void servoInitialise() {
+    unsigned char canal;
+
+    for (canal = 0; canal < SERVO_NOMBRE_DE_CANAUX; canal++) {
+        servos[canal].cible = SERVO_DUREE_NEUTRE;
+        servos[canal].position = SERVO_DUREE_NEUTRE << 4;
+        servos[canal].vitesse = 0;
+        servos[canal].lissage = 0;
+    }
+    servoVitesseManoeuvre = 0;
+    servoFlanc = 0;
+    servoPlanActif = 0;
+    servoPlanPret = 0;
+    servoPlanifie();
+    servoPlanActif = servoPlanPret;
+}
+
+/**
+ * Établit la position à atteindre. Le servo s'en approche à chaque
+ * trame, selon sa vitesse et son lissage.
+ * @param canal Le canal.
+ * @param duree Durée de la pulsation, en ticks de 0,5us, ou 0 pour
+ * ne plus produire de pulsation.
+ */
+void servoEtablitCible(CanalServo canal, unsigned int duree) {
+    servos[canal].cible = duree;
+}
+
+/**
+ * Établit la vitesse maximum d'un servo.
+ * @param canal Le canal.
+ * @param vitesse En ticks par trame, ou 0 pour ne pas limiter.
+ */
+void servoEtablitVitesse(CanalServo canal, unsigned char vitesse) {
+    servos[canal].vitesse = vitesse;
+}
+
+/**
+ * Établit la vitesse maximum des roues avant demandée par une
+ * manoeuvre. Elle remplace la vitesse du canal jusqu'à ce qu'elle
+ * soit remise à 0.
+ * @param vitesse En ticks par trame, ou 0 pour revenir à la vitesse
+ * du canal.
+ */
+void servoEtablitVitesseManoeuvre(unsigned char vitesse) {
+    servoVitesseManoeuvre = vitesse;
+}
+
+/**
+ * Établit le lissage exponentiel d'un servo: à chaque trame, la
+ * position parcourt 1 / 2^lissage de la distance restante.
+ * @param canal Le canal.
+ * @param lissage Décalage, entre 0 (pas de lissage) et SERVO_LISSAGE_MAX.
+ */
+void servoEtablitLissage(CanalServo canal, unsigned char lissage) {
+    if (lissage > SERVO_LISSAGE_MAX) {
+        lissage = SERVO_LISSAGE_MAX;
+    }
+    servos[canal].lissage = lissage;
+}
+
+/**
+ * Indique la position courante d'un servo.
+ * @param canal Le canal.
+ * @return La durée de pulsation, en ticks, ou 0 si le canal ne produit
+ * pas de pulsation.
+ */
+unsigned int servoPosition(CanalServo canal) {
+    if (servos[canal].cible == 0) {
+        return 0;
+    }
+    return (servos[canal].position + 8) >> 4;
+}
+
+/**
+ * Avance la position d'un servo d'une trame vers sa cible.
+ * @param servo Le servo.
+ * @param vitesse Vitesse maximum, en ticks par trame, ou 0.
+ */
+static void avance(Servo *servo, unsigned int vitesse) {
+    unsigned int cible = servo->cible << 4;
+    unsigned int ecart;
+    unsigned int pas;
+
+    if (servo->cible == 0) {
+        return;
+    }
+    if (cible >= servo->position) {
+        ecart = cible - servo->position;
+    } else {
+        ecart = servo->position - cible;
+    }
+
+    // Lissage exponentiel. Les derniers écarts, trop petits pour
+    // être lissés, sont parcourus d'un coup:
+    pas = ecart >> servo->lissage;
+    if (pas == 0) {
+        pas = ecart;
+    }
+
+    // Limite de vitesse:
+    vitesse <<= 4;
+    if ((vitesse != 0) && (pas > vitesse)) {
+        pas = vitesse;
+    }
+
+    if (cible >= servo->position) {
+        servo->position += pas;
+    } else {
+        servo->position -= pas;
+    }
+}
+
+/**
+ * Si l'interruption a pris le dernier plan publié, avance chaque servo
+ * d'une trame vers sa cible, et prépare le plan de la trame suivante:
+ * les canaux sont triés par durée de pulsation, et les canaux de même
+ * durée partagent un flanc. Le plan est publié à la fin, et 
+ * l'interruption le prend au début de la trame suivante.
+ * À appeler depuis la boucle principale.
+ */
+void servoPlanifie() {
+    PlanServo *plan;
+    unsigned char ordre[SERVO_NOMBRE_DE_CANAUX];
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+    unsigned int vitesse;
+    unsigned int instant;
+    unsigned int duree;
+    unsigned char canal;
+    unsigned char n, m;
+
+    // Le plan précédent n'a pas encore été pris:
+    if (servoPlanPret != servoPlanActif) {
+        return;
+    }
+
+    // Avance chaque servo, et les trie par insertion:
+    for (canal = 0; canal < SERVO_NOMBRE_DE_CANAUX; canal++) {
+        vitesse = servos[canal].vitesse;
+        if ((canal == SERVO_ROUES_AVANT) && (servoVitesseManoeuvre != 0)) {
+            vitesse = servoVitesseManoeuvre;
+        }
+        avance(&servos[canal], vitesse);
+        durees[canal] = servoPosition(canal);
+
+        for (n = canal; (n > 0) && (durees[ordre[n - 1]] > durees[canal]); n--) {
+            ordre[n] = ordre[n - 1];
+        }
+        ordre[n] = canal;
+    }
+
+    // Prépare les flancs dans le plan inactif. L'interruption ne 
+    // change pas de plan tant que celui-ci n'est pas publié:
+    plan = &servoPlans[servoPlanActif ^ 1];
+    instant = 0;
+    m = 0;
+    plan->flancs[0].sorties = 0;
+    for (canal = 0; canal < SERVO_NOMBRE_DE_CANAUX; canal++) {
+        if (durees[canal] != 0) {
+            plan->flancs[0].sorties |= servoSorties[canal];
+        }
+    }
+    for (n = 0; n < SERVO_NOMBRE_DE_CANAUX; n++) {
+        canal = ordre[n];
+        duree = durees[canal];
+        if (duree == 0) {
+            continue;
+        }
+        if (duree != instant) {
+            plan->flancs[m].recharge.valeur = (unsigned int) 65535 - (duree - instant);
+            m++;
+            plan->flancs[m].sorties = plan->flancs[m - 1].sorties;
+            instant = duree;
+        }
+        plan->flancs[m].sorties &= ~servoSorties[canal];
+    }
+    plan->flancs[m].recharge.valeur = (unsigned int) 65535 - (SERVO_DUREE_TRAME - instant);
+    plan->nombreDeFlancs = m + 1;
+
+    // Publie le plan:
+    servoPlanPret = servoPlanActif ^ 1;
+}
+
+/**
+ * Passe au flanc suivant de la trame. Au début de chaque trame, prend
+ * le dernier plan publié, ce qui permet à la boucle principale de 
+ * préparer le suivant.
+ * À appeler depuis l'interruption du temporisateur, à chaque flanc. Le
+ * temps de traitement ne dépend pas du nombre de canaux.
+ * @return Le flanc à produire: les sorties à appliquer maintenant, et
+ * la valeur à charger dans le temporisateur.
+ */
+const FlancServo *servoFlancSuivant() {
+    const PlanServo *plan;
+    const FlancServo *flanc;
+
+    if (servoFlanc == 0) {
+        servoPlanActif = servoPlanPret;
+    }
+    plan = &servoPlans[servoPlanActif];
+    flanc = &plan->flancs[servoFlanc];
+    if (++servoFlanc >= plan->nombreDeFlancs) {
+        servoFlanc = 0;
+    }
+    return flanc;
+}
+
+#ifdef TEST
+/**
+ * Simule une trame: planifie, et produit tous les flancs du plan.
+ * @param durees Reçoit la durée de pulsation de chaque sortie, en ticks.
+ * @return Le nombre de flancs de la trame.
+ */
+unsigned char trameServo(unsigned int *durees) {
+    const FlancServo *flanc;
+    unsigned int instant = 0;
+    unsigned char sorties;
+    unsigned char canal;
+    unsigned char n = 0;
+
+    servoPlanifie();
+    for (canal = 0; canal < SERVO_NOMBRE_DE_CANAUX; canal++) {
+        durees[canal] = 0;
+    }
+    do {
+        flanc = servoFlancSuivant();
+        sorties = flanc->sorties;
+        instant += (unsigned int) 65535 - flanc->recharge.valeur;
+        for (canal = 0; canal < SERVO_NOMBRE_DE_CANAUX; canal++) {
+            if (sorties & servoSorties[canal]) {
+                durees[canal] = instant;
+            }
+        }
+        n++;
+    } while (servoFlanc != 0);
+
+    verifieEgalite("SRVT", instant, SERVO_DUREE_TRAME);
+    return n;
+}
+
+void produit_les_trames_des_servos() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+
+    // La première trame est prête dès l'initialisation:
+    servoInitialise();
+    verifieEgalite("SRVP01", trameServo(durees), 2);
+    verifieEgalite("SRVP02", durees[SERVO_ROUES_AVANT], 3024);
+    verifieEgalite("SRVP03", durees[SERVO_AUXILIAIRE_2], 3024);
+
+    // Les canaux sont triés par durée:
+    servoEtablitCible(SERVO_ROUES_AVANT, 4000);
+    servoEtablitCible(SERVO_AUXILIAIRE_1, 2000);
+    servoEtablitCible(SERVO_AUXILIAIRE_2, 3000);
+    verifieEgalite("SRVP11", trameServo(durees), 4);
+    verifieEgalite("SRVP12", durees[SERVO_ROUES_AVANT], 4000);
+    verifieEgalite("SRVP13", durees[SERVO_AUXILIAIRE_1], 2000);
+    verifieEgalite("SRVP14", durees[SERVO_AUXILIAIRE_2], 3000);
+    verifieEgalite("SRVP15", servoPlans[servoPlanActif].flancs[0].sorties, SERVO_SORTIES);
+    verifieEgalite("SRVP16", servoPlans[servoPlanActif].flancs[3].sorties, 0);
+
+    // Un canal inactif ne produit pas de pulsation:
+    servoEtablitCible(SERVO_AUXILIAIRE_1, 0);
+    servoEtablitCible(SERVO_AUXILIAIRE_2, 4000);
+    verifieEgalite("SRVP21", trameServo(durees), 2);
+    verifieEgalite("SRVP22", durees[SERVO_AUXILIAIRE_1], 0);
+    verifieEgalite("SRVP23", durees[SERVO_AUXILIAIRE_2], 4000);
+    verifieEgalite("SRVP24", servoPlans[servoPlanActif].flancs[0].sorties, 0b01100000);
+}
+
+void ne_change_de_plan_qu_au_debut_de_la_trame() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+
+    servoInitialise();
+    servoEtablitCible(SERVO_ROUES_AVANT, 2500);
+    servoEtablitCible(SERVO_AUXILIAIRE_1, 3500);
+    trameServo(durees);
+
+    // Un plan publié au milieu de la trame attend la trame suivante:
+    servoFlancSuivant();
+    servoEtablitCible(SERVO_ROUES_AVANT, 3600);
+    servoPlanifie();
+    verifieEgalite("SRVD01", servoFlancSuivant()->recharge.valeur, 65535 - (3024 - 2500));
+    servoFlancSuivant();
+    servoFlancSuivant();
+    verifieEgalite("SRVD02", servoFlanc, 0);
+    verifieEgalite("SRVD03", servoFlancSuivant()->recharge.valeur, 65535 - 3024);
+
+    // Sans nouveau plan, la trame est répétée:
+    while (servoFlanc != 0) {
+        servoFlancSuivant();
+    }
+    verifieEgalite("SRVD11", servoFlancSuivant()->recharge.valeur, 65535 - 3024);
+}
+
+void ne_modifie_pas_un_plan_publie() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+    unsigned char actif;
+    unsigned char n;
+
+    servoInitialise();
+    servoEtablitCible(SERVO_AUXILIAIRE_1, 0);
+    servoEtablitCible(SERVO_AUXILIAIRE_2, 0);
+    trameServo(durees);
+
+    // Au milieu de la trame, un plan est publié:
+    servoFlancSuivant();
+    actif = servoPlanActif;
+    servoEtablitCible(SERVO_ROUES_AVANT, 2500);
+    servoPlanifie();
+    verifieEgalite("SRVA01", servoPlanPret, actif ^ 1);
+
+    // Tant qu'il n'est pas pris, il n'est pas modifié, et le plan
+    // actif non plus:
+    servoEtablitCible(SERVO_ROUES_AVANT, 3500);
+    for (n = 0; n < 3; n++) {
+        servoPlanifie();
+    }
+    verifieEgalite("SRVA02", servoPlanActif, actif);
+    verifieEgalite("SRVA03", servoPlans[actif].flancs[0].recharge.valeur, 65535 - 3024);
+    verifieEgalite("SRVA04", servoPlans[actif ^ 1].flancs[0].recharge.valeur, 65535 - 2500);
+
+    // L'interruption le prend au début de la trame suivante, et la 
+    // boucle principale prépare le suivant dans l'autre plan:
+    servoFlancSuivant();
+    verifieEgalite("SRVA11", servoFlancSuivant()->recharge.valeur, 65535 - 2500);
+    verifieEgalite("SRVA12", servoPlanActif, actif ^ 1);
+    servoPlanifie();
+    verifieEgalite("SRVA13", servoPlans[actif ^ 1].flancs[0].recharge.valeur, 65535 - 2500);
+    verifieEgalite("SRVA14", servoPlans[actif].flancs[0].recharge.valeur, 65535 - 3500);
+}
+
+void limite_la_vitesse_du_servo() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+    unsigned char n;
+
+    servoInitialise();
+    servoEtablitVitesse(SERVO_ROUES_AVANT, 100);
+    servoEtablitCible(SERVO_ROUES_AVANT, 3024 + 250);
+    trameServo(durees);
+    verifieEgalite("SRVV01", durees[SERVO_ROUES_AVANT], 3124);
+    trameServo(durees);
+    verifieEgalite("SRVV02", durees[SERVO_ROUES_AVANT], 3224);
+    trameServo(durees);
+    verifieEgalite("SRVV03", durees[SERVO_ROUES_AVANT], 3274);
+    trameServo(durees);
+    verifieEgalite("SRVV04", durees[SERVO_ROUES_AVANT], 3274);
+
+    // Dans l'autre sens:
+    servoEtablitCible(SERVO_ROUES_AVANT, 2000);
+    for (n = 0; n < 12; n++) {
+        trameServo(durees);
+    }
+    verifieEgalite("SRVV11", durees[SERVO_ROUES_AVANT], 2074);
+    trameServo(durees);
+    verifieEgalite("SRVV12", durees[SERVO_ROUES_AVANT], 2000);
+
+    // Les autres canaux ne sont pas limités:
+    servoEtablitCible(SERVO_AUXILIAIRE_1, 4000);
+    trameServo(durees);
+    verifieEgalite("SRVV21", durees[SERVO_AUXILIAIRE_1], 4000);
+}
+
+void la_manoeuvre_remplace_la_vitesse() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+
+    servoInitialise();
+    servoEtablitVitesse(SERVO_ROUES_AVANT, 100);
+    servoEtablitVitesseManoeuvre(10);
+    servoEtablitCible(SERVO_ROUES_AVANT, 3124);
+    trameServo(durees);
+    verifieEgalite("SRVM01", durees[SERVO_ROUES_AVANT], 3034);
+
+    servoEtablitVitesseManoeuvre(0);
+    trameServo(durees);
+    verifieEgalite("SRVM02", durees[SERVO_ROUES_AVANT], 3124);
+}
+
+void lisse_la_position_du_servo() {
+    unsigned int durees[SERVO_NOMBRE_DE_CANAUX];
+    unsigned char n;
+
+    servoInitialise();
+    servoEtablitLissage(SERVO_ROUES_AVANT, 2);
+    servoEtablitCible(SERVO_ROUES_AVANT, 3024 + 400);
+    trameServo(durees);
+    verifieEgalite("SRVL01", durees[SERVO_ROUES_AVANT], 3124);
+    trameServo(durees);
+    verifieEgalite("SRVL02", durees[SERVO_ROUES_AVANT], 3199);
+
+    // Le lissage et la limite de vitesse se combinent:
+    servoEtablitVitesse(SERVO_ROUES_AVANT, 20);
+    servoEtablitCible(SERVO_ROUES_AVANT, 2000);
+    trameServo(durees);
+    verifieEgalite("SRVL11", durees[SERVO_ROUES_AVANT], 3179);
+
+    // La cible finit par être atteinte exactement:
+    servoEtablitVitesse(SERVO_ROUES_AVANT, 0);
+    for (n = 0; n < 60; n++) {
+        trameServo(durees);
+    }
+    verifieEgalite("SRVL21", durees[SERVO_ROUES_AVANT], 2000);
+
+    // Le lissage est limité:
+    servoEtablitLissage(SERVO_ROUES_AVANT, 10);
+    verifieEgalite("SRVL31", servos[SERVO_ROUES_AVANT].lissage, SERVO_LISSAGE_MAX);
+}
+
+void test_servo() {
+    produit_les_trames_des_servos();
+    ne_change_de_plan_qu_au_debut_de_la_trame();
+    ne_modifie_pas_un_plan_publie();
+    limite_la_vitesse_du_servo();
+    la_manoeuvre_remplace_la_vitesse();
+    lisse_la_position_du_servo();
+}
+#endif
@@ -0,0 +1,64 @@
+#ifndef SERVO__H
+#define	SERVO__H
+
+#include "tableauDeBord.h"
+
+/** Nombre de sorties de servo produites par le même temporisateur. */
+#define SERVO_NOMBRE_DE_CANAUX 3
+
+/** Décalage maximum du lissage exponentiel. */
+#define SERVO_LISSAGE_MAX 6
+
+/** Durée de la trame des servos, en ticks de 0,5us (20ms). */
+#define SERVO_DUREE_TRAME 40000
+
+/**
+ * Canaux de servo.
+ */
+typedef enum {
+    /** Servo de direction des roues avant, sur RA6. */
+    SERVO_ROUES_AVANT = 0,
+    /** Servo ou variateur auxiliaire (boîte de vitesses...), sur RA7. */
+    SERVO_AUXILIAIRE_1 = 1,
+    /** Servo ou variateur auxiliaire (caméra...), sur RA5. */
+    SERVO_AUXILIAIRE_2 = 2
+} CanalServo;
+
+/** Bits du port A occupés par les sorties des servos. */
+#define SERVO_SORTIES 0b11100000
+
+/**
+ * Un flanc du signal des servos.
+ */
+typedef struct {
+    /** Valeur à charger dans le temporisateur jusqu'au flanc suivant. */
+    Compteur recharge;
+    /** État des sorties des servos à partir de ce flanc. */
+    unsigned char sorties;
+} FlancServo;
+
+/**
+ * Les flancs d'une trame, dans l'ordre. Le premier flanc est le début
+ * de la trame, où toutes les sorties actives montent. Chaque flanc 
+ * suivant fait descendre les sorties des canaux de même durée.
+ */
+typedef struct {
+    FlancServo flancs[SERVO_NOMBRE_DE_CANAUX + 1];
+    unsigned char nombreDeFlancs;
+} PlanServo;
+
+void servoInitialise();
+void servoEtablitCible(CanalServo canal, unsigned int duree);
+void servoEtablitVitesse(CanalServo canal, unsigned char vitesse);
+void servoEtablitVitesseManoeuvre(unsigned char vitesse);
+void servoEtablitLissage(CanalServo canal, unsigned char lissage);
+unsigned int servoPosition(CanalServo canal);
+void servoPlanifie();
+const FlancServo *servoFlancSuivant();
+
+#ifdef TEST
+unsigned char trameServo(unsigned int *durees);
+void test_servo();
+#endif
+
+#endif
@@ -0,0 +1,422 @@
+/*
+ * File:   balayage.c
+ * Auteur: jmgonet
+ *
+ * Balayage des paramètres des régulateurs: simule les scénarios de
+ * référence pour chaque configuration d'une grille (ou d'un tirage
+ * aléatoire), en répartissant les configurations sur tous les
+ * processeurs, puis classe les configurations selon leur coût.
+ *
+ *      ./balayage [options] [parametre=min:max[:pas]]...
+ *
+ *      -n nombre   Tire 'nombre' configurations au hasard dans les
+ *                  intervalles, au lieu de parcourir la grille.
+ *      -g graine   Graine du tirage aléatoire (1 par défaut).
+ *      -j nombre   Nombre de processus (tous les processeurs par défaut).
+ *      -s nom      Ne simule que ce scénario (peut être répété).
+ *      -p i:d:e    Poids de l'ITAE, du dépassement et de l'énergie
+ *                  dans le coût (1:0.01:0.01 par défaut).
+ *      -f format   csv (par défaut) ou json.
+ *
+ * Exemple:
+ *      ./balayage pVitesse=16:32:4 dVitesse=0:12:3 > vitesse.csv
+ *
+ * Le résultat ne dépend pas du nombre de processus: on peut le comparer
+ * d'une version du micrologiciel à l'autre avec diff.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "scenarios.h"
+
+/** Nombre maximum de paramètres balayés et de scénarios choisis. */
+#define NOMBRE_MAX_AXES 16
+#define NOMBRE_MAX_SCENARIOS 16
+
+/** Coût ajouté pour chaque scénario dont la simulation échoue. */
+#define COUT_ECHEC 1000.0
+
+/**
+ * Décrit un paramètre qu'on peut balayer.
+ */
+typedef struct {
+    const char *nom;
+    size_t position;
+} Parametre;
+
+static const Parametre parametres[] = {
+    {"pVitesse",            offsetof(Reglages, regulateurs.pVitesse)},
+    {"dVitesse",            offsetof(Reglages, regulateurs.dVitesse)},
+    {"pDeplacement",        offsetof(Reglages, regulateurs.pDeplacement)},
+    {"vDeplacement",        offsetof(Reglages, regulateurs.vDeplacement)},
+    {"fDeplacement",        offsetof(Reglages, regulateurs.fDeplacement)},
+    {"aDeplacement",        offsetof(Reglages, regulateurs.aDeplacement)},
+    {"tensionMoyenneMax",   offsetof(Reglages, regulateurs.tensionMoyenneMax)},
+    {"baseDeTempsVitesse",  offsetof(Reglages, baseDeTempsVitesse)},
+    {"baseDeTempsProfil",   offsetof(Reglages, baseDeTempsProfil)},
+};
+
+#define NOMBRE_DE_PARAMETRES (sizeof(parametres) / sizeof(Parametre))
+
+/**
+ * Intervalle balayé pour un paramètre.
+ */
+typedef struct {
+    const Parametre *parametre;
+    int min;
+    int max;
+    int pas;
+} Axe;
+
+/**
+ * Configuration simulée, et mesures cumulées sur tous les scénarios.
+ * Le processus qui la simule l'envoie en un seul bloc par le tube.
+ */
+typedef struct {
+    unsigned long indice;
+    Reglages reglages;
+    double itae;
+    double depassement;
+    double tempsDEtablissement;
+    double energie;
+    double cout;
+    int echecs;
+} Configuration;
+
+static Axe axes[NOMBRE_MAX_AXES];
+static int nombreDAxes = 0;
+static Scenario *choisis[NOMBRE_MAX_SCENARIOS];
+static int nombreDeChoisis = 0;
+static unsigned long tirages = 0;
+static unsigned long graine = 1;
+static double poidsItae = 1, poidsDepassement = 0.01, poidsEnergie = 0.01;
+
+static int *champ(Reglages *reglages, const Parametre *parametre) {
+    return (int *) ((char *) reglages + parametre->position);
+}
+
+/**
+ * Nombre de valeurs d'un axe de la grille.
+ */
+static unsigned long valeursAxe(const Axe *axe) {
+    return (unsigned long) ((axe->max - axe->min) / axe->pas) + 1;
+}
+
+/**
+ * Générateur pseudo-aléatoire (splitmix64). Chaque configuration a sa
+ * propre séquence, pour que le tirage ne dépende pas de la répartition
+ * entre processus.
+ */
+static unsigned long long aleatoire(unsigned long long *etat) {
+    unsigned long long z = (*etat += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Établit les réglages de la configuration indiquée.
+ * @param indice Numéro de la configuration.
+ * @param reglages Réglages à établir.
+ */
+static void prepareConfiguration(unsigned long indice, Reglages *reglages) {
+    unsigned long long etat = graine * 1000003ULL + indice;
+    unsigned long reste = indice;
+    unsigned long n;
+    const Axe *axe;
+    int a;
+
+    reglagesParDefaut(reglages);
+    for (a = 0; a < nombreDAxes; a++) {
+        axe = &axes[a];
+        if (tirages > 0) {
+            n = (unsigned long) (aleatoire(&etat) % (axe->max - axe->min + 1));
+            *champ(reglages, axe->parametre) = axe->min + (int) n;
+        } else {
+            n = reste % valeursAxe(axe);
+            reste /= valeursAxe(axe);
+            *champ(reglages, axe->parametre) = axe->min + (int) n * axe->pas;
+        }
+    }
+}
+
+/**
+ * Simule tous les scénarios choisis pour une configuration.
+ * @param configuration La configuration, dont les réglages sont établis.
+ */
+static void simuleConfiguration(Configuration *configuration) {
+    Resultats resultats;
+    int n;
+
+    configuration->itae = 0;
+    configuration->depassement = 0;
+    configuration->tempsDEtablissement = 0;
+    configuration->energie = 0;
+    configuration->echecs = 0;
+    for (n = 0; n < nombreDeChoisis; n++) {
+        if ((simuleScenarioIsole(choisis[n], &configuration->reglages, &resultats) != 0)
+                || resultats.debordement) {
+            configuration->echecs++;
+            continue;
+        }
+        configuration->itae += resultats.itae;
+        configuration->energie += resultats.energie;
+        if (resultats.depassement > configuration->depassement) {
+            configuration->depassement = resultats.depassement;
+        }
+        if ((resultats.tempsDEtablissement < 0)
+                || (configuration->tempsDEtablissement < 0)) {
+            configuration->tempsDEtablissement = -1;
+        } else if (resultats.tempsDEtablissement > configuration->tempsDEtablissement) {
+            configuration->tempsDEtablissement = resultats.tempsDEtablissement;
+        }
+    }
+    configuration->cout = poidsItae * configuration->itae
+            + poidsDepassement * configuration->depassement
+            + poidsEnergie * configuration->energie
+            + COUT_ECHEC * configuration->echecs;
+}
+
+/**
+ * Simule une configuration sur 'processus', en commençant par
+ * 'premiere', et envoie chaque résultat dans le tube.
+ */
+static void travailleur(int tube, unsigned long premiere,
+                        unsigned long total, int processus) {
+    Configuration configuration;
+    unsigned long indice;
+
+    for (indice = premiere; indice < total; indice += processus) {
+        configuration.indice = indice;
+        prepareConfiguration(indice, &configuration.reglages);
+        simuleConfiguration(&configuration);
+        if (write(tube, &configuration, sizeof(Configuration)) != sizeof(Configuration)) {
+            _exit(1);
+        }
+    }
+    _exit(0);
+}
+
+static int compareCouts(const void *a, const void *b) {
+    const Configuration *ca = (const Configuration *) a;
+    const Configuration *cb = (const Configuration *) b;
+
+    if (ca->cout < cb->cout) {
+        return -1;
+    }
+    if (ca->cout > cb->cout) {
+        return 1;
+    }
+    return ca->indice < cb->indice ? -1 : (ca->indice > cb->indice);
+}
+
+static void afficheCsv(Configuration *configurations, unsigned long total) {
+    unsigned long n;
+    unsigned int p;
+
+    printf("rang,cout");
+    for (p = 0; p < NOMBRE_DE_PARAMETRES; p++) {
+        printf(",%s", parametres[p].nom);
+    }
+    printf(",itae,depassement,etablissement,energie,echecs\n");
+    for (n = 0; n < total; n++) {
+        printf("%lu,%.6f", n + 1, configurations[n].cout);
+        for (p = 0; p < NOMBRE_DE_PARAMETRES; p++) {
+            printf(",%d", *champ(&configurations[n].reglages, &parametres[p]));
+        }
+        printf(",%.6f,%.3f,%.4f,%.4f,%d\n",
+                configurations[n].itae, configurations[n].depassement,
+                configurations[n].tempsDEtablissement, configurations[n].energie,
+                configurations[n].echecs);
+    }
+}
+
+static void afficheJson(Configuration *configurations, unsigned long total) {
+    unsigned long n;
+    unsigned int p;
+
+    printf("[\n");
+    for (n = 0; n < total; n++) {
+        printf("  {\"rang\": %lu, \"cout\": %.6f", n + 1, configurations[n].cout);
+        for (p = 0; p < NOMBRE_DE_PARAMETRES; p++) {
+            printf(", \"%s\": %d", parametres[p].nom,
+                    *champ(&configurations[n].reglages, &parametres[p]));
+        }
+        printf(", \"itae\": %.6f, \"depassement\": %.3f, \"etablissement\": %.4f"
+                ", \"energie\": %.4f, \"echecs\": %d}%s\n",
+                configurations[n].itae, configurations[n].depassement,
+                configurations[n].tempsDEtablissement, configurations[n].energie,
+                configurations[n].echecs, n + 1 < total ? "," : "");
+    }
+    printf("]\n");
+}
+
+/**
+ * Interprète un axe, sous la forme parametre=min:max[:pas].
+ * @return 0 si l'axe est valide.
+ */
+static int interpreteAxe(const char *texte) {
+    const char *egal = strchr(texte, '=');
+    unsigned int p;
+    Axe *axe;
+
+    if ((egal == 0) || (nombreDAxes >= NOMBRE_MAX_AXES)) {
+        return -1;
+    }
+    axe = &axes[nombreDAxes];
+    axe->parametre = 0;
+    for (p = 0; p < NOMBRE_DE_PARAMETRES; p++) {
+        if ((strlen(parametres[p].nom) == (size_t) (egal - texte))
+                && (strncmp(parametres[p].nom, texte, egal - texte) == 0)) {
+            axe->parametre = &parametres[p];
+        }
+    }
+    axe->pas = 1;
+    if ((axe->parametre == 0)
+            || (sscanf(egal + 1, "%d:%d:%d", &axe->min, &axe->max, &axe->pas) < 2)
+            || (axe->max < axe->min) || (axe->pas < 1)) {
+        return -1;
+    }
+    nombreDAxes++;
+    return 0;
+}
+
+static void usage() {
+    unsigned int p;
+
+    fprintf(stderr, "usage: balayage [-n tirages] [-g graine] [-j processus] "
+            "[-s scenario]... [-p itae:depassement:energie] [-f csv|json] "
+            "[parametre=min:max[:pas]]...\n");
+    fprintf(stderr, "parametres:");
+    for (p = 0; p < NOMBRE_DE_PARAMETRES; p++) {
+        fprintf(stderr, " %s", parametres[p].nom);
+    }
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    Configuration *configurations;
+    Configuration configuration;
+    unsigned long total = 1, recues = 0;
+    int processus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int json = 0, erreurs = 0;
+    int tube[2];
+    int option, n;
+    pid_t pid;
+
+    while ((option = getopt(argc, argv, "n:g:j:s:p:f:")) != -1) {
+        switch (option) {
+            case 'n':
+                tirages = strtoul(optarg, 0, 10);
+                break;
+            case 'g':
+                graine = strtoul(optarg, 0, 10);
+                break;
+            case 'j':
+                processus = atoi(optarg);
+                break;
+            case 's':
+                if ((nombreDeChoisis >= NOMBRE_MAX_SCENARIOS)
+                        || ((choisis[nombreDeChoisis++] = chercheScenario(optarg)) == 0)) {
+                    fprintf(stderr, "scenario inconnu: %s\n", optarg);
+                    usage();
+                }
+                break;
+            case 'p':
+                if (sscanf(optarg, "%lf:%lf:%lf",
+                        &poidsItae, &poidsDepassement, &poidsEnergie) != 3) {
+                    usage();
+                }
+                break;
+            case 'f':
+                json = (strcmp(optarg, "json") == 0);
+                if (!json && (strcmp(optarg, "csv") != 0)) {
+                    usage();
+                }
+                break;
+            default:
+                usage();
+        }
+    }
+    for (n = optind; n < argc; n++) {
+        if (interpreteAxe(argv[n]) != 0) {
+            fprintf(stderr, "axe invalide: %s\n", argv[n]);
+            usage();
+        }
+    }
+    if (processus < 1) {
+        processus = 1;
+    }
+
+    // Scénarios et nombre de configurations:
+    if (nombreDeChoisis == 0) {
+        for (n = 0; n < (int) nombreDeScenarios && n < NOMBRE_MAX_SCENARIOS; n++) {
+            choisis[nombreDeChoisis++] = &scenarios[n];
+        }
+    }
+    for (n = 0; n < nombreDeChoisis; n++) {
+        modeleParametresParDefaut(&choisis[n]->modele);
+    }
+    if (tirages > 0) {
+        total = tirages;
+    } else {
+        for (n = 0; n < nombreDAxes; n++) {
+            total *= valeursAxe(&axes[n]);
+        }
+    }
+    if ((unsigned long) processus > total) {
+        processus = (int) total;
+    }
+    configurations = malloc(total * sizeof(Configuration));
+    if ((configurations == 0) || (pipe(tube) != 0)) {
+        perror("balayage");
+        return 1;
+    }
+    fprintf(stderr, "%lu configurations, %d scenarios, %d processus\n",
+            total, nombreDeChoisis, processus);
+
+    // Répartit les configurations entre les processus. Chaque résultat
+    // est plus petit que PIPE_BUF, donc les écritures ne se mélangent pas:
+    for (n = 0; n < processus; n++) {
+        pid = fork();
+        if (pid < 0) {
+            perror("balayage");
+            return 1;
+        }
+        if (pid == 0) {
+            close(tube[0]);
+            travailleur(tube[1], (unsigned long) n, total, processus);
+        }
+    }
+    close(tube[1]);
+    while ((recues < total)
+            && (read(tube[0], &configuration, sizeof(Configuration)) == sizeof(Configuration))) {
+        configurations[recues++] = configuration;
+    }
+    close(tube[0]);
+    for (n = 0; n < processus; n++) {
+        int statut;
+        wait(&statut);
+        if (!WIFEXITED(statut) || (WEXITSTATUS(statut) != 0)) {
+            erreurs++;
+        }
+    }
+    if (recues < total) {
+        fprintf(stderr, "seulement %lu configurations sur %lu\n", recues, total);
+        erreurs++;
+    }
+
+    qsort(configurations, recues, sizeof(Configuration), compareCouts);
+    if (json) {
+        afficheJson(configurations, recues);
+    } else {
+        afficheCsv(configurations, recues);
+    }
+    free(configurations);
+    return erreurs;
+}
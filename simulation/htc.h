@@ -0,0 +1,7 @@
+/*
+ * File:   htc.h
+ * Auteur: jmgonet
+ *
+ * Remplace l'en-tête du compilateur pour compiler sur la machine hôte.
+ */
+#include "xc.h"
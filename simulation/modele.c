@@ -0,0 +1,197 @@
+/*
+ * File:   modele.c
+ * Auteur: jmgonet
+ *
+ * Modèle physique du moteur sans balais, de la batterie et de la voiture.
+ *
+ * Le moteur est modélisé par ses deux phases alimentées: une résistance,
+ * une inductance et une force contre électromotrice trapézoïdale. Le
+ * rapport cyclique du transistor haut s'applique à la tension de la
+ * batterie (modèle moyen, avec redressement synchrone). La voiture
+ * ajoute son inertie, ramenée à l'axe du moteur par le rapport de
+ * réduction, et sa résistance au roulement.
+ */
+#include <math.h>
+#include "modele.h"
+
+#define PI 3.14159265358979
+#define GRAVITE 9.81
+
+/** Angle électrique d'un secteur (une phase du micrologiciel). */
+#define SECTEUR (PI / 3)
+
+/**
+ * Secteur où commence le plateau positif de la force contre
+ * électromotrice, pour les phases A, B et C.
+ */
+static const double debutPlateau[3] = {1, 3, 5};
+
+/**
+ * Code des senseurs hall pour chaque secteur.
+ * C'est la réciproque de phaseParHall, dans moteur.c.
+ */
+static const unsigned char hallParSecteur[6] = {1, 3, 2, 6, 4, 5};
+
+/**
+ * Établit des paramètres proches d'une voiture 1:10 avec un moteur
+ * de 13.5 tours et une batterie LiPo 2S.
+ * @param parametres Les paramètres à initialiser.
+ */
+void modeleParametresParDefaut(ParametresModele *parametres) {
+    parametres->tensionBatterie = 7.8;
+    parametres->resistanceBatterie = 0.02;
+    parametres->resistance = 0.04;
+    parametres->inductance = 20e-6;
+    parametres->constanteMoteur = 1 / 230.4;
+    parametres->pairesDePoles = 1;
+    parametres->inertieMoteur = 5e-6;
+    parametres->frottementVisqueux = 1e-6;
+    parametres->coefficientRoulement = 0.02;
+    parametres->rapportDeReduction = 6.0;
+    parametres->rayonRoue = 0.032;
+    parametres->masse = 1.5;
+}
+
+/**
+ * Met le modèle à l'arrêt, batterie chargée.
+ * @param etat L'état à initialiser.
+ * @param parametres Les paramètres du modèle.
+ */
+void modeleInitialise(EtatModele *etat, const ParametresModele *parametres) {
+    etat->courant = 0;
+    etat->vitesse = 0;
+    etat->angle = SECTEUR / 2;
+    etat->phases = 0;
+    etat->tensionBatterie = parametres->tensionBatterie;
+    etat->courantBatterie = 0;
+    etat->energie = 0;
+
+    etat->inertie = parametres->inertieMoteur + parametres->masse
+            * pow(parametres->rayonRoue / parametres->rapportDeReduction, 2);
+    etat->roulement = parametres->coefficientRoulement * parametres->masse
+            * GRAVITE * parametres->rayonRoue / parametres->rapportDeReduction;
+    etat->dt = 0;
+}
+
+/**
+ * Forme normalisée de la force contre électromotrice d'une phase.
+ * @param angle Angle électrique du rotor.
+ * @param phase 0, 1 ou 2 pour les phases A, B et C.
+ * @return Entre -1 et +1.
+ */
+static double trapeze(double angle, int phase) {
+    double x = angle / SECTEUR - debutPlateau[phase];
+
+    if (x < 0) {
+        x += 6;
+    }
+    if (x < 2) {
+        return 1;
+    }
+    if (x < 3) {
+        return 1 - 2 * (x - 2);
+    }
+    if (x < 5) {
+        return -1;
+    }
+    return -1 + 2 * (x - 5);
+}
+
+/**
+ * Avance le modèle physique.
+ * @param etat État du modèle.
+ * @param parametres Paramètres du modèle.
+ * @param commutation Tensions appliquées aux phases.
+ * @param dt Durée de l'intervalle, en secondes.
+ */
+void modeleAvance(EtatModele *etat, const ParametresModele *parametres,
+                  const Commutation *commutation, double dt) {
+    int n, haut = -1, bas = -1;
+    double rapportCyclique = 0;
+    double constante = 0;
+    double tension, courantDeRegime;
+    double couple, acceleration, vitesse;
+
+    if (dt != etat->dt) {
+        etat->dt = dt;
+        etat->amortissement = exp(- dt * parametres->resistance / parametres->inductance);
+    }
+
+    for (n = 0; n < 3; n++) {
+        if (commutation->bas[n]) {
+            bas = n;
+        } else if (commutation->haut[n] > 0) {
+            haut = n;
+        }
+    }
+
+    // Partie électrique:
+    etat->tensionBatterie = parametres->tensionBatterie
+            - parametres->resistanceBatterie * etat->courantBatterie;
+    if ((haut < 0) || (bas < 0)) {
+        // Aucun circuit fermé: le courant s'éteint à travers les diodes.
+        etat->courant = 0;
+    } else {
+        rapportCyclique = commutation->haut[haut] / 255.0;
+        constante = parametres->constanteMoteur
+                * (trapeze(etat->angle, haut) - trapeze(etat->angle, bas)) / 2;
+        tension = rapportCyclique * etat->tensionBatterie
+                - constante * etat->vitesse;
+        courantDeRegime = tension / parametres->resistance;
+        etat->courant = courantDeRegime
+                + (etat->courant - courantDeRegime) * etat->amortissement;
+    }
+    etat->courantBatterie = rapportCyclique * etat->courant;
+    etat->energie += etat->tensionBatterie * etat->courantBatterie * dt;
+
+    // Partie mécanique, ramenée à l'axe du moteur:
+    couple = constante * etat->courant
+            - parametres->frottementVisqueux * etat->vitesse;
+    if (etat->vitesse > 0) {
+        couple -= etat->roulement;
+    } else if (etat->vitesse < 0) {
+        couple += etat->roulement;
+    } else if (fabs(couple) <= etat->roulement) {
+        couple = 0;
+    }
+    acceleration = couple / etat->inertie;
+    vitesse = etat->vitesse + acceleration * dt;
+
+    // Le roulement freine, mais n'inverse pas le mouvement:
+    if ((etat->vitesse != 0) && (vitesse * etat->vitesse < 0)
+            && (fabs(constante * etat->courant) <= etat->roulement)) {
+        vitesse = 0;
+    }
+
+    etat->angle += (etat->vitesse + vitesse) / 2 * parametres->pairesDePoles * dt;
+    etat->phases += (etat->vitesse + vitesse) / 2 * parametres->pairesDePoles * dt / SECTEUR;
+    if (etat->angle >= 2 * PI) {
+        etat->angle -= 2 * PI;
+    } else if (etat->angle < 0) {
+        etat->angle += 2 * PI;
+    }
+    etat->vitesse = vitesse;
+}
+
+/**
+ * Calcule la valeur des senseurs hall.
+ * @param etat État du modèle.
+ * @return La valeur des senseurs hall: 0b*****ZYX
+ */
+unsigned char modeleHall(const EtatModele *etat) {
+    int secteur = (int) (etat->angle / SECTEUR);
+    if (secteur > 5) {
+        secteur = 5;
+    }
+    return hallParSecteur[secteur];
+}
+
+/**
+ * Calcule la vitesse de la voiture.
+ * @param etat État du modèle.
+ * @param parametres Paramètres du modèle.
+ * @return La vitesse, en m/s.
+ */
+double modeleVitesseVoiture(const EtatModele *etat, const ParametresModele *parametres) {
+    return etat->vitesse / parametres->rapportDeReduction * parametres->rayonRoue;
+}
@@ -0,0 +1,87 @@
+/*
+ * File:   modele.h
+ * Auteur: jmgonet
+ *
+ * Modèle physique du moteur sans balais, de la batterie et de la voiture.
+ */
+#ifndef __MODELE_H
+#define __MODELE_H
+
+/**
+ * Paramètres du modèle physique.
+ */
+typedef struct {
+    /** Tension de la batterie à vide, en V. */
+    double tensionBatterie;
+    /** Résistance interne de la batterie, en Ohm. */
+    double resistanceBatterie;
+    /** Résistance des bobines, entre deux phases, en Ohm. */
+    double resistance;
+    /** Inductance des bobines, entre deux phases, en H. */
+    double inductance;
+    /** Constante du moteur, entre deux phases, en V.s/rad (ou N.m/A). */
+    double constanteMoteur;
+    /** Nombre de paires de pôles du moteur. */
+    int pairesDePoles;
+    /** Inertie du rotor, en kg.m². */
+    double inertieMoteur;
+    /** Frottement visqueux, ramené à l'axe du moteur, en N.m.s/rad. */
+    double frottementVisqueux;
+    /** Résistance au roulement de la voiture (sans unités). */
+    double coefficientRoulement;
+    /** Nombre de tours du moteur pour un tour de roue. */
+    double rapportDeReduction;
+    /** Rayon des roues, en m. */
+    double rayonRoue;
+    /** Masse de la voiture, en kg. */
+    double masse;
+} ParametresModele;
+
+/**
+ * État du modèle physique.
+ */
+typedef struct {
+    /** Courant dans les deux phases alimentées, en A. */
+    double courant;
+    /** Vitesse angulaire du rotor, en rad/s. */
+    double vitesse;
+    /** Angle électrique du rotor, entre 0 et 2.PI. */
+    double angle;
+    /** Déplacement cumulé du rotor, en phases. */
+    double phases;
+    /** Tension aux bornes de la batterie, en V. */
+    double tensionBatterie;
+    /** Courant consommé de la batterie, en A. */
+    double courantBatterie;
+    /** Énergie consommée de la batterie, en J. */
+    double energie;
+
+    /** Inertie de la voiture ramenée à l'axe du moteur, en kg.m². */
+    double inertie;
+    /** Couple de résistance au roulement, ramené à l'axe du moteur, en N.m. */
+    double roulement;
+    /** Durée du dernier pas de simulation, en secondes. */
+    double dt;
+    /** Décroissance du courant pendant un pas de simulation. */
+    double amortissement;
+} EtatModele;
+
+/**
+ * Tensions appliquées aux trois phases du moteur, telles que
+ * le micrologiciel les a établies dans les registres.
+ */
+typedef struct {
+    /** Rapport cyclique des transistors hauts, entre 0 et 255. */
+    unsigned char haut[3];
+    /** État des transistors bas, 0 ou 1. */
+    unsigned char bas[3];
+} Commutation;
+
+void modeleParametresParDefaut(ParametresModele *parametres);
+void modeleInitialise(EtatModele *etat, const ParametresModele *parametres);
+void modeleAvance(EtatModele *etat, const ParametresModele *parametres,
+                  const Commutation *commutation, double dt);
+unsigned char modeleHall(const EtatModele *etat);
+double modeleVitesseVoiture(const EtatModele *etat, const ParametresModele *parametres);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * File:   registres.c
+ * Auteur: jmgonet
+ *
+ * Registres du micro contrôleur, simulés par des variables.
+ */
+#include <xc.h>
+
+volatile unsigned char CCPR1L;
+volatile unsigned char CCPR2L;
+volatile unsigned char CCPR3L;
+volatile PORTCbits_t PORTCbits;
+
+volatile unsigned char SSP2BUF;
+volatile SSP2CON1bits_t SSP2CON1bits;
+volatile SSP2CON2bits_t SSP2CON2bits;
+volatile SSP2STATbits_t SSP2STATbits;
+volatile unsigned char SSP2ADD;
+volatile PIE3bits_t PIE3bits;
+volatile PIE1bits_t PIE1bits;
@@ -0,0 +1,43 @@
+/*
+ * File:   scenarios.c
+ * Auteur: jmgonet
+ *
+ * Liste des scénarios de référence.
+ */
+#include <string.h>
+
+#include "domaine.h"
+#include "scenarios.h"
+
+/**
+ * Liste des scénarios.
+ * Le modèle physique est établi par défaut avant de simuler.
+ */
+Scenario scenarios[] = {
+    // Nom                         Type                  Valeur         Dépl.        Durée
+    {"vitesse-lente",              SCENARIO_VITESSE,     NEUTRE + 20,   0,           3.0},
+    {"vitesse-moyenne",            SCENARIO_VITESSE,     NEUTRE + 50,   0,           3.0},
+    {"vitesse-arriere",            SCENARIO_VITESSE,     NEUTRE - 50,   0,           3.0},
+    {"deplacement-court",          SCENARIO_DEPLACEMENT, NEUTRE + 10,   0,           2.0},
+    {"deplacement-long",           SCENARIO_DEPLACEMENT, NEUTRE + 100,  0,           3.0},
+    {"deplacement-arriere",        SCENARIO_DEPLACEMENT, NEUTRE - 50,   0,           2.0},
+    {"manoeuvre-avance",           SCENARIO_MANOEUVRE,   0,             NEUTRE + 95, 3.0},
+};
+
+const unsigned int nombreDeScenarios = sizeof(scenarios) / sizeof(Scenario);
+
+/**
+ * Cherche un scénario par son nom.
+ * @param nom Le nom du scénario.
+ * @return Le scénario, ou 0 s'il n'existe pas.
+ */
+Scenario *chercheScenario(const char *nom) {
+    unsigned int n;
+
+    for (n = 0; n < nombreDeScenarios; n++) {
+        if (strcmp(nom, scenarios[n].nom) == 0) {
+            return &scenarios[n];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*
+ * File:   scenarios.h
+ * Auteur: jmgonet
+ *
+ * Liste des scénarios de référence, partagée par le rapport de
+ * simulation et par le balayage des paramètres.
+ */
+#ifndef __SCENARIOS_H
+#define __SCENARIOS_H
+
+#include "simulateur.h"
+
+extern Scenario scenarios[];
+extern const unsigned int nombreDeScenarios;
+
+Scenario *chercheScenario(const char *nom);
+
+#endif
@@ -0,0 +1,430 @@
+/*
+ * File:   simulateur.c
+ * Auteur: jmgonet
+ *
+ * Simulation en boucle fermée du micrologiciel et du modèle physique.
+ *
+ * Le simulateur remplace main.c: à chaque période du PWM, il reproduit
+ * les interruptions de basse priorité (conversions A/D, base de temps,
+ * senseurs hall), puis traite la file d'événements avec les machines
+ * à états réelles. Le modèle physique avance ensuite selon les registres
+ * de PWM établis par le micrologiciel.
+ */
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <xc.h>
+
+#include "domaine.h"
+#include "evenements.h"
+#include "tableauDeBord.h"
+#include "moteur.h"
+#include "puissance.h"
+#include "direction.h"
+#include "profil.h"
+#include "i2c.h"
+#include "sequenceur.h"
+#include "simulateur.h"
+
+// Mêmes valeurs que dans main.c:
+#define VITESSE_BASE_DE_TEMPS 2656
+#define DEPLACEMENT_DUREE_SOUS_DIVISIONS 10
+#define DEPLACEMENT_NOMBRE_SOUS_DIVISIONS 255
+
+/** Période du PWM moteur (TMR2), en secondes: 64MHz / (4 * 4 * 256). */
+#define PERIODE_PWM (4.0 * 4 * 256 / 64e6)
+
+/** Nombre de pas du modèle physique par période du PWM. */
+#define SOUS_PAS 1
+
+/** Angle électrique d'une phase. */
+#define SECTEUR (3.14159265358979 / 3)
+
+/** Bande de tolérance pour le temps d'établissement de la vitesse. */
+#define TOLERANCE_VITESSE 0.05
+
+/** Lecture du capteur de température, à environ 25°C. */
+#define LECTURE_TEMPERATURE_AMBIANTE 153
+
+/** Courant correspondant à une lecture de LECTURE_AD_MAX, en Ampères. */
+#define COURANT_MAX 100
+
+/**
+ * État des interruptions simulées.
+ * Reproduit les variables statiques des interruptions de main.c.
+ */
+typedef struct {
+    unsigned char hall0;
+    int tempsMesureVitesse;
+    int tempsProfil;
+    unsigned char deplacementDureeSousDivision;
+    unsigned char nombreSousDivisionsDeTemps;
+    unsigned char tempsDeDeplacement;
+    unsigned long basesDeTemps;
+    int baseDeTempsVitesse;
+    int baseDeTempsProfil;
+} Interruptions;
+
+/**
+ * Mesure de la réponse, au fur et à mesure de la simulation.
+ */
+typedef struct {
+    double consigne;
+    double tolerance;
+    double tempsCommande;
+    double temps10;
+    double temps90;
+    double maximum;
+    double dernierTempsHorsTolerance;
+    double derniereReponse;
+    double energieInitiale;
+    double itae;
+} Mesure;
+
+static Interruptions interruptions;
+static EtatModele etat;
+
+/**
+ * Établit les réglages du micrologiciel tels qu'ils sont compilés.
+ * @param reglages Les réglages à initialiser.
+ */
+void reglagesParDefaut(Reglages *reglages) {
+    parametresRegulateursParDefaut(&reglages->regulateurs);
+    reglages->baseDeTempsVitesse = VITESSE_BASE_DE_TEMPS;
+    reglages->baseDeTempsProfil = PROFIL_DUREE_BASE_DE_TEMPS;
+}
+
+/**
+ * Prépare l'état des interruptions simulées.
+ * @param reglages Réglages des bases de temps.
+ */
+static void initialiseInterruptions(const Reglages *reglages) {
+    interruptions.hall0 = 0;
+    interruptions.baseDeTempsVitesse = reglages->baseDeTempsVitesse;
+    interruptions.baseDeTempsProfil = reglages->baseDeTempsProfil;
+    interruptions.tempsMesureVitesse = reglages->baseDeTempsVitesse;
+    interruptions.tempsProfil = reglages->baseDeTempsProfil;
+    interruptions.deplacementDureeSousDivision = DEPLACEMENT_DUREE_SOUS_DIVISIONS;
+    interruptions.nombreSousDivisionsDeTemps = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
+    interruptions.tempsDeDeplacement = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
+    sequenceurInitialise();
+    interruptions.basesDeTemps = 0;
+}
+
+/**
+ * Convertit une tension ou un courant en lecture du convertisseur A/D.
+ */
+static unsigned int lectureAD(double valeur, double valeurMax) {
+    valeur = LECTURE_AD_MAX * valeur / valeurMax;
+    if (valeur < 0) {
+        return 0;
+    }
+    if (valeur > LECTURE_AD_MAX) {
+        return LECTURE_AD_MAX;
+    }
+    return (unsigned int) valeur;
+}
+
+/**
+ * Lit le canal analogique indiqué, selon l'état du modèle.
+ */
+static unsigned int lectureCanal(unsigned char canal) {
+    switch (canal) {
+        case 8:
+            return lectureAD(fabs(etat.courant), COURANT_MAX);
+        case 11:
+            return lectureAD(etat.tensionBatterie / 2, 5);
+        case 13:
+            return LECTURE_TEMPERATURE_AMBIANTE;
+        default:
+            return (LECTURE_AD_MAX + 1) / 2;
+    }
+}
+
+/**
+ * Reproduit les conversions A/D d'une période du PWM: la lecture de 
+ * courant synchronisée, puis la conversion enchaînée.
+ */
+static void conversionsAD() {
+    DemarrageAD demarrage;
+    unsigned char demarre;
+
+    demarre = sequenceurPeriodePwm(tableauDeBord.rapportCyclique,
+                                   tableauDeBord.phaseCommutee,
+                                   &demarrage);
+    while (demarre) {
+        demarre = sequenceurConversionTerminee(
+                lectureCanal(demarrage.canal), &demarrage);
+    }
+}
+
+/**
+ * Reproduit l'interruption de TMR2: bases de temps et senseurs hall.
+ */
+static void interruptionMoteur() {
+    unsigned char hall;
+
+    if (-- interruptions.tempsMesureVitesse == 0) {
+        enfileEvenement(BASE_DE_TEMPS, 0);
+        interruptions.tempsMesureVitesse = interruptions.baseDeTempsVitesse;
+        interruptions.basesDeTemps++;
+    }
+
+    // La télécommande n'est pas simulée: la surveillance de son signal
+    // (verifieSignalTelecommande) est omise, sinon la sécurité
+    // ramènerait les commandes au neutre.
+    if (-- interruptions.tempsProfil == 0) {
+        enfileEvenement(BASE_DE_TEMPS_PROFIL, 0);
+        interruptions.tempsProfil = interruptions.baseDeTempsProfil;
+    }
+
+    if (-- interruptions.deplacementDureeSousDivision == 0) {
+        interruptions.deplacementDureeSousDivision = DEPLACEMENT_DUREE_SOUS_DIVISIONS;
+        if (interruptions.tempsDeDeplacement > 0) {
+            interruptions.tempsDeDeplacement--;
+        }
+        interruptions.nombreSousDivisionsDeTemps --;
+        if (interruptions.nombreSousDivisionsDeTemps == 0) {
+            enfileEvenement(DEPLACEMENT_ARRETE, 0);
+            interruptions.nombreSousDivisionsDeTemps = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
+        }
+    }
+
+    hall = modeleHall(&etat);
+    if (hall != interruptions.hall0) {
+        tableauDeBord.tempsDeDeplacement = interruptions.tempsDeDeplacement;
+        interruptions.nombreSousDivisionsDeTemps = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
+        interruptions.tempsDeDeplacement = DEPLACEMENT_NOMBRE_SOUS_DIVISIONS;
+        enfileEvenement(MOTEUR_PHASE, hall);
+        interruptions.hall0 = hall;
+    }
+}
+
+/**
+ * Reproduit la boucle principale de main.c, jusqu'à vider la file.
+ */
+static void traiteEvenements() {
+    EvenementEtValeur *ev;
+
+    ev = defileEvenement();
+    if (ev == 0) {
+        ev = defileMessageInterne();
+    }
+    while (ev != 0) {
+        do {
+            MOTEUR_machine(ev);
+            PUISSANCE_machine(ev);
+            DIRECTION_machine(ev);
+            SEQUENCEUR_machine(ev);
+            ev = defileMessageInterne();
+        } while (ev != 0);
+        ev = defileEvenement();
+    }
+}
+
+/**
+ * Simule une période du PWM.
+ * @param parametres Paramètres du modèle physique.
+ * @return 0 tant que la file d'événements n'a pas débordé.
+ */
+static unsigned char simulePeriode(const ParametresModele *parametres) {
+    Commutation commutation;
+    int n;
+
+    conversionsAD();
+    interruptionMoteur();
+    if (fileDeborde()) {
+        return 1;
+    }
+    traiteEvenements();
+
+    commutation.haut[0] = CCPR1L;
+    commutation.bas[0] = PORTCbits.RC3;
+    commutation.haut[1] = CCPR2L;
+    commutation.bas[1] = PORTCbits.RC0;
+    commutation.haut[2] = CCPR3L;
+    commutation.bas[2] = PORTCbits.RC7;
+    for (n = 0; n < SOUS_PAS; n++) {
+        modeleAvance(&etat, parametres, &commutation, PERIODE_PWM / SOUS_PAS);
+    }
+    return 0;
+}
+
+/**
+ * Calcule la réponse du système, relative à la consigne.
+ * @param scenario Le scénario.
+ * @param phasesInitiales Déplacement du rotor au moment de la commande.
+ * @return 1 lorsque la consigne est atteinte.
+ */
+static double reponse(const Scenario *scenario, Mesure *mesure, double phasesInitiales) {
+    if (scenario->type == SCENARIO_VITESSE) {
+        return etat.vitesse / mesure->consigne;
+    }
+    return (etat.phases - phasesInitiales) / mesure->consigne;
+}
+
+/**
+ * Établit la consigne et la tolérance correspondant au scénario.
+ */
+static void prepareMesure(const Scenario *scenario, Mesure *mesure) {
+    MagnitudeEtDirection commande;
+
+    if (scenario->type == SCENARIO_VITESSE) {
+        convertitEnMagnitudeEtDirection(scenario->valeur, &commande);
+        mesure->consigne = commande.magnitude * SECTEUR
+                / scenario->modele.pairesDePoles
+                / (interruptions.baseDeTempsVitesse * PERIODE_PWM);
+        mesure->tolerance = TOLERANCE_VITESSE;
+    } else {
+        if (scenario->type == SCENARIO_MANOEUVRE) {
+            convertitEnMagnitudeEtDirection(scenario->deplacement, &commande);
+        } else {
+            convertitEnMagnitudeEtDirection(scenario->valeur, &commande);
+        }
+        mesure->consigne = commande.magnitude;
+        mesure->tolerance = 1.0 / commande.magnitude;
+    }
+    if (commande.direction == ARRIERE) {
+        mesure->consigne = -mesure->consigne;
+    }
+}
+
+/**
+ * Simule le scénario indiqué, dans le processus courant.
+ * L'état du micrologiciel n'est pas réinitialisé: pour simuler
+ * plusieurs scénarios, utiliser {@link simuleScenarioIsole}.
+ * @param scenario Le scénario à simuler.
+ * @param reglages Les réglages du micrologiciel.
+ * @param resultats Les mesures de la réponse.
+ */
+void simuleScenario(const Scenario *scenario, const Reglages *reglages,
+                    Resultats *resultats) {
+    Mesure mesure;
+    unsigned long periode = 0;
+    unsigned long periodes;
+    double temps, y, phasesInitiales;
+
+    resultats->debordement = 0;
+    initialiseInterruptions(reglages);
+    etablitParametresRegulateurs(&reglages->regulateurs);
+    modeleInitialise(&etat, &scenario->modele);
+    initialiseEvenements();
+    initialiseTableauDeBord();
+    initialiseDirection();
+    i2cRappelCommande(receptionBus);
+
+    // Les manoeuvres ne sont acceptées qu'en mode bus de commandes:
+    if (scenario->type == SCENARIO_MANOEUVRE) {
+        while ((interruptions.basesDeTemps == 0)
+                || (i2cRegistres.valeurs[LECTURE_I2C_INACTIVITE_TELECOMMANDE] > 0)) {
+            if (simulePeriode(&scenario->modele)) {
+                resultats->debordement = 1;
+                break;
+            }
+            periode++;
+        }
+    }
+
+    // Envoie la commande:
+    switch (scenario->type) {
+        case SCENARIO_VITESSE:
+            enfileEvenement(VITESSE_DEMANDEE, CONSIGNE(scenario->valeur));
+            break;
+        case SCENARIO_DEPLACEMENT:
+            enfileEvenement(DEPLACEMENT_DEMANDE, scenario->valeur);
+            break;
+        case SCENARIO_MANOEUVRE:
+            receptionBus(ECRITURE_I2C_MANOEUVRE, scenario->valeur);
+            break;
+    }
+    prepareMesure(scenario, &mesure);
+    mesure.tempsCommande = periode * PERIODE_PWM;
+    mesure.temps10 = -1;
+    mesure.temps90 = -1;
+    mesure.maximum = 0;
+    mesure.dernierTempsHorsTolerance = 0;
+    mesure.derniereReponse = 0;
+    mesure.energieInitiale = etat.energie;
+    mesure.itae = 0;
+    phasesInitiales = etat.phases;
+
+    // Simule la réponse:
+    periodes = periode + (unsigned long) (scenario->duree / PERIODE_PWM);
+    while (!resultats->debordement && (periode < periodes)) {
+        if (simulePeriode(&scenario->modele)) {
+            resultats->debordement = 1;
+        }
+        periode++;
+        temps = periode * PERIODE_PWM - mesure.tempsCommande;
+        y = reponse(scenario, &mesure, phasesInitiales);
+        if ((mesure.temps10 < 0) && (y >= 0.1)) {
+            mesure.temps10 = temps;
+        }
+        if ((mesure.temps90 < 0) && (y >= 0.9)) {
+            mesure.temps90 = temps;
+        }
+        if (y > mesure.maximum) {
+            mesure.maximum = y;
+        }
+        if (fabs(y - 1) > mesure.tolerance) {
+            mesure.dernierTempsHorsTolerance = temps;
+        }
+        mesure.derniereReponse = y;
+        mesure.itae += temps * fabs(y - 1) * PERIODE_PWM;
+    }
+
+    // Résultats:
+    if ((mesure.temps10 < 0) || (mesure.temps90 < 0)) {
+        resultats->tempsDeMontee = -1;
+    } else {
+        resultats->tempsDeMontee = mesure.temps90 - mesure.temps10;
+    }
+    resultats->depassement = mesure.maximum > 1 ? (mesure.maximum - 1) * 100 : 0;
+    if (mesure.dernierTempsHorsTolerance >= scenario->duree - PERIODE_PWM) {
+        resultats->tempsDEtablissement = -1;
+    } else {
+        resultats->tempsDEtablissement = mesure.dernierTempsHorsTolerance;
+    }
+    resultats->erreurFinale = (mesure.derniereReponse - 1) * 100;
+    resultats->itae = mesure.itae;
+    resultats->energie = etat.energie - mesure.energieInitiale;
+    resultats->tempsSimule = periode * PERIODE_PWM;
+}
+
+/**
+ * Simule le scénario indiqué dans un processus séparé, pour que
+ * l'état du micrologiciel (variables globales et statiques) soit
+ * neuf à chaque scénario.
+ * @param scenario Le scénario à simuler.
+ * @param reglages Les réglages du micrologiciel.
+ * @param resultats Les mesures de la réponse.
+ * @return 0 si la simulation s'est bien déroulée.
+ */
+int simuleScenarioIsole(const Scenario *scenario, const Reglages *reglages,
+                        Resultats *resultats) {
+    int tube[2];
+    pid_t pid;
+    ssize_t lus;
+
+    if (pipe(tube) != 0) {
+        return -1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        close(tube[0]);
+        close(tube[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(tube[0]);
+        simuleScenario(scenario, reglages, resultats);
+        lus = write(tube[1], resultats, sizeof(Resultats));
+        close(tube[1]);
+        _exit(lus == sizeof(Resultats) ? 0 : 1);
+    }
+    close(tube[1]);
+    lus = read(tube[0], resultats, sizeof(Resultats));
+    close(tube[0]);
+    waitpid(pid, 0, 0);
+    return lus == sizeof(Resultats) ? 0 : -1;
+}
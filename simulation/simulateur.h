@@ -0,0 +1,93 @@
+/*
+ * File:   simulateur.h
+ * Auteur: jmgonet
+ *
+ * Simulation en boucle fermée du micrologiciel et du modèle physique.
+ */
+#ifndef __SIMULATEUR_H
+#define __SIMULATEUR_H
+
+#include "modele.h"
+#include "puissance.h"
+
+/**
+ * Types de scénarios.
+ */
+typedef enum {
+    /** Commande VITESSE_DEMANDEE; la réponse est la vitesse du rotor. */
+    SCENARIO_VITESSE,
+    /** Commande DEPLACEMENT_DEMANDE; la réponse est le déplacement. */
+    SCENARIO_DEPLACEMENT,
+    /**
+     * Manoeuvre reçue par le bus I2C, une fois que la télécommande
+     * est inactive; la réponse est le déplacement.
+     */
+    SCENARIO_MANOEUVRE
+} TypeScenario;
+
+/**
+ * Décrit un scénario de simulation.
+ */
+typedef struct {
+    /** Nom du scénario, pour le rapport. */
+    const char *nom;
+    /** Type de scénario. */
+    TypeScenario type;
+    /** Valeur de la commande (vitesse, déplacement ou numéro de manoeuvre). */
+    unsigned char valeur;
+    /**
+     * Pour les manoeuvres, le déplacement attendu, exprimé comme
+     * la valeur de DEPLACEMENT_DEMANDE.
+     */
+    unsigned char deplacement;
+    /** Durée simulée après la commande, en secondes. */
+    double duree;
+    /** Paramètres du modèle physique. */
+    ParametresModele modele;
+} Scenario;
+
+/**
+ * Réglages du micrologiciel à simuler.
+ */
+typedef struct {
+    /** Paramètres des régulateurs de puissance.c. */
+    ParametresRegulateurs regulateurs;
+    /** Nombre de périodes du PWM par BASE_DE_TEMPS (mesure de vitesse). */
+    int baseDeTempsVitesse;
+    /** Nombre de périodes du PWM par BASE_DE_TEMPS_PROFIL. */
+    int baseDeTempsProfil;
+} Reglages;
+
+/**
+ * Mesures de la réponse à la commande. Les temps sont comptés depuis
+ * la commande, et valent -1 si la réponse n'y arrive pas.
+ */
+typedef struct {
+    /** Temps pour passer de 10% à 90% de la consigne, en secondes. */
+    double tempsDeMontee;
+    /** Dépassement maximum de la consigne, en %. */
+    double depassement;
+    /** Temps pour rester dans la bande de tolérance, en secondes. */
+    double tempsDEtablissement;
+    /** Écart final par rapport à la consigne, en %. */
+    double erreurFinale;
+    /**
+     * Intégrale du temps multiplié par l'erreur absolue (ITAE), avec
+     * l'erreur relative à la consigne, en secondes².
+     */
+    double itae;
+    /** Énergie consommée de la batterie, en J. */
+    double energie;
+    /** Durée totale simulée, en secondes. */
+    double tempsSimule;
+    /** 1 si la file d'événements du micrologiciel a débordé. */
+    unsigned char debordement;
+} Resultats;
+
+void reglagesParDefaut(Reglages *reglages);
+void simuleScenario(const Scenario *scenario, const Reglages *reglages,
+                    Resultats *resultats);
+int simuleScenarioIsole(const Scenario *scenario, const Reglages *reglages,
+                        Resultats *resultats);
+
+#endif
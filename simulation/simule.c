@@ -0,0 +1,75 @@
+/*
+ * File:   simule.c
+ * Auteur: jmgonet
+ *
+ * Point d'entrée du simulateur: simule les scénarios de référence
+ * avec les réglages du micrologiciel, et affiche les mesures de chacun.
+ *
+ *      ./simulateur [scenario]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "scenarios.h"
+
+/**
+ * Affiche un temps en millisecondes, ou un tiret s'il n'est pas défini.
+ */
+static void afficheTemps(double temps) {
+    if (temps < 0) {
+        printf(" %9s", "-");
+    } else {
+        printf(" %9.1f", temps * 1000);
+    }
+}
+
+static double secondes() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    Reglages reglages;
+    Resultats resultats;
+    double debut, duree, tempsSimule = 0;
+    unsigned int n;
+    int erreurs = 0;
+
+    reglagesParDefaut(&reglages);
+    printf("%-22s %9s %9s %9s %9s %9s %9s\n",
+            "scenario", "montee", "depas.", "etabl.", "erreur", "itae", "energie");
+    printf("%-22s %9s %9s %9s %9s %9s %9s\n",
+            "", "ms", "%", "ms", "%", "s2", "J");
+
+    debut = secondes();
+    for (n = 0; n < nombreDeScenarios; n++) {
+        if ((argc > 1) && (strcmp(argv[1], scenarios[n].nom) != 0)) {
+            continue;
+        }
+        modeleParametresParDefaut(&scenarios[n].modele);
+        if (simuleScenarioIsole(&scenarios[n], &reglages, &resultats) != 0) {
+            printf("%-22s erreur de simulation\n", scenarios[n].nom);
+            erreurs++;
+            continue;
+        }
+        if (resultats.debordement) {
+            printf("%-22s debordement de la file d'evenements\n", scenarios[n].nom);
+            erreurs++;
+            continue;
+        }
+        printf("%-22s", scenarios[n].nom);
+        afficheTemps(resultats.tempsDeMontee);
+        printf(" %9.1f", resultats.depassement);
+        afficheTemps(resultats.tempsDEtablissement);
+        printf(" %9.1f %9.4f %9.2f\n", 
+                resultats.erreurFinale, resultats.itae, resultats.energie);
+        tempsSimule += resultats.tempsSimule;
+    }
+    duree = secondes() - debut;
+
+    printf("\n%.1f s simulees en %.3f s (%.0f fois le temps reel)\n",
+            tempsSimule, duree, duree > 0 ? tempsSimule / duree : 0);
+    return erreurs;
+}
@@ -0,0 +1,68 @@
+/*
+ * File:   xc.h
+ * Auteur: jmgonet
+ *
+ * Remplace l'en-tête du compilateur XC8 pour compiler le micrologiciel
+ * sur la machine hôte. Seuls les registres utilisés par les modules
+ * simulés sont déclarés. Le simulateur lit les registres de PWM pour 
+ * connaître les tensions appliquées au moteur.
+ */
+#ifndef __SIMULATION_XC_H
+#define __SIMULATION_XC_H
+
+typedef struct {
+    unsigned RC0:1;
+    unsigned RC1:1;
+    unsigned RC2:1;
+    unsigned RC3:1;
+    unsigned RC4:1;
+    unsigned RC5:1;
+    unsigned RC6:1;
+    unsigned RC7:1;
+} PORTCbits_t;
+
+typedef struct {
+    unsigned SSPM:4;
+    unsigned CKP:1;
+    unsigned CKP2:1;
+    unsigned SSPEN:1;
+} SSP2CON1bits_t;
+
+typedef struct {
+    unsigned SEN:1;
+    unsigned RSEN:1;
+    unsigned PEN:1;
+    unsigned RCEN:1;
+    unsigned ACKEN:1;
+    unsigned ACKDT:1;
+} SSP2CON2bits_t;
+
+typedef struct {
+    unsigned BF:1;
+    unsigned DA2:1;
+    unsigned RW2:1;
+    unsigned S:1;
+} SSP2STATbits_t;
+
+typedef struct {
+    unsigned SSP2IE:1;
+} PIE3bits_t;
+
+typedef struct {
+    unsigned ADIE:1;
+} PIE1bits_t;
+
+extern volatile unsigned char CCPR1L;
+extern volatile unsigned char CCPR2L;
+extern volatile unsigned char CCPR3L;
+extern volatile PORTCbits_t PORTCbits;
+
+extern volatile unsigned char SSP2BUF;
+extern volatile SSP2CON1bits_t SSP2CON1bits;
+extern volatile SSP2CON2bits_t SSP2CON2bits;
+extern volatile SSP2STATbits_t SSP2STATbits;
+extern volatile unsigned char SSP2ADD;
+extern volatile PIE3bits_t PIE3bits;
+extern volatile PIE1bits_t PIE1bits;
+
+#endif
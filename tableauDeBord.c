@@ -3,6 +3,18 @@
 #include "tableauDeBord.h"
 #include "test.h"
 
+/** Le tableau de bord est une variable globale. */
+TableauDeBord tableauDeBord = {
+    {AVANT, 0},              // Vitesse mesurée.
+    {AVANT, 0},              // Vitesse demandée.
+    {AVANT, 0},              // Déplacement mesuré.
+    {AVANT, 0},              // Déplacement demandé.
+    {AVANT, 0},              // Tension moyenne à appliquer.
+    0,                       // Temps depuis le changement de phase.
+    0,                       // Phase commutée.
+    0                        // Rapport cyclique.
+};
+
 /**
  * Espace mémoire pour la file.
  */
@@ -36,10 +48,9 @@ void initialiseTableauDeBord() {
     tableauDeBord.tensionMoyenne.direction = AVANT;
     tableauDeBord.tensionMoyenne.magnitude = 0;
 
-    tableauDeBord.positionRouesAvant.tempsBas.valeur = 65535 - 3000;
-    tableauDeBord.positionRouesAvant.tempsHaut.valeur = 65535 - 37000;
-    
     tableauDeBord.tempsDeDeplacement = 0;
+    tableauDeBord.phaseCommutee = 0;
+    tableauDeBord.rapportCyclique = 0;
 }
 
 /**
@@ -47,9 +58,10 @@ void initialiseTableauDeBord() {
  * @param evenement L'événement.
  * @param valeur Valeur associée.
  */
-void enfileMessageInterne(Evenement evenement, unsigned char valeur) {
+void enfileMessageInterne(Evenement evenement, unsigned int valeur) {
     fileEnfile(&fileMessagesInternes, evenement);
-    fileEnfile(&fileMessagesInternes, valeur);
+    fileEnfile(&fileMessagesInternes, (char) valeur);
+    fileEnfile(&fileMessagesInternes, (char) (valeur >> 8));
 }
     
 EvenementEtValeur *defileMessageInterne() {
@@ -60,7 +72,8 @@ EvenementEtValeur *defileMessageInterne() {
     }
     
     ev.evenement = fileDefile(&fileMessagesInternes);
-    ev.valeur = fileDefile(&fileMessagesInternes);
+    ev.valeur = (unsigned char) fileDefile(&fileMessagesInternes);
+    ev.valeur |= ((unsigned int) (unsigned char) fileDefile(&fileMessagesInternes)) << 8;
     
     return &ev;
 }
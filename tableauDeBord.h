@@ -11,11 +11,6 @@ typedef union {
     } partie;
 } Compteur;
 
-typedef struct {
-    Compteur tempsHaut;
-    Compteur tempsBas;
-} GenerateurPWMServo;
-
 /**
  * Le tableau de bord contient l'état interne du système.
  * Lorsqu'un module change une valeur du tableau de bord, il
@@ -37,26 +32,21 @@ typedef struct {
     /** Tension moyenne d'alimentation du moteur. */
     MagnitudeEtDirection tensionMoyenne;
 
-    /** Position du volant (CHANGEMENT_POSITION_ROUES_AVANT). */
-    GenerateurPWMServo positionRouesAvant;
-    
     /** Temps écoulé depuis le dernier changement de phase */
     unsigned char tempsDeDeplacement;
-    
+
+    /** Phase commutée par le moteur, entre 1 et 6, ou 0. */
+    unsigned char phaseCommutee;
+
+    /** Rapport cyclique appliqué aux transistors hauts. */
+    unsigned char rapportCyclique;
+
 } TableauDeBord;
 
 /** Le tableau de bord est une variable globale. */
-TableauDeBord tableauDeBord = {
-    {AVANT, 0},              // Vitesse mesurée.
-    {AVANT, 0},              // Vitesse demandée.
-    {AVANT, 0},              // Déplacement mesuré.
-    {AVANT, 0},              // Déplacement demandé.
-    {AVANT, 0},              // Tension moyenne à appliquer.
-    {65535 - 3000, 65535 - 37000},   // Position des roues avant.
-    0                        // Temps depuis le changement de phase.
-};
+extern TableauDeBord tableauDeBord;
 
-void enfileMessageInterne(Evenement evenement, unsigned char valeur);
+void enfileMessageInterne(Evenement evenement, unsigned int valeur);
 EvenementEtValeur *defileMessageInterne();
 void initialiseMessagesInternes();
 void initialiseTableauDeBord();
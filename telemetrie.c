@@ -0,0 +1,200 @@
+#include <xc.h>
+#include "telemetrie.h"
+#include "tableauDeBord.h"
+#include "i2c.h"
+#include "test.h"
+
+/** Période d'émission, en bases de temps. Zéro arrête la télémétrie. */
+static unsigned char periodeTelemetrie = 0;
+
+/** Bases de temps restantes avant le prochain enregistrement. */
+static unsigned char tempsTelemetrie = 0;
+
+/** Numéro du prochain enregistrement. */
+static unsigned char numeroEnregistrement = 0;
+
+/** Distance parcourue, en phases, dans les deux sens. */
+static unsigned int odometre = 0;
+
+/** Indique si des enregistrements ont été perdus depuis le dernier émis. */
+static unsigned char enregistrementsPerdus = 0;
+
+/**
+ * Réinitialise la télémétrie. Elle reste arrêtée jusqu'à ce que le
+ * maître en spécifie la période.
+ */
+void telemetrieInitialise() {
+    periodeTelemetrie = 0;
+    tempsTelemetrie = 0;
+    numeroEnregistrement = 0;
+    odometre = 0;
+    enregistrementsPerdus = 0;
+}
+
+/**
+ * Calcule les drapeaux d'état et de défauts.
+ * @return Les drapeaux.
+ */
+static unsigned char drapeaux() {
+    unsigned char d = 0;
+
+    if (tableauDeBord.vitesseMesuree.direction == ARRIERE) {
+        d |= TELEMETRIE_MARCHE_ARRIERE;
+    }
+    if (i2cRegistres.telemetrie.securiteRc) {
+        d |= TELEMETRIE_SECURITE_RC;
+    }
+    if (i2cRegistres.telemetrie.etatThermique) {
+        d |= TELEMETRIE_REDUCTION_THERMIQUE;
+    }
+    if (enregistrementsPerdus) {
+        d |= TELEMETRIE_ENREGISTREMENTS_PERDUS;
+    }
+    return d;
+}
+
+/**
+ * Prépare l'émission d'un enregistrement complet, en une seule trame.
+ * Si la file d'émission n'a pas la place pour toute la trame, 
+ * l'enregistrement est perdu: la boucle principale n'attend jamais 
+ * le bus I2C.
+ */
+static void emetEnregistrement() {
+    unsigned char enregistrement[TELEMETRIE_TAILLE_ENREGISTREMENT];
+
+    enregistrement[TELEMETRIE_NUMERO] = numeroEnregistrement++;
+    enregistrement[TELEMETRIE_VITESSE] = tableauDeBord.vitesseMesuree.magnitude;
+    enregistrement[TELEMETRIE_RAPPORT_CYCLIQUE] = tableauDeBord.rapportCyclique;
+    enregistrement[TELEMETRIE_ALIMENTATION] = i2cRegistres.telemetrie.alimentation;
+    enregistrement[TELEMETRIE_ODOMETRE_BASSE] = (unsigned char) odometre;
+    enregistrement[TELEMETRIE_ODOMETRE_HAUTE] = (unsigned char) (odometre >> 8);
+    enregistrement[TELEMETRIE_DRAPEAUX] = drapeaux();
+    if (i2cPrepareTramePourEmission(TELEMETRIE_ADRESSE_ENREGISTREUR, 
+            enregistrement, TELEMETRIE_TAILLE_ENREGISTREMENT)) {
+        enregistrementsPerdus = 0;
+    } else {
+        enregistrementsPerdus = 255;
+    }
+}
+
+void TELEMETRIE_machine(EvenementEtValeur *ev) {
+    switch (ev->evenement) {
+        case TELEMETRIE_PERIODE_DEMANDEE:
+            periodeTelemetrie = (unsigned char) ev->valeur;
+            tempsTelemetrie = periodeTelemetrie;
+            break;
+
+        case BASE_DE_TEMPS:
+            odometre += tableauDeBord.vitesseMesuree.magnitude;
+            if (periodeTelemetrie != 0) {
+                if (--tempsTelemetrie == 0) {
+                    tempsTelemetrie = periodeTelemetrie;
+                    emetEnregistrement();
+                }
+            }
+            // Si le bus était occupé, l'émission reprend ici:
+            i2cDemarreEmission();
+            break;
+    }
+}
+
+#ifdef TEST
+/**
+ * Défile la prochaine trame préparée pour émission, et vérifie 
+ * qu'elle contient un enregistrement complet.
+ * @param enregistrement Reçoit les champs de l'enregistrement.
+ */
+static void enregistrementEmis(unsigned char *enregistrement) {
+    unsigned char n;
+
+    verifieEgalite("TELA", i2cRecupereCaracterePourEmission(), TELEMETRIE_ADRESSE_ENREGISTREUR);
+    verifieEgalite("TELN", i2cRecupereCaracterePourEmission(), TELEMETRIE_TAILLE_ENREGISTREMENT);
+    for (n = 0; n < TELEMETRIE_TAILLE_ENREGISTREMENT; n++) {
+        enregistrement[n] = i2cRecupereCaracterePourEmission();
+    }
+}
+
+void emet_la_telemetrie_a_la_periode_demandee() {
+    EvenementEtValeur periode = {TELEMETRIE_PERIODE_DEMANDEE, 3};
+    EvenementEtValeur baseDeTemps = {BASE_DE_TEMPS, 0};
+    unsigned char enregistrement[TELEMETRIE_TAILLE_ENREGISTREMENT];
+
+    i2cReinitialise();
+    telemetrieInitialise();
+    tableauDeBord.vitesseMesuree.magnitude = 100;
+    tableauDeBord.vitesseMesuree.direction = ARRIERE;
+    tableauDeBord.rapportCyclique = 80;
+    i2cExposeValeur(LECTURE_I2C_ALIMENTATION, 190);
+    i2cExposeValeur(LECTURE_I2C_SECURITE_RC, 0);
+    i2cExposeValeur(LECTURE_I2C_ETAT_THERMIQUE, 1);
+
+    // Rien n'est émis avant que la période soit spécifiée:
+    TELEMETRIE_machine(&baseDeTemps);
+    verifieEgalite("TELP01", i2cDonneesDisponiblesPourEmission(), 0);
+
+    TELEMETRIE_machine(&periode);
+    TELEMETRIE_machine(&baseDeTemps);
+    TELEMETRIE_machine(&baseDeTemps);
+    verifieEgalite("TELP02", i2cDonneesDisponiblesPourEmission(), 0);
+    TELEMETRIE_machine(&baseDeTemps);
+    verifieEgalite("TELP03", i2cDonneesDisponiblesPourEmission(), 255);
+
+    enregistrementEmis(enregistrement);
+    verifieEgalite("TELP10", enregistrement[TELEMETRIE_NUMERO], 0);
+    verifieEgalite("TELP11", enregistrement[TELEMETRIE_VITESSE], 100);
+    verifieEgalite("TELP12", enregistrement[TELEMETRIE_RAPPORT_CYCLIQUE], 80);
+    verifieEgalite("TELP13", enregistrement[TELEMETRIE_ALIMENTATION], 190);
+    verifieEgalite("TELP14", enregistrement[TELEMETRIE_ODOMETRE_BASSE], 144);
+    verifieEgalite("TELP15", enregistrement[TELEMETRIE_ODOMETRE_HAUTE], 1);
+    verifieEgalite("TELP16", enregistrement[TELEMETRIE_DRAPEAUX],
+            TELEMETRIE_MARCHE_ARRIERE | TELEMETRIE_REDUCTION_THERMIQUE);
+    verifieEgalite("TELP17", i2cDonneesDisponiblesPourEmission(), 0);
+
+    i2cExposeValeur(LECTURE_I2C_ETAT_THERMIQUE, 0);
+    i2cReinitialise();
+}
+
+void perd_les_enregistrements_si_la_file_est_pleine() {
+    EvenementEtValeur periode = {TELEMETRIE_PERIODE_DEMANDEE, 1};
+    EvenementEtValeur baseDeTemps = {BASE_DE_TEMPS, 0};
+    unsigned char enregistrement[TELEMETRIE_TAILLE_ENREGISTREMENT];
+    unsigned char n;
+
+    i2cReinitialise();
+    telemetrieInitialise();
+    tableauDeBord.vitesseMesuree.magnitude = 0;
+    tableauDeBord.vitesseMesuree.direction = AVANT;
+    TELEMETRIE_machine(&periode);
+
+    // La file d'émission ne contient que 5 enregistrements complets:
+    for (n = 0; n < 7; n++) {
+        TELEMETRIE_machine(&baseDeTemps);
+    }
+    for (n = 0; n < 5; n++) {
+        enregistrementEmis(enregistrement);
+        verifieEgalite("TELF01", enregistrement[TELEMETRIE_NUMERO], n);
+        verifieEgalite("TELF02", enregistrement[TELEMETRIE_DRAPEAUX], 0);
+    }
+    verifieEgalite("TELF03", i2cDonneesDisponiblesPourEmission(), 0);
+
+    // L'enregistrement suivant signale la perte:
+    TELEMETRIE_machine(&baseDeTemps);
+    enregistrementEmis(enregistrement);
+    verifieEgalite("TELF10", enregistrement[TELEMETRIE_NUMERO], 7);
+    verifieEgalite("TELF11", enregistrement[TELEMETRIE_DRAPEAUX], TELEMETRIE_ENREGISTREMENTS_PERDUS);
+
+    // Le drapeau ne signale que la perte la plus récente:
+    TELEMETRIE_machine(&baseDeTemps);
+    enregistrementEmis(enregistrement);
+    verifieEgalite("TELF20", enregistrement[TELEMETRIE_NUMERO], 8);
+    verifieEgalite("TELF21", enregistrement[TELEMETRIE_DRAPEAUX], 0);
+
+    telemetrieInitialise();
+    i2cReinitialise();
+}
+
+void test_telemetrie() {
+    emet_la_telemetrie_a_la_periode_demandee();
+    perd_les_enregistrements_si_la_file_est_pleine();
+}
+#endif
@@ -0,0 +1,62 @@
+#include "domaine.h"
+
+#ifndef __TELEMETRIE_H
+#define __TELEMETRIE_H
+
+/**
+ * Adresse de l'enregistreur qui reçoit la télémétrie. Chaque 
+ * enregistrement lui est écrit en une seule transaction I2C.
+ */
+#define TELEMETRIE_ADRESSE_ENREGISTREUR 0b01000000
+
+/**
+ * Champs d'un enregistrement de télémétrie, dans l'ordre où ils 
+ * suivent l'adresse de l'enregistreur.
+ */
+typedef enum {
+    /** Numéro de l'enregistrement. Un saut indique des pertes. */
+    TELEMETRIE_NUMERO = 0,
+    /** Vitesse mesurée, en phases par base de temps. */
+    TELEMETRIE_VITESSE = 1,
+    /** Rapport cyclique appliqué au moteur. */
+    TELEMETRIE_RAPPORT_CYCLIQUE = 2,
+    /** Tension d'alimentation, sur 8 bits. */
+    TELEMETRIE_ALIMENTATION = 3,
+    /** Odomètre, en phases (octet moins signifiant). */
+    TELEMETRIE_ODOMETRE_BASSE = 4,
+    /** Odomètre, en phases (octet plus signifiant). */
+    TELEMETRIE_ODOMETRE_HAUTE = 5,
+    /** Drapeaux d'état et de défauts (voir DrapeauTelemetrie). */
+    TELEMETRIE_DRAPEAUX = 6
+} ChampTelemetrie;
+
+/** Nombre de champs d'un enregistrement. */
+#define TELEMETRIE_TAILLE_ENREGISTREMENT 7
+
+/**
+ * Drapeaux d'état et de défauts.
+ */
+typedef enum {
+    /** La voiture recule. */
+    TELEMETRIE_MARCHE_ARRIERE = 0x01,
+    /** La télécommande est en sécurité. */
+    TELEMETRIE_SECURITE_RC = 0x02,
+    /** La puissance est réduite à cause de la température. */
+    TELEMETRIE_REDUCTION_THERMIQUE = 0x04,
+    /** Des enregistrements ont été perdus parce que la file était pleine. */
+    TELEMETRIE_ENREGISTREMENTS_PERDUS = 0x08
+} DrapeauTelemetrie;
+
+void telemetrieInitialise();
+
+/**
+ * Machine à états pour émettre périodiquement la télémétrie.
+ * @param ev Événement à traiter.
+ */
+void TELEMETRIE_machine(EvenementEtValeur *ev);
+
+#ifdef TEST
+void test_telemetrie();
+#endif
+
+#endif